@@ -0,0 +1,251 @@
+// Graph's cost models against hand-written loops: for each model (travel
+// cost, distance, tolls, truck limits) the same queries run through
+// Graph::dijkstra<Model>() and through a Dijkstra written out for that model
+// alone over the same snapshot, in the style of Graph::search. Costs and
+// paths must match; the times should too, apart from what dijkstra() adds
+// around its search (pinning a version, ruling out unreachable pairs,
+// tracing the path), which is the same for every model.
+//
+// The graph is a side x side grid of two-way routes with random distances;
+// some routes carry traffic, tolls or height and weight limits.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -o cost_model_bench bench/cost_model_bench.cpp
+// Run:    ./cost_model_bench [--side N] [--queries N] [--rounds N] [--seed S]
+//                          [--per-toll N] [--truck-height CM] [--truck-weight KG]
+
+#include "../spf.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace std;
+
+// Query parameters, set from the command line so that neither side gets
+// them as compile-time constants.
+static int perToll = 3;
+static int truckHeight = 400;    // centimetres
+static int truckWeight = 30000;  // kilograms
+
+// The parts of a search every hand-written loop shares, on leased stamped
+// arrays as Graph::search uses.
+class HandSearch {
+public:
+    ScratchLease lease;
+    SearchScratch& scratch;
+
+    HandSearch(const GraphVersion& graph, int src) : scratch(*lease) {
+        scratch.begin(graph.nextCityId);
+        scratch.reached[src] = scratch.stamp;
+        scratch.costs[src] = 0;
+        scratch.parents[src] = src;
+        scratch.minHeap.push(0, src);
+    }
+
+    int distance(int node) const { return scratch.costs[node]; }
+
+    // Pops the next city to settle, or -1 when done.
+    int next(int dest) {
+        while (!scratch.minHeap.empty()) {
+            pair<int, int> current = scratch.minHeap.top();
+            scratch.minHeap.pop();
+            if (current.first > scratch.costs[current.second]) continue;
+            return current.second == dest ? -1 : current.second;
+        }
+        return -1;
+    }
+
+    void relax(int node, int nbr, long long candidate) {
+        if (candidate < (scratch.reached[nbr] == scratch.stamp ? scratch.costs[nbr] : INT_MAX)) {
+            scratch.reached[nbr] = scratch.stamp;
+            scratch.costs[nbr] = (int)candidate;
+            scratch.parents[nbr] = node;
+            scratch.minHeap.push(scratch.costs[nbr], nbr);
+        }
+    }
+
+    // Cost to dest (INT_MAX if unreached) and the path into nodes.
+    int finish(int src, int dest, vector<int>& nodes) {
+        nodes.clear();
+        if (scratch.reached[dest] != scratch.stamp) return INT_MAX;
+        for (int node = dest; node != src; node = scratch.parents[node]) nodes.push_back(node);
+        nodes.push_back(src);
+        reverse(nodes.begin(), nodes.end());
+        return scratch.costs[dest];
+    }
+};
+
+static int handTravel(const GraphVersion& graph, int src, int dest, vector<int>& nodes) {
+    const EdgeOverlay& costs = *graph.overlay;
+    HandSearch search(graph, src);
+    for (int node = search.next(dest); node != -1; node = search.next(dest)) {
+        int dist = search.distance(node);
+        for (const Link& link : graph.links(node)) {
+            search.relax(node, link.neighbor, (long long)dist + costs.cost(link.edge));
+        }
+    }
+    return search.finish(src, dest, nodes);
+}
+
+static int handDistance(const GraphVersion& graph, int src, int dest, vector<int>& nodes) {
+    const EdgeOverlay& costs = *graph.overlay;
+    HandSearch search(graph, src);
+    for (int node = search.next(dest); node != -1; node = search.next(dest)) {
+        int dist = search.distance(node);
+        for (const Link& link : graph.links(node)) {
+            Route route = Route::fromWord(link.neighbor, costs.load(link.edge));
+            if (route.isBlocked()) continue;
+            search.relax(node, link.neighbor, (long long)dist + route.distance());
+        }
+    }
+    return search.finish(src, dest, nodes);
+}
+
+static int handToll(const GraphVersion& graph, int src, int dest, vector<int>& nodes) {
+    const EdgeOverlay& costs = *graph.overlay;
+    const RouteTermsTable& terms = *graph.terms;
+    HandSearch search(graph, src);
+    for (int node = search.next(dest); node != -1; node = search.next(dest)) {
+        int dist = search.distance(node);
+        for (const Link& link : graph.links(node)) {
+            uint32_t cost = costs.cost(link.edge);
+            if (cost == Route::BLOCKED_COST) continue;
+            search.relax(node, link.neighbor, (long long)dist + cost + (long long)terms.of(link.edge).toll * perToll);
+        }
+    }
+    return search.finish(src, dest, nodes);
+}
+
+static int handTruck(const GraphVersion& graph, int src, int dest, vector<int>& nodes) {
+    const EdgeOverlay& costs = *graph.overlay;
+    const RouteTermsTable& terms = *graph.terms;
+    HandSearch search(graph, src);
+    for (int node = search.next(dest); node != -1; node = search.next(dest)) {
+        int dist = search.distance(node);
+        for (const Link& link : graph.links(node)) {
+            RouteTerms<uint32_t> limits = terms.of(link.edge);
+            if (limits.maxHeight < truckHeight || limits.maxWeight < truckWeight) continue;
+            search.relax(node, link.neighbor, (long long)dist + costs.cost(link.edge));
+        }
+    }
+    return search.finish(src, dest, nodes);
+}
+
+static double millisSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+class Comparison {
+public:
+    const Graph& graph;
+    const GraphVersion& snapshot;
+    const vector<pair<int, int>>& pairs;
+    int rounds;
+
+    Comparison(const Graph& graph, const GraphVersion& snapshot, const vector<pair<int, int>>& pairs, int rounds)
+        : graph(graph), snapshot(snapshot), pairs(pairs), rounds(rounds) {}
+
+    // Microseconds per query, best of rounds. The two run each query back to
+    // back, in alternating order, so drift in the machine's speed lands on
+    // both. Returns false if any answer differs.
+    template <class Model>
+    bool run(const char* name, const Model& model, int (*hand)(const GraphVersion&, int, int, vector<int>&)) {
+        double templated = 1e300, written = 1e300;
+        long long checksum = 0;
+        vector<int> nodes;
+        for (int round = 0; round < rounds; round++) {
+            double roundTemplated = 0, roundWritten = 0;
+            for (size_t i = 0; i < pairs.size(); i++) {
+                for (int turn = 0; turn < 2; turn++) {
+                    auto start = chrono::steady_clock::now();
+                    if ((turn + i) % 2 == 0) {
+                        checksum += graph.dijkstra(pairs[i].first, pairs[i].second, model).cost;
+                        roundTemplated += millisSince(start);
+                    } else {
+                        checksum += hand(snapshot, pairs[i].first, pairs[i].second, nodes);
+                        roundWritten += millisSince(start);
+                    }
+                }
+            }
+            templated = min(templated, roundTemplated * 1e3 / pairs.size());
+            written = min(written, roundWritten * 1e3 / pairs.size());
+        }
+
+        for (const pair<int, int>& query : pairs) {
+            PathResult path = graph.dijkstra(query.first, query.second, model);
+            int cost = hand(snapshot, query.first, query.second, nodes);
+            bool same = path.found() ? cost == path.cost && path.nodes == nodes : cost == INT_MAX;
+            if (!same) {
+                fprintf(stderr, "%s mismatch %d -> %d: model %lld, hand-written %d\n", name, query.first,
+                        query.second, path.found() ? path.cost : -1, cost == INT_MAX ? -1 : cost);
+                return false;
+            }
+        }
+        printf("%-9s %10.1f us/query templated %10.1f hand-written  (%.3fx, checksum %lld)\n", name, templated,
+               written, templated / written, checksum);
+        return true;
+    }
+};
+
+int main(int argc, char** argv) {
+    int side = 300, queries = 200, rounds = 3;
+    unsigned seed = 42;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string option = argv[i];
+        int value = atoi(argv[i + 1]);
+        if (option == "--side") side = value;
+        else if (option == "--queries") queries = value;
+        else if (option == "--rounds") rounds = value;
+        else if (option == "--seed") seed = value;
+        else if (option == "--per-toll") perToll = value;
+        else if (option == "--truck-height") truckHeight = value;
+        else if (option == "--truck-weight") truckWeight = value;
+        else {
+            fprintf(stderr, "unknown option %s\n", option.c_str());
+            return 1;
+        }
+    }
+
+    mt19937 rng(seed);
+    auto pick = [&](int low, int high) { return uniform_int_distribution<int>(low, high)(rng); };
+    Graph graph;
+    vector<string> names;
+    for (int i = 0; i < side * side; i++) names.push_back("c" + to_string(i));
+    graph.addCities(names);
+    vector<NewRoute> routes;
+    vector<TrafficUpdate> traffic;
+    vector<RouteToll> tolls;
+    vector<RouteLimits> limits;
+    auto connect = [&](int u, int v) {
+        routes.push_back(NewRoute(u, v, pick(10, 100)));
+        for (int from : {u, v}) {
+            int to = from == u ? v : u;
+            int roll = pick(0, 99);
+            if (roll < 30) traffic.push_back(TrafficUpdate(from, to, pick(0, 9)));
+            if (roll >= 30 && roll < 45) tolls.push_back(RouteToll(from, to, pick(1, 50)));
+            if (roll >= 45 && roll < 55) limits.push_back(RouteLimits(from, to, pick(300, 450), pick(7500, 40000)));
+        }
+    };
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            int id = y * side + x + 1;
+            if (x + 1 < side) connect(id, id + 1);
+            if (y + 1 < side) connect(id, id + side);
+        }
+    }
+    graph.addRoutes(routes);
+    graph.applyTrafficBatch(traffic);
+    graph.setTolls(tolls);
+    graph.setLimits(limits);
+    vector<pair<int, int>> pairs(queries);
+    for (pair<int, int>& query : pairs) query = make_pair(pick(1, side * side), pick(1, side * side));
+
+    printf("grid %dx%d, %d queries, best of %d rounds\n", side, side, queries, rounds);
+    ReadGuard snapshot = graph.snapshot();
+    Comparison comparison(graph, *snapshot, pairs, rounds);
+    bool ok = comparison.run("travel", TravelModel(), handTravel) &&
+              comparison.run("distance", DistanceModel(), handDistance) &&
+              comparison.run("toll", TollModel<uint32_t>(perToll), handToll) &&
+              comparison.run("truck", TruckModel(truckHeight, truckWeight), handTruck);
+    return ok ? 0 : 1;
+}
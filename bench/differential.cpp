@@ -0,0 +1,883 @@
+// Randomized differential tester: every query engine must give the answer
+// Graph::dijkstra gives. Each case is a random script of city and route
+// additions, blocks, unblocks, traffic changes and feeds and travel-time
+// profiles, with queries in between; every query goes to every engine, and
+// the status, cost and (where an engine returns one) path are compared. A
+// shadow model written from the rules alone (effective cost distance +
+// distance * traffic / 10 in integer arithmetic, traffic 8-10 blocks,
+// blocked routes are impassable) checks dijkstra itself.
+//
+// Engines: model, noSTL (noSTL.cpp's Graph::shortestPath), kShortestPaths,
+// alternativeRoutes, reachableWithin, OverlayRouter (tiny cells so every
+// level is used), HubLabels (rebuilt after changes, route() and distance())
+// and Graph under other policies: 64-bit labels, unsigned IDs and
+// LazyMinHeap, and double labels with 64-bit IDs. kShortestPaths must
+// return loopless, distinct paths at the model's k cheapest costs (where
+// the model can enumerate them), and every alternative route must be
+// loopless and within the stretch and sharing bounds.
+//
+// Departure queries (D) check dijkstraAt against the model's time-dependent
+// search over the profiles set so far, which are FIFO whenever accepted.
+// Model queries (R src dest distance | toll N | truck H W) check dijkstra
+// under each cost model against the model's search priced the same way,
+// over the tolls and vehicle limits set so far.
+//
+// Every query is also sent as a command line to a CommandProcessor on the
+// same Graph, whose reply must be the one dijkstra's answer calls for:
+// OK with the path, NOPATH, or an ERR naming the problem (an empty graph,
+// an unknown city, a bad departure time). Some scripts query before adding
+// any city.
+//
+// On a mismatch the script is minimized (delta debugging: drop chunks of
+// commands while the same engine still disagrees) and printed as commands
+// for ./main --batch, so the reproducer replays against the real binary.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -o differential bench/differential.cpp
+// Run:    ./differential [--cases N] [--ops N] [--seed S]
+//
+// Exits non-zero on the first mismatch, after printing the reproducer.
+
+#include "../spf.h"
+#include "../commands.h"
+
+// Both engines define Graph, Route, MinHeap...; noSTL.cpp's go in a
+// namespace of their own, without its main(). Its standard headers are
+// already included, so their guards keep them out of it.
+#include <sstream>
+#define SPF_NO_MAIN
+namespace nostl {
+#include "../noSTL.cpp"
+}
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <queue>
+#include <random>
+#include <set>
+
+// One line of a test script, in the --batch command language.
+class Op {
+public:
+    char kind;  // C E B U T F P O L R D, and M: R with a cost model
+    std::string name;
+    int a, b, c, d, e;
+    std::vector<TrafficUpdate> feed;
+    std::vector<ProfilePoint> points;
+
+    // An M query's c picks the model: DISTANCE, TOLL (per toll d) or TRUCK
+    // (height d, weight e).
+    enum { DISTANCE, TOLL, TRUCK };
+
+    Op(char kind = 'R', int a = 0, int b = 0, int c = 0, int d = 0, int e = 0)
+        : kind(kind), a(a), b(b), c(c), d(d), e(e) {}
+
+    std::string command() const {
+        switch (kind) {
+            case 'C': return "C " + name;
+            case 'E':
+                return "E " + std::to_string(a) + " " + std::to_string(b) + " " + std::to_string(c) + " " +
+                       std::to_string(d);
+            case 'T': return "T " + std::to_string(a) + " " + std::to_string(b) + " " + std::to_string(c);
+            case 'F': {
+                std::string line = "F " + std::to_string(feed.size());
+                for (const TrafficUpdate& update : feed) {
+                    line += " " + std::to_string(update.from) + " " + std::to_string(update.to) + " " +
+                            std::to_string(update.level);
+                }
+                return line;
+            }
+            case 'P': {
+                std::string line =
+                    "P " + std::to_string(a) + " " + std::to_string(b) + " " + std::to_string(points.size());
+                for (const ProfilePoint& point : points) {
+                    line += " " + std::to_string(point.minute) + " " + std::to_string(point.travelTime);
+                }
+                return line;
+            }
+            case 'D': return "D " + std::to_string(a) + " " + std::to_string(b) + " " + std::to_string(c);
+            case 'O': return "O " + std::to_string(a) + " " + std::to_string(b) + " " + std::to_string(c);
+            case 'L':
+                return "L " + std::to_string(a) + " " + std::to_string(b) + " " + std::to_string(c) + " " +
+                       std::to_string(d);
+            case 'M': {
+                std::string line = "R " + std::to_string(a) + " " + std::to_string(b);
+                if (c == DISTANCE) return line + " distance";
+                if (c == TOLL) return line + " toll " + std::to_string(d);
+                return line + " truck " + std::to_string(d) + " " + std::to_string(e);
+            }
+            default: return std::string(1, kind) + " " + std::to_string(a) + " " + std::to_string(b);
+        }
+    }
+};
+
+// The routing rules, restated without any of the engines' code.
+class Model {
+public:
+    class Edge {
+    public:
+        int distance = 0;
+        int traffic = 0;
+        bool blocked = false;
+        int toll = 0;
+        int maxHeight = INT_MAX;
+        int maxWeight = INT_MAX;
+
+        long long cost() const { return distance + distance * traffic / 10; }
+    };
+
+    std::map<std::pair<int, int>, Edge> edges;
+    std::map<std::pair<int, int>, std::vector<ProfilePoint>> profiles;
+    std::map<std::string, int> ids;
+    int nextId = 1;
+
+    bool hasCity(int id) const { return id >= 1 && id < nextId; }
+
+    void apply(const Op& op) {
+        switch (op.kind) {
+            case 'C':
+                if (!op.name.empty() && !ids.count(op.name)) ids[op.name] = nextId++;
+                break;
+            case 'E': {
+                if (!hasCity(op.a) || !hasCity(op.b) || op.a == op.b) break;
+                if (op.c <= 0 || op.c > (int)Route::MAX_DISTANCE) break;
+                bool oneWay = op.d != 0;
+                auto forward = edges.find(std::make_pair(op.a, op.b));
+                auto reverse = edges.find(std::make_pair(op.b, op.a));
+                if (forward != edges.end()) {
+                    forward->second.distance = op.c;
+                    if (!oneWay && reverse != edges.end()) reverse->second.distance = op.c;
+                    break;
+                }
+                edges[std::make_pair(op.a, op.b)].distance = op.c;
+                if (!oneWay) edges[std::make_pair(op.b, op.a)].distance = op.c;
+                break;
+            }
+            case 'B':
+            case 'U': {
+                auto edge = edges.find(std::make_pair(op.a, op.b));
+                if (edge != edges.end()) edge->second.blocked = op.kind == 'B';
+                break;
+            }
+            case 'T':
+                traffic(op.a, op.b, op.c);
+                break;
+            case 'F':
+                for (const TrafficUpdate& update : op.feed) traffic(update.from, update.to, update.level);
+                break;
+            case 'P':
+                profile(op.a, op.b, op.points);
+                break;
+            case 'O': {
+                auto edge = edges.find(std::make_pair(op.a, op.b));
+                if (edge != edges.end() && op.c >= 0 && op.c <= (int)Route::MAX_DISTANCE) edge->second.toll = op.c;
+                break;
+            }
+            case 'L': {
+                auto edge = edges.find(std::make_pair(op.a, op.b));
+                if (edge != edges.end() && op.c > 0 && op.d > 0) {
+                    edge->second.maxHeight = op.c;
+                    edge->second.maxWeight = op.d;
+                }
+                break;
+            }
+        }
+    }
+
+    // What an M query minimizes over an open route, or -1 if the route is
+    // closed to it.
+    static long long priced(const Op& query, const Edge& edge) {
+        switch (query.c) {
+            case Op::DISTANCE: return edge.distance;
+            case Op::TOLL: return edge.cost() + (long long)edge.toll * query.d;
+            default: return query.d > edge.maxHeight || query.e > edge.maxWeight ? -1 : edge.cost();
+        }
+    }
+
+    // Status and cost as dijkstra reports them, with a departure minute
+    // (0-1439) the travel time dijkstraAt reports, or with an M query what
+    // dijkstra reports under its cost model.
+    std::pair<PathStatus, long long> query(int src, int dest, int departure = -1, const Op* model = nullptr) const {
+        if (nextId == 1) return std::make_pair(PathStatus::EMPTY_GRAPH, -1LL);
+        if (!hasCity(src)) return std::make_pair(PathStatus::INVALID_SOURCE, -1LL);
+        if (!hasCity(dest)) return std::make_pair(PathStatus::INVALID_DESTINATION, -1LL);
+        if (src == dest) return std::make_pair(PathStatus::SAME_CITY, 0LL);
+        std::vector<long long> best(nextId, LLONG_MAX);
+        std::priority_queue<std::pair<long long, int>, std::vector<std::pair<long long, int>>,
+                            std::greater<std::pair<long long, int>>>
+            queue;
+        best[src] = 0;
+        queue.push(std::make_pair(0, src));
+        while (!queue.empty()) {
+            std::pair<long long, int> top = queue.top();
+            queue.pop();
+            if (top.first > best[top.second]) continue;
+            for (auto it = edges.lower_bound(std::make_pair(top.second, 0));
+                 it != edges.end() && it->first.first == top.second; ++it) {
+                long long step = model ? priced(*model, it->second) : cost(*it, departure, top.first);
+                if (it->second.blocked || step < 0) continue;
+                long long candidate = top.first + step;
+                // Searches keep costs in an int; INT_MAX means unreached.
+                if (candidate >= INT_MAX || candidate >= best[it->first.second]) continue;
+                best[it->first.second] = candidate;
+                queue.push(std::make_pair(candidate, it->first.second));
+            }
+        }
+        if (best[dest] == LLONG_MAX) return std::make_pair(PathStatus::NO_PATH, -1LL);
+        return std::make_pair(PathStatus::FOUND, best[dest]);
+    }
+
+    // Empty if nodes is a loopless path from src to dest over open routes
+    // costing cost (leaving at departure, or priced for model, if given),
+    // else what is wrong with it.
+    std::string checkPath(const std::vector<int>& nodes, int src, int dest, long long cost, int departure = -1,
+                     const Op* model = nullptr) const {
+        if (nodes.empty() || nodes.front() != src || nodes.back() != dest) return "path has the wrong ends";
+        if (std::set<int>(nodes.begin(), nodes.end()).size() != nodes.size()) return "path visits a city twice";
+        long long total = 0;
+        for (size_t i = 0; i + 1 < nodes.size(); i++) {
+            auto edge = edges.find(std::make_pair(nodes[i], nodes[i + 1]));
+            if (edge == edges.end()) return "path uses a missing route";
+            if (edge->second.blocked) return "path uses a blocked route";
+            long long step = model ? priced(*model, edge->second) : this->cost(*edge, departure, total);
+            if (step < 0) return "path uses a route closed to the query";
+            total += step;
+        }
+        if (total != cost) return "path costs " + std::to_string(total) + ", not " + std::to_string(cost);
+        return "";
+    }
+
+    // Costs of the k cheapest loopless paths from src to dest, cheapest
+    // first, by best-first search over partial paths. False if that takes
+    // more than limit expansions.
+    bool cheapestPaths(int src, int dest, int k, size_t limit, std::vector<long long>& costs) const {
+        typedef std::pair<long long, std::vector<int>> Partial;
+        std::priority_queue<Partial, std::vector<Partial>, std::greater<Partial>> queue;
+        queue.push(Partial(0, std::vector<int>(1, src)));
+        costs.clear();
+        for (size_t expanded = 0; !queue.empty() && (int)costs.size() < k; expanded++) {
+            if (expanded == limit) return false;
+            Partial top = queue.top();
+            queue.pop();
+            int node = top.second.back();
+            if (node == dest) {
+                costs.push_back(top.first);
+                continue;
+            }
+            for (auto it = edges.lower_bound(std::make_pair(node, 0)); it != edges.end() && it->first.first == node;
+                 ++it) {
+                if (it->second.blocked) continue;
+                if (std::find(top.second.begin(), top.second.end(), it->first.second) != top.second.end()) continue;
+                long long candidate = top.first + it->second.cost();
+                if (candidate >= INT_MAX) continue;
+                Partial next(candidate, top.second);
+                next.second.push_back(it->first.second);
+                queue.push(next);
+            }
+        }
+        return true;
+    }
+
+private:
+    static const int DAY_MINUTES = 24 * 60;
+
+    // Cost of edge entered elapsed minutes after leaving at departure: its
+    // profile's travel time if it has one and departure is given, else its
+    // effective cost.
+    long long cost(const std::pair<const std::pair<int, int>, Edge>& edge, int departure, long long elapsed) const {
+        if (departure >= 0) {
+            auto profile = profiles.find(edge.first);
+            if (profile != profiles.end()) {
+                return travelTime(profile->second, (int)((departure + elapsed) % DAY_MINUTES));
+            }
+        }
+        return edge.second.cost();
+    }
+
+    // Linear between the breakpoints around minute, wrapping past midnight,
+    // rounded towards the earlier one.
+    static long long travelTime(const std::vector<ProfilePoint>& points, int minute) {
+        size_t next = 0;
+        while (next < points.size() && points[next].minute <= minute) next++;
+        ProfilePoint from = next == 0 ? points.back() : points[next - 1];
+        ProfilePoint to = next == points.size() ? points.front() : points[next];
+        if (next == 0) from.minute -= DAY_MINUTES;
+        if (next == points.size()) to.minute += DAY_MINUTES;
+        return from.travelTime +
+               (long long)(to.travelTime - from.travelTime) * (minute - from.minute) / (to.minute - from.minute);
+    }
+
+    // Kept only if minutes rise within the day, times are valid distances
+    // and no segment falls faster than a minute per minute (FIFO); no
+    // points removes the profile.
+    void profile(int u, int v, const std::vector<ProfilePoint>& points) {
+        std::pair<int, int> key(u, v);
+        if (!edges.count(key)) return;
+        if (points.empty()) {
+            profiles.erase(key);
+            return;
+        }
+        if ((int)points.size() > TravelProfiles::MAX_POINTS) return;
+        for (size_t i = 0; i < points.size(); i++) {
+            const ProfilePoint& from = points[i];
+            if (from.minute < 0 || from.minute >= DAY_MINUTES) return;
+            if (from.travelTime <= 0 || from.travelTime > (int)Route::MAX_DISTANCE) return;
+            if (i > 0 && from.minute <= points[i - 1].minute) return;
+        }
+        for (size_t i = 0; i < points.size(); i++) {
+            const ProfilePoint& from = points[i];
+            const ProfilePoint& to = points[(i + 1) % points.size()];
+            int span = to.minute - from.minute + (i + 1 == points.size() ? DAY_MINUTES : 0);
+            if (from.travelTime - to.travelTime > span) return;
+        }
+        profiles[key] = points;
+    }
+
+    void traffic(int u, int v, int level) {
+        if (level < 0 || level > 10) return;
+        auto edge = edges.find(std::make_pair(u, v));
+        if (edge == edges.end()) return;
+        edge->second.traffic = level;
+        if (level >= 8) edge->second.blocked = true;
+    }
+};
+
+class Mismatch {
+public:
+    size_t op = 0;
+    std::string engine;
+    std::string detail;
+};
+
+static const char* statusName(PathStatus status) {
+    switch (status) {
+        case PathStatus::FOUND: return "FOUND";
+        case PathStatus::SAME_CITY: return "SAME_CITY";
+        case PathStatus::NO_PATH: return "NO_PATH";
+        case PathStatus::EMPTY_GRAPH: return "EMPTY_GRAPH";
+        case PathStatus::INVALID_SOURCE: return "INVALID_SOURCE";
+        case PathStatus::INVALID_DESTINATION: return "INVALID_DESTINATION";
+        case PathStatus::INVALID_DEPARTURE: return "INVALID_DEPARTURE";
+        case PathStatus::INVALID_BUDGET: return "INVALID_BUDGET";
+    }
+    return "?";
+}
+
+static std::string describe(PathStatus status, long long cost) {
+    return std::string(statusName(status)) + (status == PathStatus::FOUND ? " " + std::to_string(cost) : "");
+}
+
+// Runs one script through every engine from scratch.
+class Harness {
+public:
+    Harness() : overlay(graph, std::vector<int>{4, 16}), labelsStale(true), commands(graph) {}
+
+    // The first mismatch, if any.
+    bool run(const std::vector<Op>& ops, Mismatch& found) {
+        for (size_t i = 0; i < ops.size(); i++) {
+            const Op& op = ops[i];
+            if (op.kind != 'R' && op.kind != 'D' && op.kind != 'M') {
+                apply(op);
+                continue;
+            }
+            std::string engine, detail;
+            bool agreed = op.kind == 'R'   ? compare(op.a, op.b, engine, detail)
+                          : op.kind == 'D' ? compareAt(op.a, op.b, op.c, engine, detail)
+                                           : compareModel(op, engine, detail);
+            if (!agreed || !compareReply(op, engine, detail)) {
+                found.op = i;
+                found.engine = engine;
+                found.detail = detail;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    // Paths asked of kShortestPaths and alternativeRoutes, and how far the
+    // model enumerates paths to check the former's costs.
+    static const int RANKED = 4;
+    static const size_t ENUMERATION_LIMIT = 20000;
+
+    typedef BasicGraph<long long, unsigned, LazyMinHeap> WideGraph;
+    typedef BasicGraph<double, long long> RealGraph;
+
+    Graph graph;
+    nostl::Graph other;
+    WideGraph wide;
+    RealGraph real;
+    Model model;
+    OverlayRouter overlay;
+    std::shared_ptr<HubLabels> labels;
+    bool labelsStale;
+    CommandProcessor commands;
+
+    void apply(const Op& op) {
+        model.apply(op);
+        labelsStale = true;
+        switch (op.kind) {
+            case 'C':
+                graph.addCity(op.name);
+                other.addCity(op.name);
+                wide.addCity(op.name);
+                real.addCity(op.name);
+                break;
+            case 'E':
+                graph.addEdge(op.a, op.b, op.c, op.d != 0);
+                other.addEdge(op.a, op.b, op.c, op.d != 0);
+                wide.addEdge(op.a, op.b, op.c, op.d != 0);
+                real.addEdge(op.a, op.b, op.c, op.d != 0);
+                break;
+            case 'B':
+                graph.blockRoute(op.a, op.b);
+                other.blockRoute(op.a, op.b);
+                wide.blockRoute(op.a, op.b);
+                real.blockRoute(op.a, op.b);
+                break;
+            case 'U':
+                graph.unblockRoute(op.a, op.b);
+                other.unblockRoute(op.a, op.b);
+                wide.unblockRoute(op.a, op.b);
+                real.unblockRoute(op.a, op.b);
+                break;
+            case 'T':
+                graph.setTraffic(op.a, op.b, op.c);
+                other.setTraffic(op.a, op.b, op.c);
+                wide.setTraffic(op.a, op.b, op.c);
+                real.setTraffic(op.a, op.b, op.c);
+                break;
+            case 'F':
+                graph.applyTrafficBatch(op.feed);
+                for (const TrafficUpdate& update : op.feed) {
+                    other.setTraffic(update.from, update.to, update.level);
+                }
+                wide.applyTrafficBatch(op.feed);
+                real.applyTrafficBatch(op.feed);
+                break;
+            case 'P':
+                graph.setProfile(op.a, op.b, op.points);
+                wide.setProfile(op.a, op.b, op.points);
+                break;
+            case 'O':
+                graph.setToll(op.a, op.b, op.c);
+                wide.setToll(op.a, op.b, op.c);
+                break;
+            case 'L':
+                graph.setLimits(op.a, op.b, op.c, op.d);
+                wide.setLimits(op.a, op.b, op.c, op.d);
+                break;
+        }
+    }
+
+    // Checks one engine's answer against the reference; paths are checked
+    // when the engine returned one.
+    bool agree(const PathResult& reference, PathStatus status, long long cost, const std::vector<int>* nodes,
+               std::string& detail) {
+        bool found = reference.found();
+        if (status != reference.status || (found && cost != reference.cost)) {
+            detail = "got " + describe(status, cost) + ", dijkstra " + describe(reference.status, reference.cost);
+            return false;
+        }
+        if (nodes && status == PathStatus::FOUND) {
+            detail = model.checkPath(*nodes, reference.src, reference.dest, cost);
+            return detail.empty();
+        }
+        return true;
+    }
+
+    bool compare(int src, int dest, std::string& engine, std::string& detail) {
+        PathResult reference = graph.dijkstra(src, dest);
+
+        engine = "dijkstra";
+        if (reference.status == PathStatus::FOUND) {
+            detail = model.checkPath(reference.nodes, src, dest, reference.cost);
+            if (!detail.empty()) return false;
+        }
+
+        engine = "model";
+        std::pair<PathStatus, long long> expected = model.query(src, dest);
+        if (!agree(reference, expected.first, expected.second, nullptr, detail)) return false;
+
+        // noSTL.cpp only answers for two existing, distinct cities quietly.
+        if (reference.status == PathStatus::FOUND || reference.status == PathStatus::NO_PATH) {
+            engine = "noSTL";
+            nostl::IntArrayList path;
+            int cost = other.shortestPath(src, dest, path);
+            std::vector<int> nodes;
+            for (int i = path.size() - 1; i >= 0; i--) nodes.push_back(path.get(i));
+            PathStatus status = cost == INT_MAX ? PathStatus::NO_PATH : PathStatus::FOUND;
+            if (!agree(reference, status, cost == INT_MAX ? -1 : cost, &nodes, detail)) return false;
+        }
+
+        engine = "BasicGraph<long long, unsigned, LazyMinHeap>";
+        WideGraph::Path widePath = wide.dijkstra(src, dest);
+        std::vector<int> nodes(widePath.nodes.begin(), widePath.nodes.end());
+        if (!agree(reference, widePath.status, widePath.cost, &nodes, detail)) return false;
+
+        engine = "BasicGraph<double, long long>";
+        RealGraph::Path realPath = real.dijkstra(src, dest);
+        nodes.assign(realPath.nodes.begin(), realPath.nodes.end());
+        if (!agree(reference, realPath.status, (long long)realPath.cost, &nodes, detail)) return false;
+
+        engine = "kShortestPaths";
+        std::vector<PathResult> ranked = graph.kShortestPaths(src, dest, RANKED);
+        if (!agree(reference, ranked[0].status, ranked[0].cost, &ranked[0].nodes, detail)) return false;
+        if (reference.found() && !checkRanked(ranked, detail)) return false;
+
+        engine = "alternativeRoutes";
+        ranked = graph.alternativeRoutes(src, dest, RANKED);
+        if (!agree(reference, ranked[0].status, ranked[0].cost, &ranked[0].nodes, detail)) return false;
+        if (reference.found() && !checkAlternatives(ranked, detail)) return false;
+
+        if (reference.status == PathStatus::FOUND || reference.status == PathStatus::NO_PATH) {
+            engine = "reachableWithin";
+            Isochrone area = graph.reachableWithin(src, INT_MAX - 1);
+            long long cost = -1;
+            for (const ReachedCity& city : area.cities) {
+                if (city.city == dest) cost = city.cost;
+            }
+            PathStatus status = cost < 0 ? PathStatus::NO_PATH : PathStatus::FOUND;
+            if (!agree(reference, status, cost, nullptr, detail)) return false;
+        }
+
+        engine = "OverlayRouter";
+        overlay.refresh();
+        PathResult routed = overlay.route(src, dest);
+        if (!agree(reference, routed.status, routed.cost, &routed.nodes, detail)) return false;
+
+        engine = "HubLabels";
+        if (labelsStale) {
+            labels = HubLabels::build(graph, 1);
+            labelsStale = false;
+        }
+        routed = labels->route(src, dest);
+        if (!agree(reference, routed.status, routed.cost, &routed.nodes, detail)) return false;
+        if (reference.found() && labels->distance(src, dest) != reference.cost) {
+            detail = "distance() " + std::to_string(labels->distance(src, dest)) + ", dijkstra " +
+                     std::to_string(reference.cost);
+            return false;
+        }
+        return true;
+    }
+
+    // Every path valid, no two alike, costs non-decreasing, and the costs the
+    // model's k cheapest loopless paths have.
+    bool checkRanked(const std::vector<PathResult>& paths, std::string& detail) {
+        std::set<std::vector<int>> seen;
+        for (size_t i = 0; i < paths.size(); i++) {
+            const PathResult& path = paths[i];
+            detail = model.checkPath(path.nodes, path.src, path.dest, path.cost);
+            if (!detail.empty()) {
+                detail = "path " + std::to_string(i) + ": " + detail;
+                return false;
+            }
+            if (!seen.insert(path.nodes).second) {
+                detail = "path " + std::to_string(i) + " repeats an earlier one";
+                return false;
+            }
+            if (i > 0 && path.cost < paths[i - 1].cost) {
+                detail = "path " + std::to_string(i) + " is cheaper than the one before it";
+                return false;
+            }
+        }
+        std::vector<long long> expected;
+        if (!model.cheapestPaths(paths[0].src, paths[0].dest, RANKED, ENUMERATION_LIMIT, expected)) return true;
+        bool same = expected.size() == paths.size();
+        for (size_t i = 0; same && i < paths.size(); i++) same = expected[i] == paths[i].cost;
+        if (!same) {
+            detail = "costs";
+            for (const PathResult& path : paths) detail += " " + std::to_string(path.cost);
+            detail += ", model";
+            for (long long cost : expected) detail += " " + std::to_string(cost);
+            return false;
+        }
+        return true;
+    }
+
+    // Every route valid and distinct, within the stretch bound of the first
+    // (shortest) one, and sharing at most the sharing bound with the routes
+    // before it.
+    bool checkAlternatives(const std::vector<PathResult>& routes, std::string& detail) {
+        long long shortest = routes[0].cost;
+        long long maxCost = (long long)(shortest * Graph::ALT_MAX_STRETCH);
+        long long maxShared = (long long)(shortest * Graph::ALT_MAX_SHARING);
+        std::set<std::pair<int, int>> used;
+        for (size_t i = 0; i < routes.size(); i++) {
+            const PathResult& route = routes[i];
+            detail = model.checkPath(route.nodes, route.src, route.dest, route.cost);
+            if (!detail.empty()) {
+                detail = "route " + std::to_string(i) + ": " + detail;
+                return false;
+            }
+            if (route.cost > maxCost) {
+                detail = "route " + std::to_string(i) + " costs " + std::to_string(route.cost) +
+                         ", over the stretch bound " + std::to_string(maxCost);
+                return false;
+            }
+            long long shared = 0;
+            bool same = i > 0;
+            for (size_t n = 0; n + 1 < route.nodes.size(); n++) {
+                std::pair<int, int> key(route.nodes[n], route.nodes[n + 1]);
+                if (used.count(key)) {
+                    shared += model.edges.at(key).cost();
+                } else {
+                    same = false;
+                }
+            }
+            if (same || shared > maxShared) {
+                detail = "route " + std::to_string(i) + " shares " + std::to_string(shared) +
+                         " with the routes before it, over " + std::to_string(maxShared);
+                return false;
+            }
+            for (size_t n = 0; n + 1 < route.nodes.size(); n++) {
+                used.insert(std::make_pair(route.nodes[n], route.nodes[n + 1]));
+            }
+        }
+        return true;
+    }
+
+    // dijkstra under an M query's cost model against the model's search,
+    // priced the same way.
+    // dijkstra() on engine under query's cost model.
+    template <class Engine>
+    static typename Engine::Path priced(const Engine& engine, const Op& query, std::string& name) {
+        if (query.c == Op::DISTANCE) {
+            name = "dijkstra(DistanceModel)";
+            return engine.dijkstra(query.a, query.b, DistanceModel());
+        } else if (query.c == Op::TOLL) {
+            name = "dijkstra(TollModel)";
+            return engine.dijkstra(query.a, query.b, TollModel<uint32_t>(query.d));
+        }
+        name = "dijkstra(TruckModel)";
+        return engine.dijkstra(query.a, query.b, TruckModel(query.d, query.e));
+    }
+
+    bool compareModel(const Op& query, std::string& engine, std::string& detail) {
+        PathResult result = priced(graph, query, engine);
+        std::pair<PathStatus, long long> expected = model.query(query.a, query.b, -1, &query);
+        if (result.status != expected.first || (result.found() && result.cost != expected.second)) {
+            detail = "got " + describe(result.status, result.cost) + ", model " +
+                     describe(expected.first, expected.second);
+            return false;
+        }
+        if (result.status == PathStatus::FOUND) {
+            detail = model.checkPath(result.nodes, query.a, query.b, result.cost, -1, &query);
+            if (!detail.empty()) return false;
+        }
+
+        WideGraph::Path widePath = priced(wide, query, engine);
+        engine = "BasicGraph<long long, unsigned, LazyMinHeap>::" + engine;
+        if (!agree(result, widePath.status, widePath.cost, nullptr, detail)) return false;
+        if (widePath.status == PathStatus::FOUND) {
+            std::vector<int> nodes(widePath.nodes.begin(), widePath.nodes.end());
+            detail = model.checkPath(nodes, query.a, query.b, widePath.cost, -1, &query);
+            return detail.empty();
+        }
+        return true;
+    }
+
+    // The reply --batch gives to the query's command against the one its
+    // answer on graph calls for.
+    bool compareReply(const Op& query, std::string& engine, std::string& detail) {
+        PathResult answer = query.kind == 'R'   ? graph.dijkstra(query.a, query.b)
+                            : query.kind == 'D' ? graph.dijkstraAt(query.a, query.b, query.c)
+                                                : priced(graph, query, engine);
+        std::string expected;
+        switch (answer.status) {
+            case PathStatus::FOUND:
+            case PathStatus::SAME_CITY:
+                expected = "OK " + std::to_string(answer.cost) + " " + std::to_string(answer.hops);
+                for (int id : answer.nodes) expected += " " + std::to_string(id);
+                break;
+            case PathStatus::NO_PATH: expected = "NOPATH"; break;
+            case PathStatus::EMPTY_GRAPH: expected = "ERR empty graph"; break;
+            case PathStatus::INVALID_DEPARTURE: expected = "ERR departure must be 00:00-23:59"; break;
+            default: expected = "ERR unknown city"; break;
+        }
+
+        engine = "CommandProcessor";
+        std::string line = query.command(), reply;
+        commands.execute(line.data(), line.data() + line.size(), reply);
+        if (reply != expected + "\n") {
+            if (!reply.empty() && reply.back() == '\n') reply.pop_back();
+            detail = "replied \"" + reply + "\", expected \"" + expected + "\" (" + statusName(answer.status) + ")";
+            return false;
+        }
+        return true;
+    }
+
+    // dijkstraAt against the model's time-dependent search; reachability is
+    // the same as without profiles.
+    bool compareAt(int src, int dest, int departure, std::string& engine, std::string& detail) {
+        engine = "dijkstraAt";
+        PathResult timed = graph.dijkstraAt(src, dest, departure);
+        PathResult reference = graph.dijkstra(src, dest);
+        if (reference.status == PathStatus::FOUND || reference.status == PathStatus::SAME_CITY ||
+            reference.status == PathStatus::NO_PATH) {
+            if (departure < 0 || departure >= TravelProfiles::DAY_MINUTES) {
+                reference = PathResult(PathStatus::INVALID_DEPARTURE, src, dest);
+            }
+        }
+        if (reference.found()) {
+            reference.cost = model.query(src, dest, departure).second;
+        }
+        if (!agree(reference, timed.status, timed.cost, nullptr, detail)) return false;
+        if (timed.status == PathStatus::FOUND) {
+            detail = model.checkPath(timed.nodes, src, dest, timed.cost, departure);
+            if (!detail.empty()) return false;
+        }
+
+        engine = "BasicGraph<long long, unsigned, LazyMinHeap>::dijkstraAt";
+        WideGraph::Path widePath = wide.dijkstraAt(src, dest, departure);
+        return agree(reference, widePath.status, widePath.cost, nullptr, detail);
+    }
+};
+
+// A random script: a few cities first, then a mix weighted towards routes
+// and queries. IDs reach one past the last city, and distances and levels
+// stray out of range now and then, so rejections are exercised too.
+static std::vector<Op> randomScript(std::mt19937& rng, int length) {
+    auto roll = [&](int bound) { return (int)(rng() % bound); };
+    std::vector<Op> ops;
+    std::vector<std::pair<int, int>> routes;
+    int cities = 0;
+    auto city = [&]() { return roll(cities + 2); };
+    auto distance = [&]() {
+        int kind = roll(20);
+        if (kind == 0) return 0;
+        if (kind == 1) return (int)Route::MAX_DISTANCE + roll(2);
+        return 1 + roll(kind < 5 ? 1000 : 20);
+    };
+    auto level = [&]() { return roll(20) == 0 ? 11 : roll(11); };
+    auto addCity = [&]() {
+        Op op('C');
+        op.name = "c" + std::to_string(roll(8) == 0 && cities ? roll(cities) : cities);
+        ops.push_back(op);
+        cities++;
+    };
+
+    // Mostly a route added so far (either way), else any two cities.
+    auto onRoute = [&](Op op) {
+        op.a = city();
+        op.b = city();
+        if (!routes.empty() && roll(4) != 0) {
+            const std::pair<int, int>& route = routes[roll(routes.size())];
+            op.a = roll(2) ? route.first : route.second;
+            op.b = op.a == route.first ? route.second : route.first;
+        }
+        return op;
+    };
+
+    for (int i = roll(20) == 0 ? 0 : 2 + roll(6); i > 0; i--) addCity();
+    for (int i = 0; i < length; i++) {
+        int kind = roll(100);
+        if (kind < 5) {
+            addCity();
+        } else if (kind < 35) {
+            ops.push_back(Op('E', city(), city(), distance(), roll(3) == 0));
+            routes.push_back(std::make_pair(ops.back().a, ops.back().b));
+        } else if (kind < 42) {
+            ops.push_back(Op('B', city(), city()));
+        } else if (kind < 49) {
+            ops.push_back(Op('U', city(), city()));
+        } else if (kind < 60) {
+            ops.push_back(Op('T', city(), city(), level()));
+        } else if (kind < 64) {
+            Op op('F');
+            for (int n = 1 + roll(4); n > 0; n--) op.feed.push_back(TrafficUpdate(city(), city(), level()));
+            ops.push_back(op);
+        } else if (kind < 67) {
+            // Up to four breakpoints at random minutes; steep drops between
+            // close ones make some of them non-FIFO, and get them rejected.
+            Op op = onRoute(Op('P'));
+            std::set<int> minutes;
+            for (int n = roll(5); n > 0; n--) minutes.insert(roll(1440));
+            for (int minute : minutes) op.points.push_back(ProfilePoint(minute, 1 + roll(kind < 66 ? 40 : 2000)));
+            ops.push_back(op);
+        } else if (kind < 69) {
+            ops.push_back(onRoute(Op('O', 0, 0, roll(20) == 0 ? -1 : roll(50))));
+        } else if (kind < 71) {
+            ops.push_back(onRoute(Op('L', 0, 0, roll(20) == 0 ? 0 : 200 + roll(300), 5000 + roll(35000))));
+        } else if (kind < 76) {
+            ops.push_back(Op('D', city(), city(), roll(30) == 0 ? 1440 : roll(1440)));
+        } else if (kind < 80) {
+            int model = roll(3);
+            int first = model == Op::TOLL ? roll(256) : 200 + roll(300);
+            ops.push_back(Op('M', city(), city(), model, first, 5000 + roll(35000)));
+        } else {
+            ops.push_back(Op('R', city(), city()));
+        }
+    }
+    return ops;
+}
+
+static bool fails(const std::vector<Op>& ops, const std::string& engine) {
+    Mismatch mismatch;
+    return Harness().run(ops, mismatch) && mismatch.engine == engine;
+}
+
+// Delta debugging: removes ever smaller chunks while the same engine still
+// disagrees somewhere.
+static std::vector<Op> minimize(std::vector<Op> ops, const std::string& engine) {
+    size_t chunks = 2;
+    while (ops.size() >= 2) {
+        size_t size = (ops.size() + chunks - 1) / chunks;
+        bool reduced = false;
+        for (size_t start = 0; start < ops.size(); start += size) {
+            std::vector<Op> rest(ops.begin(), ops.begin() + start);
+            rest.insert(rest.end(), ops.begin() + std::min(ops.size(), start + size), ops.end());
+            if (!rest.empty() && fails(rest, engine)) {
+                ops = rest;
+                chunks = std::max<size_t>(chunks - 1, 2);
+                reduced = true;
+                break;
+            }
+        }
+        if (reduced) continue;
+        if (chunks >= ops.size()) break;
+        chunks = std::min(ops.size(), chunks * 2);
+    }
+    return ops;
+}
+
+int main(int argc, char** argv) {
+    int cases = 300, length = 60;
+    unsigned seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        int value = atoi(argv[i + 1]);
+        if (option == "--cases") cases = value;
+        else if (option == "--ops") length = value;
+        else if (option == "--seed") seed = value;
+        else {
+            fprintf(stderr, "unknown option %s\n", option.c_str());
+            return 1;
+        }
+    }
+    // noSTL.cpp reports every call on cout.
+    std::cout.setstate(std::ios::badbit);
+
+    std::mt19937 rng(seed);
+    long long queries = 0;
+    for (int c = 0; c < cases; c++) {
+        std::vector<Op> ops = randomScript(rng, length);
+        for (const Op& op : ops) queries += op.kind == 'R' || op.kind == 'D' || op.kind == 'M';
+        Mismatch mismatch;
+        if (!Harness().run(ops, mismatch)) continue;
+
+        fprintf(stderr, "case %d (seed %u): %s disagrees at command %zu: %s\n", c, seed, mismatch.engine.c_str(),
+                mismatch.op + 1, mismatch.detail.c_str());
+        ops.resize(mismatch.op + 1);
+        std::vector<Op> small = minimize(ops, mismatch.engine);
+        Harness().run(small, mismatch);
+        fprintf(stderr, "minimized to %zu commands; %s: %s\n", small.size(), mismatch.engine.c_str(),
+                mismatch.detail.c_str());
+        fprintf(stderr, "reproduce with ./main --batch < repro.txt, repro.txt:\n");
+        for (const Op& op : small) printf("%s\n", op.command().c_str());
+        return 1;
+    }
+    fprintf(stderr, "%d cases, %lld queries: all engines agree\n", cases, queries);
+    return 0;
+}
@@ -0,0 +1,144 @@
+// Memory footprint and relaxation throughput of the packed Route layout
+// against the previous std::list<Route> layout (three ints + bool per edge).
+//
+// Build:  g++ -O2 -std=c++17 -pthread -o edge_layout_bench bench/edge_layout_bench.cpp
+// Run:    ./edge_layout_bench legacy 10000000
+//         ./edge_layout_bench packed 10000000
+//
+// Each layout is measured in its own process so the RSS numbers don't mix.
+
+#include "../spf.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <random>
+
+class LegacyRoute {
+public:
+    int neighbor;
+    int distance;
+    int traffic;
+    bool isBlocked;
+
+    LegacyRoute(int n, int d) : neighbor(n), distance(d), traffic(0), isBlocked(false) {}
+};
+
+static long residentKb() {
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    long pages = 0, rss = 0;
+    if (fscanf(f, "%ld %ld", &pages, &rss) != 2) rss = 0;
+    fclose(f);
+    return rss * 4;
+}
+
+// The Graph::dijkstra relaxation loop, parameterised on the edge layout so
+// both runs pay for exactly the same hash-map and heap work.
+template <class Adjacency, class EdgeCost>
+static int sweep(Adjacency& adj, int cityCount, int src, EdgeCost edgeCost) {
+    std::unordered_map<int, int> parents;
+    std::unordered_map<int, int> distances;
+    MinHeap minHeap;
+    for (int id = 1; id <= cityCount; id++) distances[id] = INT_MAX;
+    distances[src] = 0;
+    parents[src] = src;
+    minHeap.push(0, src);
+    int settled = 0;
+    while (!minHeap.empty()) {
+        std::pair<int, int> current = minHeap.top();
+        minHeap.pop();
+        int node = current.second;
+        if (current.first > distances[node]) continue;
+        settled++;
+        for (auto& route : adj[node]) {
+            int effectiveCost;
+            if (!edgeCost(route, effectiveCost)) continue;
+            int nbr = route.neighbor;
+            if (distances[node] + effectiveCost < distances[nbr]) {
+                distances[nbr] = distances[node] + effectiveCost;
+                parents[nbr] = node;
+                minHeap.push(distances[nbr], nbr);
+            }
+        }
+    }
+    return settled;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || (strcmp(argv[1], "legacy") != 0 && strcmp(argv[1], "packed") != 0)) {
+        std::cerr << "usage: " << argv[0] << " <legacy|packed> [edges] [queries]\n";
+        return 1;
+    }
+    bool legacy = strcmp(argv[1], "legacy") == 0;
+    long edges = argc > 2 ? atol(argv[2]) : 10000000;
+    int queries = argc > 3 ? atoi(argv[3]) : 3;
+
+    // Undirected routes, each stored in both directions, average degree ~10.
+    int cityCount = (int)std::max(2L, edges / 10);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pickCity(1, cityCount);
+    std::uniform_int_distribution<int> pickDistance(1, 1000);
+    std::uniform_int_distribution<int> pickTraffic(0, 10);
+
+    long before = residentKb();
+    auto buildStart = std::chrono::steady_clock::now();
+
+    std::unordered_map<int, std::list<LegacyRoute>> legacyAdj;
+    std::unordered_map<int, std::vector<Route>> packedAdj;
+    for (int id = 1; id <= cityCount; id++) {
+        if (legacy) legacyAdj[id];
+        else packedAdj[id];
+    }
+    for (long e = 0; e + 1 < edges; e += 2) {
+        int u = pickCity(rng), v = pickCity(rng);
+        if (u == v) v = u % cityCount + 1;
+        int d = pickDistance(rng), t = pickTraffic(rng);
+        bool blocked = t >= 8;
+        if (legacy) {
+            LegacyRoute a(v, d), b(u, d);
+            a.traffic = b.traffic = t;
+            a.isBlocked = b.isBlocked = blocked;
+            legacyAdj[u].push_back(a);
+            legacyAdj[v].push_back(b);
+        } else {
+            Route a(v, d), b(u, d);
+            a.setTraffic(t); b.setTraffic(t);
+            a.setBlocked(blocked); b.setBlocked(blocked);
+            packedAdj[u].push_back(a);
+            packedAdj[v].push_back(b);
+        }
+    }
+    double buildSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+    long after = residentKb();
+
+    auto queryStart = std::chrono::steady_clock::now();
+    for (int q = 0; q < queries; q++) {
+        int src = pickCity(rng);
+        if (legacy) {
+            sweep(legacyAdj, cityCount, src, [](LegacyRoute& route, int& effectiveCost) {
+                if (route.isBlocked) return false;
+                effectiveCost = calculateEffectiveCost(route.distance, route.traffic);
+                return true;
+            });
+        } else {
+            sweep(packedAdj, cityCount, src, [](Route& route, int& effectiveCost) {
+                if (route.cost == Route::BLOCKED_COST) return false;
+                effectiveCost = route.cost;
+                return true;
+            });
+        }
+    }
+    double querySec = std::chrono::duration<double>(std::chrono::steady_clock::now() - queryStart).count();
+
+    double edgeMb = (after - before) / 1024.0;
+    printf("layout=%s edges=%ld cities=%d sizeof(route)=%zu\n", argv[1], edges, cityCount,
+           legacy ? sizeof(LegacyRoute) : sizeof(Route));
+    printf("  build: %.2fs, graph RSS: %.1f MB (%.1f bytes/edge incl. hash buckets)\n",
+           buildSec, edgeMb, (after - before) * 1024.0 / edges);
+    printf("  full sweeps: %d in %.2fs (%.2f M edges relaxed/s)\n",
+           queries, querySec, queries * (double)edges / querySec / 1e6);
+    return 0;
+}
@@ -0,0 +1,294 @@
+// One engine's run of the shared benchmark workload, printed as a single
+// JSON object. The same source is built once per engine, selecting it with
+// a define; bench/engine_bench.sh builds them all, runs each on the same
+// graph and seed and collects the objects.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -o engine_bench_main bench/engine_bench.cpp
+//         g++ -O2 -std=c++17 -pthread -DSPF_ENGINE_NOSTL -o engine_bench_noSTL bench/engine_bench.cpp
+// Run:    ./engine_bench_main --graph graph.txt [--queries N] [--batch N] [--mutations N]
+//                             [--threads N] [--seed S]
+//
+// The graph is a saveToFile text file (bench/graphgen.cpp writes them).
+// Phases, in order:
+//   load       the file into a queryable graph by the engine's own route:
+//              noSTL's loadFromFile, or for main.cpp parsing plus its bulk
+//              addCities/addRoutes/applyTrafficBatch and blockRoute
+//   query      --queries random pairs one at a time, each timed
+//   batch      --batch random pairs as fast as the engine allows: on
+//              --threads threads if it can be queried concurrently
+//   mutation   --mutations traffic changes (0..7), blocks and unblocks on
+//              random routes, one call each
+// Query costs are summed into checksums, before and after the mutations,
+// so engines given the same workload must print the same ones. Peak RSS is
+// the process high-water mark after loading and at the end.
+//
+// Adding an engine: one more #elif with an Engine adapter below, and its
+// name in bench/engine_bench.sh.
+
+#if defined(SPF_ENGINE_NOSTL)
+#define SPF_NO_MAIN
+#include "../noSTL.cpp"
+#else
+#include "../spf.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sys/resource.h>
+#include <thread>
+#include <vector>
+
+// The parts of a saveToFile text file the workload needs: city IDs and
+// names, and one line per directed route.
+class GraphFile {
+public:
+    class Line {
+    public:
+        int from, to, distance, traffic;
+        bool blocked;
+    };
+
+    std::vector<int> ids;
+    std::vector<std::string> names;
+    std::vector<Line> lines;
+
+    bool read(const std::string& path) {
+        FILE* file = fopen(path.c_str(), "r");
+        if (!file) return false;
+        int next, count;
+        char name[4096];
+        bool ok = fscanf(file, " NEXT_ID %d CITIES %d", &next, &count) == 2;
+        for (int i = 0; ok && i < count; i++) {
+            int id;
+            ok = fscanf(file, "%d %4095[^\n]", &id, name) == 2;
+            ids.push_back(id);
+            names.push_back(name);
+        }
+        ok = ok && fscanf(file, " EDGES %d", &count) == 1;
+        lines.reserve(ok ? count : 0);
+        for (int i = 0; ok && i < count; i++) {
+            Line line;
+            int blocked;
+            ok = fscanf(file, "%d %d %d %d %d", &line.from, &line.to, &line.distance, &line.traffic, &blocked) == 5;
+            line.blocked = blocked != 0;
+            lines.push_back(line);
+        }
+        fclose(file);
+        return ok;
+    }
+};
+
+#if defined(SPF_ENGINE_NOSTL)
+class Engine {
+public:
+    static const char* name() { return "noSTL"; }
+    static bool concurrent() { return false; }
+
+    Engine() {
+        // Every call reports on cout; keep the formatting out of the timings.
+        std::cout.setstate(std::ios::badbit);
+    }
+
+    bool load(const std::string& path, const GraphFile& file) {
+        graph.loadFromFile(path);
+        return file.ids.empty() || graph.findCityId(file.names[0]) == file.ids[0];
+    }
+
+    long long route(int src, int dest) {
+        if (src == dest) return 0;
+        IntArrayList path;
+        int cost = graph.shortestPath(src, dest, path);
+        return cost == INT_MAX ? -1 : cost;
+    }
+
+    void setTraffic(int u, int v, int level) { graph.setTraffic(u, v, level); }
+    void block(int u, int v) { graph.blockRoute(u, v); }
+    void unblock(int u, int v) { graph.unblockRoute(u, v); }
+
+private:
+    Graph graph;
+};
+#else
+class Engine {
+public:
+    static const char* name() { return "main"; }
+    static bool concurrent() { return true; }
+
+    // City IDs are handed out in order, so file IDs map through a table.
+    bool load(const std::string& path, const GraphFile&) {
+        GraphFile file;
+        if (!file.read(path)) return false;
+        std::vector<int> order(file.ids.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return file.ids[a] < file.ids[b]; });
+        std::vector<std::string> names;
+        for (int i : order) names.push_back(file.names[i]);
+        std::vector<int> added = graph.addCities(names);
+        int maxId = file.ids.empty() ? 0 : *std::max_element(file.ids.begin(), file.ids.end());
+        idOf.assign(maxId + 1, -1);
+        for (size_t i = 0; i < order.size(); i++) idOf[file.ids[order[i]]] = added[i];
+
+        std::vector<NewRoute> routes;
+        std::vector<TrafficUpdate> traffic;
+        routes.reserve(file.lines.size());
+        for (const GraphFile::Line& line : file.lines) {
+            routes.push_back(NewRoute(idOf[line.from], idOf[line.to], line.distance, true));
+            if (line.traffic) traffic.push_back(TrafficUpdate(idOf[line.from], idOf[line.to], line.traffic));
+        }
+        graph.addRoutes(routes);
+        graph.applyTrafficBatch(traffic);
+        for (const GraphFile::Line& line : file.lines) {
+            if (line.blocked) graph.blockRoute(idOf[line.from], idOf[line.to]);
+        }
+        return true;
+    }
+
+    long long route(int src, int dest) const { return graph.dijkstra(idOf[src], idOf[dest]).cost; }
+
+    void setTraffic(int u, int v, int level) { graph.setTraffic(idOf[u], idOf[v], level); }
+    void block(int u, int v) { graph.blockRoute(idOf[u], idOf[v]); }
+    void unblock(int u, int v) { graph.unblockRoute(idOf[u], idOf[v]); }
+
+private:
+    Graph graph;
+    std::vector<int> idOf;
+};
+#endif
+
+static double percentile(std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+static long peakRssKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    std::string path;
+    int queries = 1000, batch = 10000, mutations = 100000;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    unsigned long long seed = 42;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        const char* value = argv[i + 1];
+        if (option == "--graph") path = value;
+        else if (option == "--queries") queries = atoi(value);
+        else if (option == "--batch") batch = atoi(value);
+        else if (option == "--mutations") mutations = atoi(value);
+        else if (option == "--threads") threads = std::max(1, atoi(value));
+        else if (option == "--seed") seed = strtoull(value, nullptr, 10);
+        else {
+            fprintf(stderr, "unknown option %s\n", option.c_str());
+            return 1;
+        }
+    }
+    GraphFile file;
+    if (path.empty() || !file.read(path) || file.ids.empty()) {
+        fprintf(stderr, "usage: %s --graph FILE (a saveToFile text file with cities)\n", argv[0]);
+        return 1;
+    }
+
+    // Drawn from the raw mt19937_64 output, which the standard fixes, so
+    // every engine gets the same pairs and mutations.
+    std::mt19937_64 rng(seed);
+    auto pick = [&](size_t bound) { return (size_t)(rng() % bound); };
+    std::vector<std::pair<int, int>> pairs(std::max(queries, batch));
+    for (std::pair<int, int>& query : pairs) {
+        query = std::make_pair(file.ids[pick(file.ids.size())], file.ids[pick(file.ids.size())]);
+    }
+
+    Engine engine;
+    auto start = std::chrono::steady_clock::now();
+    if (!engine.load(path, file)) {
+        fprintf(stderr, "%s could not load %s\n", Engine::name(), path.c_str());
+        return 1;
+    }
+    double loadSeconds = secondsSince(start);
+    long loadRss = peakRssKb();
+
+    // The first searches size scratch arrays; keep them out of the timings.
+    for (int i = 0; i < std::min(queries, 3); i++) engine.route(pairs[i].first, pairs[i].second);
+
+    std::vector<double> latencies;
+    long long checksum = 0;
+    for (int i = 0; i < queries; i++) {
+        start = std::chrono::steady_clock::now();
+        long long cost = engine.route(pairs[i].first, pairs[i].second);
+        latencies.push_back(secondsSince(start) * 1e6);
+        checksum += cost;
+    }
+    double totalUs = 0;
+    for (double us : latencies) totalUs += us;
+    std::sort(latencies.begin(), latencies.end());
+
+    int batchThreads = Engine::concurrent() ? std::min(threads, std::max(1, batch)) : 1;
+    std::vector<long long> partial(batchThreads, 0);
+    start = std::chrono::steady_clock::now();
+    {
+        std::vector<std::thread> workers;
+        for (int w = 0; w < batchThreads; w++) {
+            workers.emplace_back([&, w]() {
+                for (int i = w; i < batch; i += batchThreads) partial[w] += engine.route(pairs[i].first, pairs[i].second);
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+    }
+    double batchSeconds = secondsSince(start);
+    long long batchChecksum = 0;
+    for (long long sum : partial) batchChecksum += sum;
+
+    if (file.lines.empty()) mutations = 0;
+    int traffic = 0, blocks = 0, unblocks = 0;
+    std::vector<int> kinds(mutations), targets(mutations), levels(mutations);
+    for (int i = 0; i < mutations; i++) {
+        uint64_t roll = pick(100);
+        kinds[i] = roll < 70 ? 0 : roll < 85 ? 1 : 2;
+        targets[i] = pick(file.lines.size());
+        levels[i] = pick(8);
+    }
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < mutations; i++) {
+        const GraphFile::Line& line = file.lines[targets[i]];
+        if (kinds[i] == 0) {
+            engine.setTraffic(line.from, line.to, levels[i]);
+            traffic++;
+        } else if (kinds[i] == 1) {
+            engine.block(line.from, line.to);
+            blocks++;
+        } else {
+            engine.unblock(line.from, line.to);
+            unblocks++;
+        }
+    }
+    double mutationSeconds = secondsSince(start);
+
+    long long checksumAfter = 0;
+    for (int i = 0; i < queries; i++) checksumAfter += engine.route(pairs[i].first, pairs[i].second);
+
+    printf("{\"engine\": \"%s\", \"graph\": \"%s\", \"cities\": %zu, \"routes\": %zu, \"seed\": %llu, "
+           "\"load\": {\"seconds\": %.6f, \"peak_rss_kb\": %ld}, "
+           "\"query\": {\"count\": %d, \"mean_us\": %.3f, \"p50_us\": %.3f, \"p90_us\": %.3f, \"p99_us\": %.3f, "
+           "\"p999_us\": %.3f, \"max_us\": %.3f, \"checksum\": %lld}, "
+           "\"batch\": {\"count\": %d, \"threads\": %d, \"seconds\": %.6f, \"queries_per_second\": %.1f, "
+           "\"checksum\": %lld}, "
+           "\"mutation\": {\"count\": %d, \"traffic\": %d, \"block\": %d, \"unblock\": %d, \"seconds\": %.6f, "
+           "\"per_second\": %.1f, \"checksum_after\": %lld}, "
+           "\"peak_rss_kb\": %ld}\n",
+           Engine::name(), path.c_str(), file.ids.size(), file.lines.size(), seed, loadSeconds, loadRss, queries,
+           queries ? totalUs / queries : 0, percentile(latencies, 0.5), percentile(latencies, 0.9),
+           percentile(latencies, 0.99), percentile(latencies, 0.999), latencies.empty() ? 0 : latencies.back(),
+           checksum, batch, batchThreads, batchSeconds, batchSeconds > 0 ? batch / batchSeconds : 0, batchChecksum,
+           mutations, traffic, blocks, unblocks, mutationSeconds,
+           mutationSeconds > 0 ? mutations / mutationSeconds : 0, checksumAfter, peakRssKb());
+    return 0;
+}
@@ -0,0 +1,74 @@
+#!/bin/sh
+# Runs the same benchmark workload (bench/engine_bench.cpp) on every engine
+# and prints one JSON document: the workload, then each engine's results.
+# The graph comes from bench/graphgen.cpp; any option not listed below is
+# passed to it (--shape, --nodes, --edges, --one-way, --traffic, ...).
+#
+# Run:    bench/engine_bench.sh [--queries N] [--batch N] [--mutations N] [--seed S]
+#                               [graphgen options] > results.json
+# Env:    CXX (default g++), CXXFLAGS (default -O2), BUILD (default
+#         bench-build), ENGINES (default "main noSTL"), BUILT (set to 1 to
+#         run the binaries already in $BUILD, e.g. a CMake build directory)
+#
+# Engines must print the same checksums; a mismatch is reported on stderr
+# and fails the run.
+
+set -e
+cd "$(dirname "$0")/.."
+
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O2}
+BUILD=${BUILD:-bench-build}
+ENGINES=${ENGINES:-main noSTL}
+
+queries=200
+batch=200
+mutations=100000
+seed=42
+generate="--nodes 20000 --one-way 0.2 --traffic skewed --blocked 0.02"
+while [ $# -gt 1 ]; do
+    case "$1" in
+        --queries) queries=$2 ;;
+        --batch) batch=$2 ;;
+        --mutations) mutations=$2 ;;
+        --seed) seed=$2 ;;
+        *) generate="$generate $1 $2" ;;
+    esac
+    shift 2
+done
+
+if [ "$BUILT" != 1 ]; then
+    mkdir -p "$BUILD"
+    $CXX $CXXFLAGS -std=c++17 -o "$BUILD/graphgen" bench/graphgen.cpp
+    for engine in $ENGINES; do
+        case "$engine" in
+            main) define= ;;
+            noSTL) define=-DSPF_ENGINE_NOSTL ;;
+            *) echo "unknown engine $engine" >&2; exit 1 ;;
+        esac
+        $CXX $CXXFLAGS -std=c++17 -pthread $define -o "$BUILD/engine_bench_$engine" bench/engine_bench.cpp
+    done
+fi
+
+graph="$BUILD/engine_bench_graph.txt"
+"$BUILD/graphgen" $generate --seed "$seed" --text "$graph" 2>/dev/null
+
+printf '{"workload": {"generator": "%s", "seed": %s, "queries": %s, "batch": %s, "mutations": %s},\n "engines": [\n' \
+    "$generate" "$seed" "$queries" "$batch" "$mutations"
+reference=
+for engine in $ENGINES; do
+    result=$("$BUILD/engine_bench_$engine" --graph "$graph" --queries "$queries" --batch "$batch" \
+        --mutations "$mutations" --seed "$seed")
+    [ -n "$reference" ] && printf ',\n'
+    printf '  %s' "$result"
+    checksums=$(echo "$result" | grep -o '"checksum[a-z_]*": -*[0-9]*' | tr '\n' ' ')
+    if [ -z "$reference" ]; then
+        reference=$checksums
+    elif [ "$checksums" != "$reference" ]; then
+        echo "checksum mismatch: $engine has $checksums, expected $reference" >&2
+        mismatch=1
+    fi
+done
+printf '\n]}\n'
+rm -f "$graph"
+[ -z "$mismatch" ]
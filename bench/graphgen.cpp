@@ -0,0 +1,523 @@
+// Synthetic road-like graphs for performance work. Three shapes:
+//   grid       a perturbed grid: cities on a jittered lattice, streets to the
+//              right and down, thinned at random or, above two streets per
+//              city, topped up with diagonals
+//   geometric  cities scattered uniformly, a street between pairs closer
+//              than a radius chosen for the requested count
+//   hubs       power-law hub and spoke: each city links to one earlier city
+//              and more extra ones, picked with a strong bias towards the
+//              first cities, which become hubs
+// The output is the same for the same options and seed on any platform:
+// the generator uses its own random numbers and rounding, and attributes
+// (one-way, traffic, blocking) come from a stream of their own, so changing
+// them never changes the streets. City i + 1 is named c<i>, as in the
+// benches. Nothing is held per street, so --edges 100000000 runs in memory
+// proportional to the city count (none at all for grid and hubs).
+//
+// Build:  g++ -O2 -std=c++17 -o graphgen bench/graphgen.cpp
+// Run:    ./graphgen --shape grid --nodes 1000000 --edges 2000000 --text grid.txt --binary grid.bin
+//
+// Options:
+//   --shape S          grid, geometric or hubs (default grid)
+//   --nodes N          cities (default 1000000)
+//   --edges M          routes (default 2 x nodes); exact for grid and hubs,
+//                      geometric stops at M once its radius gives enough
+//   --one-way F        fraction of routes that are one-way, in a random
+//                      direction (default 0)
+//   --traffic D        none, uniform (0..10) or skewed (mostly light, a tail
+//                      up to 10; default none)
+//   --blocked F        fraction of routes blocked (default 0), on top of
+//                      those with traffic 8 or more, which always are
+//   --jitter J         grid perturbation, in lattice spacings (default 0.3)
+//   --skew K           hubs bias: an extra link goes to one of the first
+//                      x of i earlier cities with probability x^(1/K)
+//                      (default 2)
+//   --seed S           (default 42)
+//   --text PATH        the saveToFile format, one line per direction
+//   --binary PATH      the binary format below
+//
+// Binary format, little-endian: "SPFGRAPH", u32 version (1), u32 next city
+// ID, u64 city count, u64 route count; then per city u32 ID, u32 name
+// length and the name bytes; then per route 16 bytes: u32 from, u32 to,
+// u32 distance, u8 traffic, u8 flags (1 one-way, 2 blocked), u16 zero. A
+// two-way route is one record, not two lines as in the text format.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+using namespace std;
+
+static const int MAX_DISTANCE = (1 << 24) - 1;
+// Distance units per lattice spacing (or per unit of the geometric square).
+static const double UNIT = 100;
+
+// splitmix64: tiny, fast and the same everywhere, unlike the distributions
+// in <random>.
+class Random {
+public:
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, bound).
+    uint64_t below(uint64_t bound) { return (uint64_t)(((unsigned __int128)next() * bound) >> 64); }
+
+    // Uniform in [0, 1).
+    double unit() { return (next() >> 11) * 0x1.0p-53; }
+
+    // A value fixed by the seed and key, without advancing any stream.
+    static double hashUnit(uint64_t seed, uint64_t key) {
+        Random one(seed ^ (key * 0xD6E8FEB86659FD93ULL));
+        return one.unit();
+    }
+
+private:
+    uint64_t state;
+};
+
+class Options {
+public:
+    string shape = "grid";
+    long long nodes = 1000000;
+    long long edges = -1;
+    double oneWay = 0;
+    string traffic = "none";
+    double blocked = 0;
+    double jitter = 0.3;
+    double skew = 2;
+    uint64_t seed = 42;
+    string textPath;
+    string binaryPath;
+};
+
+// Buffered writes with hand-rolled integer formatting; the text output for
+// 100M routes is several GB and printf would dominate.
+class Output {
+public:
+    Output() : file(nullptr), used(0) {}
+
+    bool open(const string& path) {
+        file = fopen(path.c_str(), "wb");
+        buffer.resize(1 << 20);
+        return file != nullptr;
+    }
+
+    bool isOpen() const { return file != nullptr; }
+
+    void bytes(const void* data, size_t length) {
+        if (used + length > buffer.size()) flush();
+        if (length > buffer.size()) {
+            fwrite(data, 1, length, file);
+            return;
+        }
+        memcpy(&buffer[used], data, length);
+        used += length;
+    }
+
+    void text(const char* s) { bytes(s, strlen(s)); }
+
+    void number(unsigned long long value) {
+        char digits[24];
+        int at = sizeof(digits);
+        do {
+            digits[--at] = '0' + value % 10;
+            value /= 10;
+        } while (value);
+        bytes(digits + at, sizeof(digits) - at);
+    }
+
+    template <typename T>
+    void raw(T value) { bytes(&value, sizeof(value)); }
+
+    long long position() {
+        flush();
+        return ftell(file);
+    }
+
+    // Overwrites already written bytes at offset.
+    void patch(long long offset, const void* data, size_t length) {
+        flush();
+        long long end = ftell(file);
+        fseek(file, offset, SEEK_SET);
+        fwrite(data, 1, length, file);
+        fseek(file, end, SEEK_SET);
+    }
+
+    bool close() {
+        flush();
+        bool ok = ferror(file) == 0;
+        return fclose(file) == 0 && ok;
+    }
+
+private:
+    FILE* file;
+    vector<char> buffer;
+    size_t used;
+
+    void flush() {
+        if (used) fwrite(buffer.data(), 1, used, file);
+        used = 0;
+    }
+};
+
+// Turns the shapes' streets into routes (direction, one-way, traffic,
+// blocking) and writes them to the requested formats. Counts are patched
+// into the headers at the end, since streets are never held.
+class Writer {
+public:
+    // Width of the zero-padded EDGES count, enough for any int.
+    static const int COUNT_WIDTH = 10;
+
+    long long routes;
+    long long lines;
+
+    Writer(const Options& options)
+        : routes(0), lines(0), options(options), attrs(options.seed ^ 0xA5A5A5A5A5A5A5A5ULL) {}
+
+    bool open() {
+        if (!options.textPath.empty() && !text.open(options.textPath)) return false;
+        if (!options.binaryPath.empty() && !binary.open(options.binaryPath)) return false;
+        return true;
+    }
+
+    void cities(long long count) {
+        if (text.isOpen()) {
+            text.text("NEXT_ID ");
+            text.number(count + 1);
+            text.text("\nCITIES ");
+            text.number(count);
+            text.text("\n");
+        }
+        if (binary.isOpen()) {
+            binary.bytes("SPFGRAPH", 8);
+            binary.raw<uint32_t>(1);
+            binary.raw<uint32_t>(count + 1);
+            binary.raw<uint64_t>(count);
+            routeCountAt = binary.position();
+            binary.raw<uint64_t>(0);
+        }
+        char name[24];
+        for (long long i = 0; i < count; i++) {
+            int length = snprintf(name, sizeof(name), "c%lld", i);
+            if (text.isOpen()) {
+                text.number(i + 1);
+                text.text(" ");
+                text.bytes(name, length);
+                text.text("\n");
+            }
+            if (binary.isOpen()) {
+                binary.raw<uint32_t>(i + 1);
+                binary.raw<uint32_t>(length);
+                binary.bytes(name, length);
+            }
+        }
+        if (text.isOpen()) {
+            text.text("EDGES ");
+            lineCountAt = text.position();
+            text.text(string(COUNT_WIDTH, '0').c_str());
+            text.text("\n");
+        }
+    }
+
+    // A street between graph nodes a and b (city IDs a + 1 and b + 1).
+    void street(long long a, long long b, double length) {
+        int distance = (int)min<double>(MAX_DISTANCE, max(1.0, floor(length * UNIT + 0.5)));
+        bool single = attrs.unit() < options.oneWay;
+        if (attrs.next() & 1) swap(a, b);
+        int traffic = 0;
+        if (options.traffic == "uniform") {
+            traffic = attrs.below(11);
+        } else if (options.traffic == "skewed") {
+            traffic = (int)min(10.0, floor(-log(1 - attrs.unit()) * 2));
+        }
+        // The engines block a route whose traffic reaches 8, so a file with
+        // such a route open is not a state either of them can be in.
+        bool closed = attrs.unit() < options.blocked || traffic >= 8;
+        routes++;
+
+        if (text.isOpen()) {
+            line(a + 1, b + 1, distance, traffic, closed);
+            if (!single) line(b + 1, a + 1, distance, traffic, closed);
+        }
+        lines += single ? 1 : 2;
+        if (binary.isOpen()) {
+            binary.raw<uint32_t>(a + 1);
+            binary.raw<uint32_t>(b + 1);
+            binary.raw<uint32_t>(distance);
+            binary.raw<uint8_t>(traffic);
+            binary.raw<uint8_t>((single ? 1 : 0) | (closed ? 2 : 0));
+            binary.raw<uint16_t>(0);
+        }
+    }
+
+    bool close() {
+        bool ok = true;
+        if (text.isOpen()) {
+            char count[COUNT_WIDTH + 1];
+            snprintf(count, sizeof(count), "%0*lld", COUNT_WIDTH, lines);
+            text.patch(lineCountAt, count, COUNT_WIDTH);
+            ok = text.close() && ok;
+        }
+        if (binary.isOpen()) {
+            uint64_t count = routes;
+            binary.patch(routeCountAt, &count, sizeof(count));
+            ok = binary.close() && ok;
+        }
+        return ok;
+    }
+
+private:
+    const Options& options;
+    Random attrs;
+    Output text;
+    Output binary;
+    long long lineCountAt = 0;
+    long long routeCountAt = 0;
+
+    void line(long long from, long long to, int distance, int traffic, bool closed) {
+        text.number(from);
+        text.text(" ");
+        text.number(to);
+        text.text(" ");
+        text.number(distance);
+        text.text(" ");
+        text.number(traffic);
+        text.text(closed ? " 1\n" : " 0\n");
+    }
+};
+
+// Picks exactly `wanted` of `total` candidates offered one at a time, each
+// set equally likely (Knuth's selection sampling).
+class Selection {
+public:
+    Selection(Random& random, long long wanted, long long total)
+        : random(random), wanted(wanted), left(total) {}
+
+    bool take() {
+        bool chosen = (long long)random.below(left) < wanted;
+        left--;
+        if (chosen) wanted--;
+        return chosen;
+    }
+
+private:
+    Random& random;
+    long long wanted;
+    long long left;
+};
+
+static void grid(const Options& options, Writer& out) {
+    long long n = options.nodes;
+    long long cols = (long long)ceil(sqrt((double)n));
+    auto x = [&](long long i) { return i % cols + options.jitter * (Random::hashUnit(options.seed, 2 * i) - 0.5); };
+    auto y = [&](long long i) {
+        return i / cols + options.jitter * (Random::hashUnit(options.seed, 2 * i + 1) - 0.5);
+    };
+    auto length = [&](long long a, long long b) { return hypot(x(a) - x(b), y(a) - y(b)); };
+
+    // Candidates in row-major order: right and down first, then the two
+    // diagonals, which are only used above two streets per city.
+    long long straight = 0, diagonal = 0;
+    for (long long i = 0; i < n; i++) {
+        long long column = i % cols;
+        straight += (column + 1 < cols && i + 1 < n) + (i + cols < n);
+        diagonal += (column + 1 < cols && i + cols + 1 < n) + (column > 0 && i + cols - 1 < n);
+    }
+    long long wanted = min(options.edges, straight + diagonal);
+    Random random(options.seed);
+    Selection straights(random, min(wanted, straight), straight);
+    Selection diagonals(random, max(0LL, wanted - straight), diagonal);
+    for (long long i = 0; i < n; i++) {
+        long long column = i % cols;
+        if (column + 1 < cols && i + 1 < n && straights.take()) out.street(i, i + 1, length(i, i + 1));
+        if (i + cols < n && straights.take()) out.street(i, i + cols, length(i, i + cols));
+        if (column + 1 < cols && i + cols + 1 < n && diagonals.take()) {
+            out.street(i, i + cols + 1, length(i, i + cols + 1));
+        }
+        if (column > 0 && i + cols - 1 < n && diagonals.take()) out.street(i, i + cols - 1, length(i, i + cols - 1));
+    }
+}
+
+// Cities at hashed positions in a square of area n (one city per unit area),
+// bucketed into cells one radius wide. Pairs are visited cell by cell, and
+// each pair once, from its lower-indexed cell.
+class Scatter {
+public:
+    Scatter(const Options& options) : n(options.nodes), side(sqrt((double)options.nodes)), xs(n), ys(n) {
+        for (long long i = 0; i < n; i++) {
+            xs[i] = Random::hashUnit(options.seed, 2 * i) * side;
+            ys[i] = Random::hashUnit(options.seed, 2 * i + 1) * side;
+        }
+    }
+
+    void bucket(double radius) {
+        this->radius = radius;
+        cells = max(1LL, (long long)(side / radius));
+        first.assign(cells * cells + 1, 0);
+        for (long long i = 0; i < n; i++) first[cellOf(i) + 1]++;
+        for (long long c = 0; c < cells * cells; c++) first[c + 1] += first[c];
+        members.resize(n);
+        vector<long long> fill(first.begin(), first.end() - 1);
+        for (long long i = 0; i < n; i++) members[fill[cellOf(i)]++] = i;
+    }
+
+    template <typename Visit>
+    void forEachPair(Visit visit) const {
+        static const int NEIGHBORS[5][2] = {{0, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+        double limit = radius * radius;
+        for (long long cy = 0; cy < cells; cy++) {
+            for (long long cx = 0; cx < cells; cx++) {
+                long long here = cy * cells + cx;
+                for (const int* offset : NEIGHBORS) {
+                    long long ox = cx + offset[0], oy = cy + offset[1];
+                    if (ox < 0 || ox >= cells || oy >= cells) continue;
+                    long long there = oy * cells + ox;
+                    for (long long p = first[here]; p < first[here + 1]; p++) {
+                        long long a = members[p];
+                        for (long long q = here == there ? p + 1 : first[there]; q < first[there + 1]; q++) {
+                            long long b = members[q];
+                            double dx = xs[a] - xs[b], dy = ys[a] - ys[b];
+                            double squared = dx * dx + dy * dy;
+                            if (squared < limit) visit(a, b, sqrt(squared));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    long long n;
+    double side;
+    vector<float> xs, ys;
+    double radius = 1;
+    long long cells = 1;
+    vector<long long> first;
+    vector<uint32_t> members;
+
+    long long cellOf(long long i) const {
+        long long cx = min(cells - 1, (long long)(xs[i] / side * cells));
+        long long cy = min(cells - 1, (long long)(ys[i] / side * cells));
+        return cy * cells + cx;
+    }
+};
+
+static void geometric(const Options& options, Writer& out) {
+    Scatter scatter(options);
+    // At unit density a radius r gives about n * pi * r^2 / 2 pairs, fewer
+    // near the edges; start a little above and widen until there are enough.
+    double radius = sqrt(2.0 * options.edges / (M_PI * options.nodes)) * 1.05;
+    long long candidates = 0;
+    for (int attempt = 0; attempt < 20; attempt++) {
+        scatter.bucket(radius);
+        candidates = 0;
+        scatter.forEachPair([&](long long, long long, double) { candidates++; });
+        if (candidates >= options.edges) break;
+        radius *= 1.1;
+    }
+    Random random(options.seed);
+    Selection chosen(random, min(options.edges, candidates), candidates);
+    scatter.forEachPair([&](long long a, long long b, double length) {
+        if (chosen.take()) out.street(a, b, length);
+    });
+}
+
+static void hubs(const Options& options, Writer& out) {
+    long long n = options.nodes;
+    double side = sqrt((double)n);
+    auto x = [&](long long i) { return Random::hashUnit(options.seed, 2 * i) * side; };
+    auto y = [&](long long i) { return Random::hashUnit(options.seed, 2 * i + 1) * side; };
+    Random random(options.seed);
+    // Among the i earlier cities, the first x are chosen with probability
+    // (x / i)^(1 / skew).
+    auto earlier = [&](long long i) { return min(i - 1, (long long)(i * pow(random.unit(), options.skew))); };
+
+    // City i gets one spoke plus its share of the extra links, spread so the
+    // total is exact. A city can't link the same earlier city twice; links
+    // the first cities have no room for are owed to the next ones.
+    long long extra = max(0LL, options.edges - (n - 1)), owed = 0;
+    vector<long long> linked;
+    for (long long i = 1; i < n && out.routes < options.edges; i++) {
+        long long links = 1 + (extra * i / (n - 1) - extra * (i - 1) / (n - 1)) + owed;
+        owed = max(0LL, links - i);
+        links = min(links, min(i, options.edges - out.routes));
+        linked.clear();
+        for (int attempt = 0; (long long)linked.size() < links && attempt < 8 * links; attempt++) {
+            long long j = earlier(i);
+            if (find(linked.begin(), linked.end(), j) == linked.end()) linked.push_back(j);
+        }
+        for (long long j = 0; (long long)linked.size() < links; j++) {
+            if (find(linked.begin(), linked.end(), j) == linked.end()) linked.push_back(j);
+        }
+        for (long long j : linked) out.street(j, i, hypot(x(i) - x(j), y(i) - y(j)));
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string option = argv[i];
+        const char* value = argv[i + 1];
+        if (option == "--shape") options.shape = value;
+        else if (option == "--nodes") options.nodes = atoll(value);
+        else if (option == "--edges") options.edges = atoll(value);
+        else if (option == "--one-way") options.oneWay = atof(value);
+        else if (option == "--traffic") options.traffic = value;
+        else if (option == "--blocked") options.blocked = atof(value);
+        else if (option == "--jitter") options.jitter = atof(value);
+        else if (option == "--skew") options.skew = atof(value);
+        else if (option == "--seed") options.seed = strtoull(value, nullptr, 10);
+        else if (option == "--text") options.textPath = value;
+        else if (option == "--binary") options.binaryPath = value;
+        else {
+            fprintf(stderr, "unknown option %s\n", option.c_str());
+            return 1;
+        }
+    }
+    if (options.edges < 0) options.edges = 2 * options.nodes;
+    if (options.nodes < 1 || options.nodes >= INT32_MAX) {
+        fprintf(stderr, "--nodes must be between 1 and %d\n", INT32_MAX - 1);
+        return 1;
+    }
+    if (options.shape != "grid" && options.shape != "geometric" && options.shape != "hubs") {
+        fprintf(stderr, "unknown shape %s\n", options.shape.c_str());
+        return 1;
+    }
+    if (options.traffic != "none" && options.traffic != "uniform" && options.traffic != "skewed") {
+        fprintf(stderr, "unknown traffic distribution %s\n", options.traffic.c_str());
+        return 1;
+    }
+
+    auto start = chrono::steady_clock::now();
+    Writer out(options);
+    if (!out.open()) {
+        fprintf(stderr, "cannot create output file\n");
+        return 1;
+    }
+    out.cities(options.nodes);
+    if (options.shape == "grid") grid(options, out);
+    else if (options.shape == "geometric") geometric(options, out);
+    else hubs(options, out);
+    if (!out.close()) {
+        fprintf(stderr, "write failed\n");
+        return 1;
+    }
+    if (out.lines > INT32_MAX && !options.textPath.empty()) {
+        fprintf(stderr, "warning: %lld lines exceed what the text loader's int count can hold\n", out.lines);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "%s: %lld cities, %lld routes (%lld directed) in %.1f s\n", options.shape.c_str(),
+            options.nodes, out.routes, out.lines, seconds);
+    return 0;
+}
@@ -0,0 +1,145 @@
+// HubLabels on a side x side grid of two-way routes with random distances:
+// build time, shortcut count and label sizes (entries per city and bytes),
+// the time to save and to map the file back, and query latency in ns for
+// the distance merge, for route() with path unpacking, and for a plain
+// dijkstra on the same pairs (costs must match). Copies of the saved file
+// with a broken shortcut must be refused by open().
+//
+// Build:  g++ -O2 -std=c++17 -pthread -o hub_labels_bench bench/hub_labels_bench.cpp
+//         (add -mavx2 for the vector label merge)
+// Run:    ./hub_labels_bench [--side N] [--queries N] [--checks N] [--seed S] [--file PATH]
+
+#include "../spf.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+static double millisSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    int side = 200, queries = 1000000, checks = 200;
+    unsigned seed = 42;
+    std::string path = "hub_labels.bin";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        int value = atoi(argv[i + 1]);
+        if (option == "--side") side = value;
+        else if (option == "--queries") queries = value;
+        else if (option == "--checks") checks = value;
+        else if (option == "--seed") seed = value;
+        else if (option == "--file") path = argv[i + 1];
+        else {
+            fprintf(stderr, "unknown option %s\n", option.c_str());
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pickDistance(10, 100);
+    Graph g;
+    std::vector<std::string> names(side * side);
+    for (int i = 0; i < side * side; i++) names[i] = "c" + std::to_string(i);
+    g.addCities(names);
+    std::vector<NewRoute> routes;
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            int id = y * side + x + 1;
+            if (x + 1 < side) routes.push_back(NewRoute(id, id + 1, pickDistance(rng)));
+            if (y + 1 < side) routes.push_back(NewRoute(id, id + side, pickDistance(rng)));
+        }
+    }
+    g.addRoutes(routes);
+
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<HubLabels> built = HubLabels::build(g);
+    printf("grid %dx%d: built in %.0f ms on %u hardware threads, %lld shortcuts\n", side, side, millisSince(start),
+           std::thread::hardware_concurrency(), built->shortcuts());
+    printf("labels: %.1f entries per city and direction, %.1f MB\n", built->entries() / (2.0 * side * side),
+           built->bytes() / 1e6);
+
+    start = std::chrono::steady_clock::now();
+    if (!built->save(path)) {
+        fprintf(stderr, "cannot write %s\n", path.c_str());
+        return 1;
+    }
+    double saveMs = millisSince(start);
+    start = std::chrono::steady_clock::now();
+    std::shared_ptr<HubLabels> labels = HubLabels::open(path);
+    if (!labels) {
+        fprintf(stderr, "cannot map %s\n", path.c_str());
+        return 1;
+    }
+    printf("save %.1f ms, open %.1f ms\n", saveMs, millisSince(start));
+
+    // save() writes a 40-byte header (ranked at byte 12), rank -> city from
+    // byte 64 on, and the shortcut middles last. The last shortcut gets a
+    // middle that is no city, then the top-ranked city, which is one of its
+    // ends or ranked above them, so unpack() would never stop.
+    if (labels->shortcuts() > 0) {
+        std::ifstream in(path, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        int32_t ranked, top;
+        std::memcpy(&ranked, bytes.data() + 12, 4);
+        std::memcpy(&top, bytes.data() + 64 + (size_t)(ranked - 1) * 4, 4);
+        std::string badPath = path + ".bad";
+        for (int32_t middle : {-1, top}) {
+            std::string bad = bytes;
+            std::memcpy(&bad[bad.size() - 4], &middle, 4);
+            std::ofstream(badPath, std::ios::binary | std::ios::trunc).write(bad.data(), bad.size());
+            if (HubLabels::open(badPath)) {
+                fprintf(stderr, "opened a file whose last shortcut goes through %d\n", middle);
+                return 1;
+            }
+        }
+        remove(badPath.c_str());
+        printf("files with a broken shortcut refused\n");
+    }
+    built.reset();
+
+    std::uniform_int_distribution<int> pickCity(1, side * side);
+    std::vector<std::pair<int, int>> pairs(queries);
+    for (std::pair<int, int>& query : pairs) query = std::make_pair(pickCity(rng), pickCity(rng));
+
+    for (int q = 0; q < std::min(checks, queries); q++) {
+        PathResult plain = g.dijkstra(pairs[q].first, pairs[q].second);
+        PathResult fast = labels->route(pairs[q].first, pairs[q].second);
+        if (plain.cost != fast.cost || labels->distance(pairs[q].first, pairs[q].second) != plain.cost) {
+            fprintf(stderr, "mismatch %d -> %d: labels %lld, dijkstra %lld\n", pairs[q].first, pairs[q].second,
+                    fast.cost, plain.cost);
+            return 1;
+        }
+    }
+
+    long long checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (const std::pair<int, int>& query : pairs) checksum += labels->distance(query.first, query.second);
+    double distanceNs = millisSince(start) * 1e6 / queries;
+
+    int routeQueries = std::min(queries, 100000);
+    long long hops = 0;
+    start = std::chrono::steady_clock::now();
+    for (int q = 0; q < routeQueries; q++) hops += labels->route(pairs[q].first, pairs[q].second).hops;
+    double routeNs = millisSince(start) * 1e6 / routeQueries;
+
+    int dijkstraQueries = std::min(queries, 100);
+    start = std::chrono::steady_clock::now();
+    for (int q = 0; q < dijkstraQueries; q++) checksum += g.dijkstra(pairs[q].first, pairs[q].second).cost;
+    double dijkstraNs = millisSince(start) * 1e6 / dijkstraQueries;
+
+#ifdef __AVX2__
+    const char* merge = "avx2";
+#else
+    const char* merge = "scalar";
+#endif
+    printf("distance (%s) %12.1f ns/query (checksum %lld)\n", merge, distanceNs, checksum);
+    printf("route           %12.1f ns/query (%.1f hops)\n", routeNs, (double)hops / routeQueries);
+    printf("dijkstra        %12.1f ns/query\n", dijkstraNs);
+    remove(path.c_str());
+    return 0;
+}
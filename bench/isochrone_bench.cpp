@@ -0,0 +1,76 @@
+// Graph::reachableWithin on a side x side grid of two-way routes with random
+// distances: for growing budgets, the time to the first streamed city, the
+// total time, and the cities and frontier routes found.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -o isochrone_bench bench/isochrone_bench.cpp
+// Run:    ./isochrone_bench [--side N] [--queries N] [--seed S]
+
+#include "../spf.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+int main(int argc, char** argv) {
+    int side = 1000, queries = 5;
+    unsigned seed = 42;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        int value = atoi(argv[i + 1]);
+        if (option == "--side") side = value;
+        else if (option == "--queries") queries = value;
+        else if (option == "--seed") seed = value;
+        else {
+            fprintf(stderr, "unknown option %s\n", option.c_str());
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pickDistance(10, 100);
+    Graph g;
+    std::vector<std::string> names(side * side);
+    for (int i = 0; i < side * side; i++) names[i] = "c" + std::to_string(i);
+    g.addCities(names);
+    std::vector<NewRoute> routes;
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            int id = y * side + x + 1;
+            if (x + 1 < side) routes.push_back(NewRoute(id, id + 1, pickDistance(rng)));
+            if (y + 1 < side) routes.push_back(NewRoute(id, id + side, pickDistance(rng)));
+        }
+    }
+    g.addRoutes(routes);
+    printf("grid %dx%d, mean distance 55\n", side, side);
+    printf("%10s %12s %12s %12s %12s\n", "budget", "first (ms)", "total (ms)", "cities", "frontier");
+
+    // The first search on a thread sizes its scratch arrays; keep that out
+    // of the table.
+    g.reachableWithin(side * side, 0);
+
+    std::uniform_int_distribution<int> pickCity(1, side * side);
+    for (int budget = 500; budget <= 55 * side; budget *= 4) {
+        double firstMs = 0, totalMs = 0;
+        long long cities = 0, frontier = 0;
+        for (int q = 0; q < queries; q++) {
+            auto start = std::chrono::steady_clock::now();
+            bool first = true;
+            g.reachableWithin(
+                pickCity(rng), budget,
+                [&](const ReachedCity&) {
+                    if (first) {
+                        firstMs +=
+                            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                        first = false;
+                    }
+                    cities++;
+                    return true;
+                },
+                [&](const FrontierRoute&) { frontier++; });
+            totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        printf("%10d %12.2f %12.2f %12lld %12lld\n", budget, firstMs / queries, totalMs / queries, cities / queries,
+               frontier / queries);
+    }
+    return 0;
+}
@@ -0,0 +1,115 @@
+// Latency of Graph::kShortestPaths and Graph::alternativeRoutes on a side x
+// side grid of two-way routes with random distances (1M cities at the
+// default side of 1000). Query pairs are drawn uniformly, then kept only if
+// their shortest path has at least --min-hops hops, so short trivial queries
+// don't flatter the numbers.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -o ksp_bench bench/ksp_bench.cpp
+// Run:    ./ksp_bench [--side N] [--k K] [--alternatives N] [--queries N] [--min-hops H] [--seed S]
+//
+// Prints the build time, the latency percentiles of kShortestPaths (k
+// paths), of alternativeRoutes (up to N routes, 3 by default) and, for
+// scale, of a single dijkstra on the same pairs, and the ratio of the
+// medians. The ratio is what kShortestPaths promises: k paths for about the
+// price of one search. The absolute times are those of one Dijkstra over
+// the graph, so on 1M cities they stay in the hundreds of milliseconds on
+// one core (p50 440 ms for k=10 when this was written), well above the tens
+// of milliseconds asked for; reaching that needs a faster base search.
+
+#include "../spf.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+static double percentile(std::vector<double> samples, double p) {
+    if (samples.empty()) return 0;
+    std::sort(samples.begin(), samples.end());
+    return samples[std::min(samples.size() - 1, (size_t)(p * samples.size()))];
+}
+
+static void report(const char* label, const std::vector<double>& ms) {
+    double total = 0;
+    for (double sample : ms) total += sample;
+    printf("%-10s mean %8.2f ms  p50 %8.2f  p90 %8.2f  p99 %8.2f  max %8.2f\n", label,
+           ms.empty() ? 0 : total / ms.size(), percentile(ms, 0.5), percentile(ms, 0.9), percentile(ms, 0.99),
+           percentile(ms, 1.0));
+}
+
+int main(int argc, char** argv) {
+    int side = 1000, k = 10, alternatives = 3, queries = 50, minHops = 200;
+    unsigned seed = 42;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        int value = atoi(argv[i + 1]);
+        if (option == "--side") side = value;
+        else if (option == "--k") k = value;
+        else if (option == "--alternatives") alternatives = value;
+        else if (option == "--queries") queries = value;
+        else if (option == "--min-hops") minHops = value;
+        else if (option == "--seed") seed = value;
+        else {
+            fprintf(stderr, "unknown option %s\n", option.c_str());
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pickDistance(10, 100);
+    auto start = std::chrono::steady_clock::now();
+    Graph g;
+    std::vector<std::string> names(side * side);
+    for (int i = 0; i < side * side; i++) names[i] = "c" + std::to_string(i);
+    g.addCities(names);
+    std::vector<NewRoute> routes;
+    routes.reserve(2 * side * side);
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            int id = y * side + x + 1;
+            if (x + 1 < side) routes.push_back(NewRoute(id, id + 1, pickDistance(rng)));
+            if (y + 1 < side) routes.push_back(NewRoute(id, id + side, pickDistance(rng)));
+        }
+    }
+    g.addRoutes(routes);
+    printf("grid %dx%d: %d cities, %zu two-way routes, built in %.2fs, %u hardware threads\n", side, side,
+           side * side, routes.size(), std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+           std::thread::hardware_concurrency());
+
+    std::uniform_int_distribution<int> pickCity(1, side * side);
+    std::vector<double> kspMs, alternativeMs, dijkstraMs;
+    long long checksum = 0;
+    int found = 0, alternativesFound = 0;
+    while ((int)kspMs.size() < queries) {
+        int src = pickCity(rng), dest = pickCity(rng);
+        auto t0 = std::chrono::steady_clock::now();
+        PathResult shortest = g.dijkstra(src, dest);
+        auto t1 = std::chrono::steady_clock::now();
+        if (!shortest.found() || shortest.hops < minHops) continue;
+        std::vector<PathResult> paths = g.kShortestPaths(src, dest, k);
+        auto t2 = std::chrono::steady_clock::now();
+        std::vector<PathResult> routes = g.alternativeRoutes(src, dest, alternatives);
+        auto t3 = std::chrono::steady_clock::now();
+
+        if (paths.empty() || paths[0].cost != shortest.cost || routes.empty() || routes[0].cost != shortest.cost) {
+            fprintf(stderr, "mismatch %d -> %d: dijkstra %lld, kShortestPaths %lld, alternativeRoutes %lld\n", src,
+                    dest, shortest.cost, paths.empty() ? -1 : paths[0].cost, routes.empty() ? -1 : routes[0].cost);
+            return 1;
+        }
+        for (const PathResult& path : paths) checksum += path.cost;
+        for (const PathResult& route : routes) checksum += route.cost;
+        found += paths.size();
+        alternativesFound += routes.size();
+        dijkstraMs.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+        kspMs.push_back(std::chrono::duration<double, std::milli>(t2 - t1).count());
+        alternativeMs.push_back(std::chrono::duration<double, std::milli>(t3 - t2).count());
+    }
+
+    printf("%d queries, >= %d hops: %d paths for k=%d, %d routes for %d alternatives (checksum %lld)\n", queries,
+           minHops, found, k, alternativesFound, alternatives, checksum);
+    report("ksp", kspMs);
+    report("alt", alternativeMs);
+    report("dijkstra", dijkstraMs);
+    printf("p50 ratio  ksp %.2fx  alt %.2fx of one dijkstra\n", percentile(kspMs, 0.5) / percentile(dijkstraMs, 0.5),
+           percentile(alternativeMs, 0.5) / percentile(dijkstraMs, 0.5));
+    return 0;
+}
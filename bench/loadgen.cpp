@@ -0,0 +1,305 @@
+// Open-loop load generator for the --serve daemon. Requests are sent on a
+// fixed schedule regardless of how fast responses come back, and latency is
+// measured from each request's scheduled send time, so a stalled server shows
+// up in the tail instead of silently lowering the offered load.
+//
+// Build:  g++ -O2 -std=c++17 -o loadgen bench/loadgen.cpp
+// Run:    ./main --serve 7400 &
+//         ./loadgen --connect 7400 --grid 100 --qps 100000 --seconds 10
+//
+// Options:
+//   --connect ADDR     port, host:port or unix:path (default 7400)
+//   --qps N            offered load, requests per second (default 100000)
+//   --seconds S        measured duration (default 10), after --warmup S (default 1)
+//   --connections N    client connections the load is spread over (default 16)
+//   --grid SIDE        first build a SIDE x SIDE grid on the server and query it
+//   --cities N         otherwise query random pairs among city IDs 1..N
+//   --traffic P        percent of requests that are traffic updates (with --grid)
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+using namespace std;
+
+typedef long long Nanos;
+
+static Nanos now() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int connectTo(const string& address) {
+    int fd;
+    if (address.compare(0, 5, "unix:") == 0) {
+        sockaddr_un local;
+        memset(&local, 0, sizeof(local));
+        local.sun_family = AF_UNIX;
+        strncpy(local.sun_path, address.c_str() + 5, sizeof(local.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, (sockaddr*)&local, sizeof(local)) < 0) return -1;
+    } else {
+        size_t colon = address.rfind(':');
+        string host = colon == string::npos ? "127.0.0.1" : address.substr(0, colon);
+        sockaddr_in inet;
+        memset(&inet, 0, sizeof(inet));
+        inet.sin_family = AF_INET;
+        inet.sin_port = htons(atoi(address.c_str() + (colon == string::npos ? 0 : colon + 1)));
+        if (inet_pton(AF_INET, host.c_str(), &inet.sin_addr) != 1) return -1;
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, (sockaddr*)&inet, sizeof(inet)) < 0) return -1;
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    return fd;
+}
+
+// Sends all requests on a blocking socket and returns one response line each.
+static vector<string> roundTrip(int fd, const string& requests, size_t count) {
+    for (size_t sent = 0; sent < requests.size();) {
+        ssize_t n = send(fd, requests.data() + sent, requests.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        sent += n;
+    }
+    vector<string> lines;
+    string buffer;
+    char chunk[1 << 16];
+    while (lines.size() < count) {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) break;
+        buffer.append(chunk, n);
+        size_t start = 0, newline;
+        while ((newline = buffer.find('\n', start)) != string::npos) {
+            lines.push_back(buffer.substr(start, newline - start));
+            start = newline + 1;
+        }
+        buffer.erase(0, start);
+    }
+    return lines;
+}
+
+class Client {
+public:
+    int fd;
+    string in;
+    string out;
+    size_t sent;
+    Nanos nextSend;
+    deque<Nanos> scheduled;
+
+    Client() : fd(-1), sent(0), nextSend(0) {}
+};
+
+int main(int argc, char** argv) {
+    string address = "7400";
+    double qps = 100000, seconds = 10, warmup = 1;
+    int connections = 16, grid = 0, cities = 0, trafficPercent = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string option = argv[i];
+        const char* value = argv[i + 1];
+        if (option == "--connect") address = value;
+        else if (option == "--qps") qps = atof(value);
+        else if (option == "--seconds") seconds = atof(value);
+        else if (option == "--warmup") warmup = atof(value);
+        else if (option == "--connections") connections = atoi(value);
+        else if (option == "--grid") grid = atoi(value);
+        else if (option == "--cities") cities = atoi(value);
+        else if (option == "--traffic") trafficPercent = atoi(value);
+        else {
+            cerr << "unknown option " << option << "\n";
+            return 1;
+        }
+    }
+    if (qps <= 0 || connections < 1 || (grid < 2 && cities < 2)) {
+        cerr << "usage: " << argv[0] << " --connect ADDR (--grid SIDE | --cities N) [--qps N] [--seconds S]"
+             << " [--warmup S] [--connections N] [--traffic P]\n";
+        return 1;
+    }
+
+    // Route queries pick from ids; traffic updates pick from edges.
+    vector<int> ids;
+    vector<pair<int, int>> edges;
+    mt19937 rng(1);
+    if (grid >= 2) {
+        int setup = connectTo(address);
+        if (setup < 0) {
+            cerr << "cannot connect to " << address << ": " << strerror(errno) << "\n";
+            return 1;
+        }
+        string requests;
+        for (int i = 0; i < grid * grid; i++) {
+            requests += "C grid" + to_string(i) + "\n";
+        }
+        for (const string& line : roundTrip(setup, requests, grid * grid)) {
+            if (line.compare(0, 3, "OK ") != 0) {
+                cerr << "setup failed: " << line << " (is the server's graph empty?)\n";
+                return 1;
+            }
+            ids.push_back(atoi(line.c_str() + 3));
+        }
+        if ((int)ids.size() != grid * grid) {
+            cerr << "setup failed: server closed the connection\n";
+            return 1;
+        }
+
+        uniform_int_distribution<int> pickDistance(1, 100);
+        requests.clear();
+        for (int r = 0; r < grid; r++) {
+            for (int c = 0; c < grid; c++) {
+                int id = ids[r * grid + c];
+                if (c + 1 < grid) edges.push_back(make_pair(id, ids[r * grid + c + 1]));
+                if (r + 1 < grid) edges.push_back(make_pair(id, ids[(r + 1) * grid + c]));
+            }
+        }
+        for (const pair<int, int>& edge : edges) {
+            requests += "E " + to_string(edge.first) + " " + to_string(edge.second) + " " +
+                        to_string(pickDistance(rng)) + " 0\n";
+        }
+        roundTrip(setup, requests, edges.size());
+        close(setup);
+        printf("built %dx%d grid: %zu cities, %zu two-way routes\n", grid, grid, ids.size(), edges.size());
+    } else {
+        for (int id = 1; id <= cities; id++) ids.push_back(id);
+    }
+
+    vector<Client> clients(connections);
+    int epollFd = epoll_create1(0);
+    int timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u32 = connections;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &event);
+
+    Nanos interval = (Nanos)(connections * 1e9 / qps);
+    Nanos start = now() + 10000000;
+    Nanos measureFrom = start + (Nanos)(warmup * 1e9);
+    Nanos stopAt = measureFrom + (Nanos)(seconds * 1e9);
+    for (int i = 0; i < connections; i++) {
+        Client& client = clients[i];
+        client.fd = connectTo(address);
+        if (client.fd < 0) {
+            cerr << "cannot connect to " << address << ": " << strerror(errno) << "\n";
+            return 1;
+        }
+        fcntl(client.fd, F_SETFL, O_NONBLOCK);
+        client.nextSend = start + interval * i / connections;
+        event.events = EPOLLIN;
+        event.data.u32 = i;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, client.fd, &event);
+    }
+
+    uniform_int_distribution<size_t> pickCity(0, ids.size() - 1);
+    uniform_int_distribution<size_t> pickEdge(0, edges.empty() ? 0 : edges.size() - 1);
+    uniform_int_distribution<int> pickPercent(0, 99), pickLevel(0, 7);
+    vector<Nanos> latencies;
+    latencies.reserve((size_t)(qps * seconds * 1.1));
+    long long sentCount = 0, completed = 0, errors = 0, outstanding = 0;
+    char chunk[1 << 16];
+
+    for (;;) {
+        Nanos current = now();
+        Nanos earliest = LLONG_MAX;
+        for (Client& client : clients) {
+            while (client.nextSend <= current && client.nextSend < stopAt) {
+                if (!edges.empty() && pickPercent(rng) < trafficPercent) {
+                    const pair<int, int>& edge = edges[pickEdge(rng)];
+                    client.out += "T " + to_string(edge.first) + " " + to_string(edge.second) + " " +
+                                  to_string(pickLevel(rng)) + "\n";
+                } else {
+                    client.out += "R " + to_string(ids[pickCity(rng)]) + " " + to_string(ids[pickCity(rng)]) + "\n";
+                }
+                client.scheduled.push_back(client.nextSend);
+                client.nextSend += interval;
+                sentCount++;
+                outstanding++;
+            }
+            while (client.sent < client.out.size()) {
+                ssize_t n = send(client.fd, client.out.data() + client.sent, client.out.size() - client.sent,
+                                 MSG_NOSIGNAL);
+                if (n <= 0) break;
+                client.sent += n;
+            }
+            if (client.sent == client.out.size()) {
+                client.out.clear();
+                client.sent = 0;
+            }
+            if (client.nextSend < stopAt) earliest = min(earliest, client.nextSend);
+        }
+
+        if (earliest == LLONG_MAX && outstanding == 0) break;
+        if (earliest == LLONG_MAX && current > stopAt + 5000000000LL) break;
+
+        itimerspec timer;
+        memset(&timer, 0, sizeof(timer));
+        Nanos wake = earliest == LLONG_MAX ? current + 100000000 : earliest;
+        timer.it_value.tv_sec = wake / 1000000000;
+        timer.it_value.tv_nsec = wake % 1000000000;
+        timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &timer, nullptr);
+
+        epoll_event events[64];
+        int ready = epoll_wait(epollFd, events, 64, -1);
+        for (int e = 0; e < ready; e++) {
+            uint32_t index = events[e].data.u32;
+            if (index == (uint32_t)connections) {
+                uint64_t expirations;
+                ssize_t ignored = read(timerFd, &expirations, sizeof(expirations));
+                (void)ignored;
+                continue;
+            }
+            Client& client = clients[index];
+            ssize_t n;
+            while ((n = recv(client.fd, chunk, sizeof(chunk), 0)) > 0) {
+                client.in.append(chunk, n);
+            }
+            Nanos received = now();
+            size_t lineStart = 0, newline;
+            while ((newline = client.in.find('\n', lineStart)) != string::npos) {
+                if (client.in.compare(lineStart, 2, "OK") != 0 && client.in.compare(lineStart, 6, "NOPATH") != 0) {
+                    errors++;
+                }
+                Nanos scheduled = client.scheduled.front();
+                client.scheduled.pop_front();
+                if (scheduled >= measureFrom) {
+                    latencies.push_back(received - scheduled);
+                }
+                completed++;
+                outstanding--;
+                lineStart = newline + 1;
+            }
+            client.in.erase(0, lineStart);
+        }
+    }
+
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        if (latencies.empty()) return 0.0;
+        size_t index = min(latencies.size() - 1, (size_t)(p / 100.0 * latencies.size()));
+        return latencies[index] / 1000.0;
+    };
+
+    printf("offered %.0f req/s over %d connections for %.1fs (after %.1fs warmup), %d%% traffic updates\n",
+           qps, connections, seconds, warmup, edges.empty() ? 0 : trafficPercent);
+    printf("  sent %lld, completed %lld, errors %lld, measured throughput %.0f req/s\n",
+           sentCount, completed, errors, latencies.size() / seconds);
+    printf("  latency us: p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+           percentile(50), percentile(90), percentile(99), percentile(99.9),
+           latencies.empty() ? 0.0 : latencies.back() / 1000.0);
+    return outstanding == 0 ? 0 : 1;
+}
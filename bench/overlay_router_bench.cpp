@@ -0,0 +1,128 @@
+// OverlayRouter on a side x side grid of two-way routes with random
+// distances (1M cities at the default side of 1000): the time to partition
+// and customize, query latency against a plain dijkstra on the same pairs
+// (costs must match), and refresh times after one traffic change and after
+// a feed of --updates changes spread over the grid.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -o overlay_router_bench bench/overlay_router_bench.cpp
+// Run:    ./overlay_router_bench [--side N] [--queries N] [--updates N] [--seed S]
+
+#include "../spf.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+static double percentile(std::vector<double> samples, double p) {
+    if (samples.empty()) return 0;
+    std::sort(samples.begin(), samples.end());
+    return samples[std::min(samples.size() - 1, (size_t)(p * samples.size()))];
+}
+
+static void report(const char* label, const std::vector<double>& ms) {
+    double total = 0;
+    for (double sample : ms) total += sample;
+    printf("%-10s mean %8.3f ms  p50 %8.3f  p90 %8.3f  p99 %8.3f  max %8.3f\n", label,
+           ms.empty() ? 0 : total / ms.size(), percentile(ms, 0.5), percentile(ms, 0.9), percentile(ms, 0.99),
+           percentile(ms, 1.0));
+}
+
+static double millisSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    int side = 1000, queries = 100, updates = 1000;
+    unsigned seed = 42;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        int value = atoi(argv[i + 1]);
+        if (option == "--side") side = value;
+        else if (option == "--queries") queries = value;
+        else if (option == "--updates") updates = value;
+        else if (option == "--seed") seed = value;
+        else {
+            fprintf(stderr, "unknown option %s\n", option.c_str());
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pickDistance(10, 100);
+    Graph g;
+    std::vector<std::string> names(side * side);
+    for (int i = 0; i < side * side; i++) names[i] = "c" + std::to_string(i);
+    g.addCities(names);
+    std::vector<NewRoute> routes;
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            int id = y * side + x + 1;
+            if (x + 1 < side) routes.push_back(NewRoute(id, id + 1, pickDistance(rng)));
+            if (y + 1 < side) routes.push_back(NewRoute(id, id + side, pickDistance(rng)));
+        }
+    }
+    g.addRoutes(routes);
+
+    OverlayRouter router(g);
+    auto start = std::chrono::steady_clock::now();
+    router.build();
+    printf("grid %dx%d: built in %.0f ms on %u hardware threads\n", side, side, millisSince(start),
+           std::thread::hardware_concurrency());
+    printf("%6s %10s %8s %10s %10s %10s\n", "level", "max cells", "cells", "cut", "boundary", "largest");
+    std::vector<OverlayLevelInfo> levels = router.levels();
+    for (size_t level = 0; level < levels.size(); level++) {
+        const OverlayLevelInfo& info = levels[level];
+        printf("%6zu %10d %8d %10d %10d %10d\n", level, info.maxCellSize, info.cells, info.cutEdges,
+               info.boundaryCities, info.largestBoundary);
+    }
+
+    std::uniform_int_distribution<int> pickCity(1, side * side);
+    std::vector<double> routeMs, dijkstraMs;
+    long long checksum = 0;
+    // Warm both searches' scratch arrays before timing.
+    g.dijkstra(1, side * side);
+    router.route(1, side * side);
+    for (int q = 0; q < queries; q++) {
+        int src = pickCity(rng), dest = pickCity(rng);
+        start = std::chrono::steady_clock::now();
+        PathResult fast = router.route(src, dest);
+        routeMs.push_back(millisSince(start));
+        start = std::chrono::steady_clock::now();
+        PathResult plain = g.dijkstra(src, dest);
+        dijkstraMs.push_back(millisSince(start));
+        if (fast.status != plain.status || fast.cost != plain.cost) {
+            fprintf(stderr, "mismatch %d -> %d: overlay %lld, dijkstra %lld\n", src, dest, fast.cost, plain.cost);
+            return 1;
+        }
+        checksum += fast.cost;
+    }
+    printf("%d queries (checksum %lld)\n", queries, checksum);
+    report("overlay", routeMs);
+    report("dijkstra", dijkstraMs);
+
+    const NewRoute& one = routes[rng() % routes.size()];
+    g.setTraffic(one.from, one.to, 5);
+    start = std::chrono::steady_clock::now();
+    int cells = router.refresh();
+    printf("refresh after 1 change: %d cells in %.2f ms\n", cells, millisSince(start));
+
+    std::vector<TrafficUpdate> feed;
+    std::uniform_int_distribution<int> pickLevel(0, 9);
+    for (int i = 0; i < updates; i++) {
+        const NewRoute& route = routes[rng() % routes.size()];
+        feed.push_back(TrafficUpdate(route.from, route.to, pickLevel(rng)));
+    }
+    g.applyTrafficBatch(feed);
+    start = std::chrono::steady_clock::now();
+    cells = router.refresh();
+    printf("refresh after %d changes: %d cells in %.2f ms\n", updates, cells, millisSince(start));
+
+    for (int q = 0; q < 10; q++) {
+        int src = pickCity(rng), dest = pickCity(rng);
+        if (router.route(src, dest).cost != g.dijkstra(src, dest).cost) {
+            fprintf(stderr, "mismatch after refresh %d -> %d\n", src, dest);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,271 @@
+// Concurrency stress for the edge overlay: query threads run bounded Dijkstra
+// searches on pinned snapshots while updater threads push traffic batches and
+// block/unblock routes. Every overlay word a query reads is checked against
+// the attributes it carries; a cost that doesn't match them is a torn read.
+// A separate chain of cities is retimed as a whole by witness batches, and
+// queries route along it with dijkstra(): a total that mixes two batches'
+// costs means a batch was seen half applied. Meanwhile a second graph is
+// retimed and now and then gains a route while OverlayRouter refreshes
+// against it; once everything stops the router must agree with dijkstra()
+// on it.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -o overlay_stress bench/overlay_stress.cpp
+// Run:    ./overlay_stress [seconds] [cities] [query threads] [updater threads]
+//
+// Exits non-zero if any torn read or half-applied batch was seen, or if the
+// router disagrees with dijkstra() after its last refresh.
+
+#include "../spf.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+#include <random>
+#include <sstream>
+
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+class ThreadCounters {
+public:
+    long long queries = 0;
+    long long wordsChecked = 0;
+    long long tornReads = 0;
+    long long witnessQueries = 0;
+    long long splitBatches = 0;
+    long long updates = 0;
+};
+
+static bool consistent(const Route& route) {
+    uint32_t expected = route.isBlocked() ? Route::BLOCKED_COST
+                                          : (uint32_t)calculateEffectiveCost(route.distance(), route.traffic());
+    return route.cost == expected;
+}
+
+// Settles at most `limit` cities from src, validating each word it relaxes.
+static void boundedSearch(const Graph& g, int src, int limit, ThreadCounters& counters) {
+    ReadGuard graph = g.snapshot();
+    std::vector<long long> distances(graph->nextCityId, LLONG_MAX);
+    std::priority_queue<std::pair<long long, int>, std::vector<std::pair<long long, int>>,
+                        std::greater<std::pair<long long, int>>>
+        frontier;
+    distances[src] = 0;
+    frontier.push(std::make_pair(0, src));
+    int settled = 0;
+    while (!frontier.empty() && settled < limit) {
+        std::pair<long long, int> current = frontier.top();
+        frontier.pop();
+        if (current.first > distances[current.second]) continue;
+        settled++;
+        for (const Link& link : graph->links(current.second)) {
+            Route route = graph->route(link);
+            counters.wordsChecked++;
+            if (!consistent(route)) {
+                counters.tornReads++;
+            }
+            if (route.cost == Route::BLOCKED_COST) continue;
+            long long candidate = current.first + route.cost;
+            if (candidate < distances[link.neighbor]) {
+                distances[link.neighbor] = candidate;
+                frontier.push(std::make_pair(candidate, link.neighbor));
+            }
+        }
+    }
+    counters.queries++;
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 5.0;
+    int cityCount = argc > 2 ? atoi(argv[2]) : 20000;
+    int queryThreads = argc > 3 ? atoi(argv[3]) : 32;
+    int updaterThreads = argc > 4 ? atoi(argv[4]) : 4;
+    if (cityCount < 2 || queryThreads < 1 || updaterThreads < 0) {
+        std::cerr << "usage: " << argv[0] << " [seconds] [cities] [query threads] [updater threads]\n";
+        return 1;
+    }
+
+    // Mutators report on cout; the updaters' messages are discarded.
+    NullBuffer discard;
+    std::streambuf* console = std::cout.rdbuf(&discard);
+
+    Graph g;
+    std::vector<std::string> names;
+    for (int i = 0; i < cityCount; i++) {
+        names.push_back("city" + std::to_string(i));
+    }
+    // The witness chain: WITNESS_LENGTH one-way routes of distance 100,
+    // unconnected to the rest.
+    const int WITNESS_LENGTH = 32;
+    for (int i = 0; i <= WITNESS_LENGTH; i++) {
+        names.push_back("witness" + std::to_string(i));
+    }
+    g.addCities(names);
+    int witnessStart = cityCount + 1, witnessEnd = cityCount + 1 + WITNESS_LENGTH;
+    for (int id = witnessStart; id < witnessEnd; id++) {
+        g.addEdge(id, id + 1, 100, true);
+    }
+    const int WITNESS_LEVELS[2] = {0, 7};
+    long long witnessCosts[2];
+    for (int i = 0; i < 2; i++) {
+        witnessCosts[i] = (long long)WITNESS_LENGTH * calculateEffectiveCost(100, WITNESS_LEVELS[i]);
+    }
+
+    // A ring, so everything is reachable, plus ~4 random chords per city.
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> pickCity(1, cityCount);
+    std::uniform_int_distribution<int> pickDistance(1, 1000);
+    std::vector<std::pair<int, int>> edges;
+    for (int id = 1; id <= cityCount; id++) {
+        int next = id % cityCount + 1;
+        g.addEdge(id, next, pickDistance(rng), false);
+        edges.push_back(std::make_pair(id, next));
+        edges.push_back(std::make_pair(next, id));
+    }
+    for (int i = 0; i < 2 * cityCount; i++) {
+        int u = pickCity(rng), v = pickCity(rng);
+        if (u == v) continue;
+        g.addEdge(u, v, pickDistance(rng), false);
+        edges.push_back(std::make_pair(u, v));
+        edges.push_back(std::make_pair(v, u));
+    }
+
+    // The growing graph starts as a ring; small cells keep refreshes busy.
+    const int GROWING_CITIES = 500;
+    Graph growing;
+    std::vector<std::string> growingNames;
+    for (int i = 0; i < GROWING_CITIES; i++) {
+        growingNames.push_back("town" + std::to_string(i));
+    }
+    growing.addCities(growingNames);
+    for (int id = 1; id <= GROWING_CITIES; id++) {
+        growing.addEdge(id, id % GROWING_CITIES + 1, pickDistance(rng), false);
+    }
+    OverlayRouter router(growing, std::vector<int>{16, 128});
+    router.build();
+
+    std::atomic<bool> stop(false);
+    std::vector<ThreadCounters> counters(queryThreads + updaterThreads);
+    long long routesAdded = 0, refreshes = 0;  // each written by one thread until the join
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < queryThreads; t++) {
+        threads.emplace_back([&, t] {
+            std::mt19937 local(1000 + t);
+            std::uniform_int_distribution<int> pickSource(1, cityCount);
+            for (long long round = 0; !stop.load(std::memory_order_relaxed); round++) {
+                if (round % 4 == 0) {
+                    PathResult result = g.dijkstra(witnessStart, witnessEnd);
+                    counters[t].witnessQueries++;
+                    if (result.cost != witnessCosts[0] && result.cost != witnessCosts[1]) {
+                        counters[t].splitBatches++;
+                    }
+                    continue;
+                }
+                boundedSearch(g, pickSource(local), 2000, counters[t]);
+            }
+        });
+    }
+
+    for (int t = 0; t < updaterThreads; t++) {
+        threads.emplace_back([&, t] {
+            ThreadCounters& mine = counters[queryThreads + t];
+            std::mt19937 local(2000 + t);
+            std::uniform_int_distribution<size_t> pickEdge(0, edges.size() - 1);
+            std::uniform_int_distribution<int> pickLevel(0, 10);
+            std::vector<TrafficUpdate> batch;
+            for (long long round = 0; !stop.load(std::memory_order_relaxed); round++) {
+                if (t == 0 && round % 2 == 0) {
+                    batch.clear();
+                    int level = WITNESS_LEVELS[(round / 2) % 2];
+                    for (int id = witnessStart; id < witnessEnd; id++) {
+                        batch.push_back(TrafficUpdate(id, id + 1, level));
+                    }
+                    mine.updates += g.applyTrafficBatch(batch).applied;
+                    continue;
+                }
+                if (round % 8 == 0) {
+                    const std::pair<int, int>& edge = edges[pickEdge(local)];
+                    if (round % 16 == 0) g.blockRoute(edge.first, edge.second);
+                    else g.unblockRoute(edge.first, edge.second);
+                    mine.updates++;
+                    continue;
+                }
+                batch.clear();
+                for (int i = 0; i < 64; i++) {
+                    const std::pair<int, int>& edge = edges[pickEdge(local)];
+                    batch.push_back(TrafficUpdate(edge.first, edge.second, pickLevel(local)));
+                }
+                mine.updates += g.applyTrafficBatch(batch).applied;
+            }
+        });
+    }
+
+    // One thread retimes ring routes and now and then adds a route and
+    // retimes it right away, so the journal can name a route the router's
+    // layout doesn't have; the other refreshes.
+    threads.emplace_back([&] {
+        std::mt19937 local(3000);
+        std::uniform_int_distribution<int> pickTown(1, GROWING_CITIES);
+        std::uniform_int_distribution<int> pickLevel(0, 7);
+        for (long long round = 0; !stop.load(std::memory_order_relaxed); round++) {
+            int u = pickTown(local), v = pickTown(local);
+            if (round % 4096 != 0) {
+                growing.setTraffic(u, u % GROWING_CITIES + 1, pickLevel(local));
+                continue;
+            }
+            if (u == v || growing.addEdge(u, v, pickDistance(local), true) != GraphStatus::OK) continue;
+            growing.setTraffic(u, v, pickLevel(local));
+            routesAdded++;
+        }
+    });
+    threads.emplace_back([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+            router.refresh();
+            refreshes++;
+        }
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (std::thread& t : threads) t.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout.rdbuf(console);
+
+    ThreadCounters total;
+    for (const ThreadCounters& c : counters) {
+        total.queries += c.queries;
+        total.wordsChecked += c.wordsChecked;
+        total.tornReads += c.tornReads;
+        total.witnessQueries += c.witnessQueries;
+        total.splitBatches += c.splitBatches;
+        total.updates += c.updates;
+    }
+
+    router.refresh();
+    std::mt19937 check(11);
+    std::uniform_int_distribution<int> pickTown(1, GROWING_CITIES);
+    const int ROUTER_CHECKS = 500;
+    int routerMismatches = 0;
+    for (int i = 0; i < ROUTER_CHECKS; i++) {
+        int src = pickTown(check), dest = pickTown(check);
+        PathResult expected = growing.dijkstra(src, dest), got = router.route(src, dest);
+        if (got.status != expected.status || got.cost != expected.cost) routerMismatches++;
+    }
+
+    printf("cities=%d edges=%zu query threads=%d updater threads=%d, %.2fs\n",
+           cityCount, edges.size(), queryThreads, updaterThreads, elapsed);
+    printf("  queries: %lld (%.0f/s), overlay words checked: %lld (%.2f M/s)\n",
+           total.queries, total.queries / elapsed, total.wordsChecked, total.wordsChecked / elapsed / 1e6);
+    printf("  edge updates: %lld (%.0f/s), graph version %llu\n",
+           total.updates, total.updates / elapsed, g.getVersion());
+    printf("  torn reads: %lld\n", total.tornReads);
+    printf("  witness queries: %lld, half-applied batches seen: %lld\n", total.witnessQueries,
+           total.splitBatches);
+    printf("  router: %lld refreshes while %lld routes were added, %d of %d routes disagree with dijkstra()\n",
+           refreshes, routesAdded, routerMismatches, ROUTER_CHECKS);
+    return total.tornReads == 0 && total.splitBatches == 0 && routerMismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+// Shortest-path query throughput on the sample graph, with and without the
+// console presentation layer:
+//   legacy  Graph::dijkstra + ConsoleView::path, flushed after every query
+//           the way the old printing dijkstra's trailing endl did
+//   view    Graph::dijkstra + ConsoleView::path, left to cout's buffering
+//   result  Graph::dijkstra only; the PathResult costs are summed
+//
+// Build:  g++ -O2 -std=c++17 -pthread -o path_query_bench bench/path_query_bench.cpp
+// Run:    ./path_query_bench legacy 1000000 > /dev/null
+//         ./path_query_bench view 1000000 > /dev/null
+//         ./path_query_bench result 1000000
+//
+// Query output goes to stdout (so it can be suppressed); the timing goes to
+// stderr.
+
+#include "../spf.h"
+#include "../console.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+int main(int argc, char** argv) {
+    if (argc < 2 || (strcmp(argv[1], "legacy") != 0 && strcmp(argv[1], "view") != 0 &&
+                     strcmp(argv[1], "result") != 0)) {
+        std::cerr << "usage: " << argv[0] << " <legacy|view|result> [queries]\n";
+        return 1;
+    }
+    std::string mode = argv[1];
+    long queries = argc > 2 ? atol(argv[2]) : 1000000;
+
+    Graph g;
+    g.loadSampleData();
+    ConsoleView view(g);
+    int cityCount = g.cityCount();
+
+    // Pairs are drawn up front so the timed loop is only queries (and output).
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pickCity(1, cityCount);
+    std::vector<std::pair<int, int>> pairs(queries);
+    for (std::pair<int, int>& p : pairs) {
+        p.first = pickCity(rng);
+        p.second = pickCity(rng);
+    }
+
+    long long checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const std::pair<int, int>& p : pairs) {
+        PathResult result = g.dijkstra(p.first, p.second);
+        checksum += result.cost;
+        if (mode == "legacy") {
+            view.path(result);
+            std::cout << std::flush;
+        } else if (mode == "view") {
+            view.path(result);
+        }
+    }
+    std::cout << std::flush;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    fprintf(stderr, "mode=%s queries=%ld cities=%d: %.3fs, %.0f queries/s (checksum %lld)\n",
+            mode.c_str(), queries, cityCount, seconds, queries / seconds, checksum);
+    return 0;
+}
@@ -0,0 +1,121 @@
+#!/bin/sh
+# Profile-guided optimization trained on the synthetic benchmark workload,
+# and a report of what it buys in query throughput.
+#
+# Run:    bench/pgo.sh [graphgen options] > report.md
+#         bench/pgo.sh train BUILD_DIR     (the training run alone; what the
+#                                           pgo_train CMake target runs)
+# Env:    RELEASE (default build/release), PGO (default build/pgo) build
+#         directories, ROUNDS (default 3) measurements per build, best kept
+#
+# The full cycle: a plain Release build; an SPF_PGO=generate build, trained
+# by running the workload through it; the same directory rebuilt with
+# SPF_PGO=use. Training and measurement use different seeds, so the graph,
+# queries and mutations measured are not the ones the profile saw. Measured
+# per engine: engine_bench's single-query latency and batch throughput, and
+# main --batch replaying a command script (the graph built with C/E/T/B,
+# then 200 R queries) end to end.
+
+set -e
+cd "$(dirname "$0")/.."
+
+generate="--nodes 20000 --one-way 0.2 --traffic skewed --blocked 0.02"
+
+# Graph text file $1 -> a --batch script on stdout that builds it and asks
+# $2 random routes. graphgen numbers cities 1..n in file order, which is the
+# order C hands out IDs.
+batch_script() {
+    awk -v queries="$2" -v seed="$3" '
+        /^NEXT_ID/ { next }
+        /^CITIES/ { cities = $2; section = "cities"; next }
+        /^EDGES/ { section = "edges"; next }
+        section == "cities" { $1 = ""; print "C" $0; next }
+        section == "edges" {
+            print "E", $1, $2, $3, 1
+            if ($4 > 0) print "T", $1, $2, $4
+            if ($5 > 0) print "B", $1, $2
+        }
+        END {
+            srand(seed)
+            for (i = 0; i < queries; i++) print "R", 1 + int(rand() * cities), 1 + int(rand() * cities)
+        }' "$1"
+}
+
+# The workload on the binaries in $1: engine_bench on both engines, then
+# main --batch.
+workload() {
+    BUILD=$1 BUILT=1 bench/engine_bench.sh --queries 200 --batch 200 --mutations 50000 --seed "$2" $generate
+    "$1/graphgen" $generate --seed "$2" --text "$1/pgo_graph.txt" 2>/dev/null
+    batch_script "$1/pgo_graph.txt" 200 "$2" > "$1/pgo_batch.txt"
+    rm -f "$1/pgo_graph.txt"
+    start=$(date +%s.%N)
+    "$1/main" --batch "$1/pgo_batch.txt" > /dev/null
+    end=$(date +%s.%N)
+    echo "$start $end" | awk '{ printf "{\"engine\": \"main --batch\", \"seconds\": %.6f}\n", $2 - $1 }'
+    rm -f "$1/pgo_batch.txt"
+}
+
+if [ "$1" = train ]; then
+    [ $# -eq 2 ] || { echo "usage: $0 train BUILD_DIR" >&2; exit 1; }
+    workload "$2" 1 > /dev/null
+    # Clang leaves raw profiles to merge; GCC's .gcda files are used as is.
+    if ls "$2"/pgo-profiles/*.profraw > /dev/null 2>&1; then
+        llvm-profdata merge -o "$2/pgo-profiles/spf.profdata" "$2"/pgo-profiles/*.profraw
+    fi
+    exit 0
+fi
+[ $# -gt 0 ] && generate="$*"
+
+RELEASE=${RELEASE:-build/release}
+PGO=${PGO:-build/pgo}
+ROUNDS=${ROUNDS:-3}
+targets="--target main engine_bench_main engine_bench_noSTL graphgen"
+
+{
+    cmake -S . -B "$RELEASE" -DCMAKE_BUILD_TYPE=Release -DSPF_PGO=
+    cmake --build "$RELEASE" -j $targets
+    rm -rf "$PGO/pgo-profiles"
+    cmake -S . -B "$PGO" -DCMAKE_BUILD_TYPE=Release -DSPF_PGO=generate
+    cmake --build "$PGO" -j $targets
+    cmake --build "$PGO" --target pgo_train
+    cmake -S . -B "$PGO" -DSPF_PGO=use
+    cmake --build "$PGO" -j $targets
+} >&2
+
+rm -f "$RELEASE/pgo_rounds.json" "$PGO/pgo_rounds.json"
+for round in $(seq "$ROUNDS"); do
+    workload "$RELEASE" 42 >> "$RELEASE/pgo_rounds.json"
+    workload "$PGO" 42 >> "$PGO/pgo_rounds.json"
+done
+
+# best BUILD ENGINE FIELD: the best value of FIELD over the rounds, the
+# highest for rates and the lowest for times.
+best() {
+    grep "\"engine\": \"$2\"" "$1/pgo_rounds.json" | grep -o "\"$3\": [0-9.]*" | sed 's/.*: //' |
+        awk -v field="$3" 'NR == 1 || (field == "queries_per_second" ? $1 > best : $1 < best) { best = $1 }
+                           END { print best }'
+}
+
+# row LABEL ENGINE FIELD
+row() {
+    base=$(best "$RELEASE" "$2" "$3")
+    tuned=$(best "$PGO" "$2" "$3")
+    echo "$base $tuned" | awk -v label="$1" -v engine="$2" -v field="$3" '{
+        speedup = field == "queries_per_second" ? $2 / $1 : $1 / $2
+        printf "| %s | %s | %s | %s | %.2fx |\n", engine, label, $1, $2, speedup }'
+}
+
+echo "# PGO speedup on query throughput"
+echo
+compiler=$(sed -n 's/^CMAKE_CXX_COMPILER:[A-Z]*=//p' "$PGO/CMakeCache.txt")
+echo "Workload: graphgen $generate; measured at seed 42, trained at seed 1;"
+echo "best of $ROUNDS rounds. Compiler: $("$compiler" --version | head -n 1)."
+echo
+echo "| engine | metric | Release | Release + PGO | speedup |"
+echo "|---|---|---|---|---|"
+for engine in main noSTL; do
+    row "batch queries/s" "$engine" queries_per_second
+    row "query mean us" "$engine" mean_us
+done
+row "load + 200 routes, s" "main --batch" seconds
+rm -f "$RELEASE/pgo_rounds.json" "$PGO/pgo_rounds.json"
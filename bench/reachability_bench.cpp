@@ -0,0 +1,100 @@
+// Directed reachability index on a side x side grid where each street is
+// one-way, in a random direction, with probability --one-way percent and
+// two-way otherwise. Prints the index build time on one thread and on all
+// of them, the SCC and condensation sizes, and how random query pairs fare:
+// how many are unreachable, how many of those the index rejects before any
+// search, and the latency of rejected pairs, of unreachable pairs that
+// still searched, and of reachable pairs.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -o reachability_bench bench/reachability_bench.cpp
+// Run:    ./reachability_bench [--side N] [--one-way P] [--queries N] [--seed S]
+
+#include "../spf.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+int main(int argc, char** argv) {
+    int side = 1000, oneWay = 100, queries = 100;
+    unsigned seed = 42;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        int value = atoi(argv[i + 1]);
+        if (option == "--side") side = value;
+        else if (option == "--one-way") oneWay = value;
+        else if (option == "--queries") queries = value;
+        else if (option == "--seed") seed = value;
+        else {
+            fprintf(stderr, "unknown option %s\n", option.c_str());
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pickDistance(10, 100), pickPercent(0, 99);
+    Graph g;
+    std::vector<std::string> names(side * side);
+    for (int i = 0; i < side * side; i++) names[i] = "c" + std::to_string(i);
+    g.addCities(names);
+    std::vector<NewRoute> routes;
+    auto street = [&](int a, int b) {
+        bool single = pickPercent(rng) < oneWay;
+        if (single && rng() % 2) std::swap(a, b);
+        routes.push_back(NewRoute(a, b, pickDistance(rng), single));
+    };
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            int id = y * side + x + 1;
+            if (x + 1 < side) street(id, id + 1);
+            if (y + 1 < side) street(id, id + side);
+        }
+    }
+    g.addRoutes(routes);
+
+    int workers = std::max(1u, std::thread::hardware_concurrency());
+    {
+        ReadGuard snapshot = g.snapshot();
+        for (int threads : {1, workers}) {
+            auto start = std::chrono::steady_clock::now();
+            std::shared_ptr<ReachabilityIndex> index = ReachabilityIndex::build(*snapshot, 0, threads);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            printf("build on %d thread(s): %.0f ms, %d components, %d DAG edges\n", threads, ms,
+                   index->componentCount, index->dagEdges);
+            if (workers == 1) break;
+        }
+    }
+    while (!g.reachabilityIndex()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::shared_ptr<const ReachabilityIndex> index = g.reachabilityIndex();
+
+    std::uniform_int_distribution<int> pickCity(1, side * side);
+    int unreachable = 0, rejected = 0, reachable = 0;
+    double rejectedMs = 0, searchedMs = 0, reachableMs = 0;
+    for (int q = 0; q < queries; q++) {
+        int src = pickCity(rng), dest = pickCity(rng);
+        bool maybe = index->mayReach(src, dest);
+        auto start = std::chrono::steady_clock::now();
+        PathResult result = g.dijkstra(src, dest);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (result.found()) {
+            reachable++;
+            reachableMs += ms;
+        } else if (!maybe) {
+            unreachable++;
+            rejected++;
+            rejectedMs += ms;
+        } else {
+            unreachable++;
+            searchedMs += ms;
+        }
+    }
+    printf("%d queries: %d reachable, %d unreachable, %d of them rejected by the index\n", queries, reachable,
+           unreachable, rejected);
+    printf("rejected     %10.4f ms/query\n", rejected ? rejectedMs / rejected : 0);
+    printf("searched     %10.4f ms/query (unreachable, not rejected)\n",
+           unreachable > rejected ? searchedMs / (unreachable - rejected) : 0);
+    printf("reachable    %10.4f ms/query\n", reachable ? reachableMs / reachable : 0);
+    return 0;
+}
@@ -0,0 +1,106 @@
+// Cost of time-dependent routing: Graph::dijkstraAt against Graph::dijkstra
+// on a side x side grid where every route carries one of a few shared daily
+// profiles, plus the raw throughput of TravelProfiles::travelTime.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -o td_bench bench/td_bench.cpp
+//         (add -mavx2 for the vector breakpoint search)
+// Run:    ./td_bench [--side N] [--profiles P] [--points B] [--queries N] [--seed S]
+
+#include "../spf.h"
+
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+// A rush-hour shaped profile: free flow at night, slower around 08:00 and
+// 17:30, with the peak height varying per template. The peaks are wide
+// enough that travel time never falls faster than the clock (FIFO).
+static std::vector<ProfilePoint> dailyProfile(int points, int base, int peak) {
+    std::vector<ProfilePoint> profile;
+    for (int i = 0; i < points; i++) {
+        int minute = i * TravelProfiles::DAY_MINUTES / points;
+        double morning = exp(-pow((minute - 480) / 120.0, 2));
+        double evening = exp(-pow((minute - 1050) / 150.0, 2));
+        profile.push_back(ProfilePoint(minute, base + (int)(peak * std::max(morning, evening))));
+    }
+    return profile;
+}
+
+int main(int argc, char** argv) {
+    int side = 300, templates = 16, points = 96, queries = 200;
+    unsigned seed = 42;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        int value = atoi(argv[i + 1]);
+        if (option == "--side") side = value;
+        else if (option == "--profiles") templates = value;
+        else if (option == "--points") points = value;
+        else if (option == "--queries") queries = value;
+        else if (option == "--seed") seed = value;
+        else {
+            fprintf(stderr, "unknown option %s\n", option.c_str());
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pickDistance(10, 100);
+    Graph g;
+    std::vector<std::string> names(side * side);
+    for (int i = 0; i < side * side; i++) names[i] = "c" + std::to_string(i);
+    g.addCities(names);
+    std::vector<NewRoute> routes;
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            int id = y * side + x + 1;
+            if (x + 1 < side) routes.push_back(NewRoute(id, id + 1, pickDistance(rng)));
+            if (y + 1 < side) routes.push_back(NewRoute(id, id + side, pickDistance(rng)));
+        }
+    }
+    g.addRoutes(routes);
+
+    std::vector<std::vector<ProfilePoint>> shapes;
+    for (int t = 0; t < templates; t++) {
+        shapes.push_back(dailyProfile(points, 10 + t * 5, 20 + t * 4));
+    }
+    std::vector<RouteProfile> profiled;
+    for (const NewRoute& route : routes) {
+        const std::vector<ProfilePoint>& shape = shapes[rng() % templates];
+        profiled.push_back(RouteProfile(route.from, route.to, shape));
+        profiled.push_back(RouteProfile(route.to, route.from, shape));
+    }
+    auto start = std::chrono::steady_clock::now();
+    int applied = g.setProfiles(profiled);
+    double setSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ReadGuard snapshot = g.snapshot();
+    printf("grid %dx%d: %d routes profiled in %.2fs, %zu distinct profiles of %d points\n", side, side, applied,
+           setSeconds, snapshot->profiles->sizes.size(), points);
+
+    std::uniform_int_distribution<int> pickCity(1, side * side), pickMinute(0, TravelProfiles::DAY_MINUTES - 1);
+    std::vector<std::array<int, 3>> pairs(queries);
+    for (std::array<int, 3>& query : pairs) query = {pickCity(rng), pickCity(rng), pickMinute(rng)};
+
+    long long checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (const std::array<int, 3>& query : pairs) checksum += g.dijkstra(query[0], query[1]).cost;
+    double staticSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for (const std::array<int, 3>& query : pairs) checksum += g.dijkstraAt(query[0], query[1], query[2]).cost;
+    double timedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const TravelProfiles& table = *snapshot->profiles;
+    int profileCount = table.sizes.size();
+    long long evaluations = 20000000;
+    start = std::chrono::steady_clock::now();
+    for (long long i = 0; i < evaluations; i++) {
+        checksum += table.travelTime(i % profileCount, (i * 7) % TravelProfiles::DAY_MINUTES);
+    }
+    double evalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("dijkstra    %8.2f ms/query\n", staticSeconds * 1000 / queries);
+    printf("dijkstraAt  %8.2f ms/query (%.2fx)\n", timedSeconds * 1000 / queries, timedSeconds / staticSeconds);
+    printf("travelTime  %8.2f ns/call (checksum %lld)\n", evalSeconds * 1e9 / evaluations, checksum);
+    return 0;
+}
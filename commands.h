@@ -0,0 +1,467 @@
+// Line protocol of main --batch and --serve, over the routing library in
+// spf.h. It belongs to the command-line client, not to the library; a
+// program that speaks the protocol includes it after spf.h.
+
+#ifndef SPF_COMMANDS_H
+#define SPF_COMMANDS_H
+
+#include "spf.h"
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Line-oriented command interpreter behind batch mode (--batch) and the
+// daemon (--serve). One command per line and one response line per command,
+// with decimal integers separated by spaces; blank lines are ignored. Every
+// command has a one-letter and a long name.
+//   R / route src dest [model]      -> OK cost hops id... | NOPATH | ERR reason
+//       model: distance | toll PER | truck HEIGHT WEIGHT picks the cost model
+//       (default: travel cost with traffic); cost is in the model's units
+//   K / kroutes src dest k          -> OK count cost:id,id... ... | NOPATH | ERR reason
+//   A / alternatives src dest n     -> as K, for up to n alternative routes
+//   D / depart src dest HH:MM       -> as R; cost is the travel time in minutes
+//   P / profile u v n HH:MM time... -> OK | ERR reason   (n = 0 removes it)
+//   O / toll u v toll               -> OK | ERR reason   (for R ... toll)
+//   L / limits u v height weight    -> OK | ERR reason   (for R ... truck; cm, kg)
+//   I / isochrone src budget        -> OK cities frontier id:cost... from>to:remaining...
+//   Q / routes n src dest ...       -> OK cost...   (n route queries; -1 = no path)
+//   B / block u v, U / unblock u v  -> OK | ERR reason
+//   T / traffic u v level           -> OK | ERR reason
+//   F / feed n u v level ...        -> OK applied autoBlocked rejected version
+//   C / city name                   -> OK id | ERR reason
+//   E / edge u v distance oneWay    -> OK | ERR reason   (add or update route)
+//   V / version                     -> OK version
+//   S / stats                       -> OK searches metric:p50,p90,p99,p999,max ...
+//                                      (ERR unless built with SPF_INSTRUMENT)
+// It keeps no state of its own, so one instance can serve many threads.
+class CommandProcessor {
+public:
+    explicit CommandProcessor(Graph& graph) : graph(graph) {}
+
+    // Runs every line in [begin, end) (the last one need not end in '\n')
+    // and appends the responses to out.
+    void execute(const char* begin, const char* end, std::string& out) {
+        while (begin < end) {
+            const char* lineEnd = static_cast<const char*>(memchr(begin, '\n', end - begin));
+            if (lineEnd == nullptr) lineEnd = end;
+            respond(RequestReader(begin, lineEnd), out);
+            begin = lineEnd + 1;
+        }
+    }
+
+private:
+    class RequestReader {
+    public:
+        const char* pos;
+        const char* end;
+
+        RequestReader(const char* begin, const char* end) : pos(begin), end(end) {
+            while (this->end > pos && (this->end[-1] == '\r' || this->end[-1] == ' ')) this->end--;
+        }
+
+        // The command letter; the long names map to their letters.
+        char command() {
+            std::string_view word = this->word();
+            if (word.size() == 1) return word[0];
+            static const std::pair<std::string_view, char> names[] = {
+                {"route", 'R'}, {"routes", 'Q'}, {"block", 'B'}, {"unblock", 'U'}, {"traffic", 'T'},
+                {"feed", 'F'}, {"city", 'C'}, {"edge", 'E'}, {"version", 'V'}, {"kroutes", 'K'},
+                {"alternatives", 'A'}, {"depart", 'D'}, {"profile", 'P'}, {"isochrone", 'I'},
+                {"stats", 'S'}, {"toll", 'O'}, {"limits", 'L'},
+            };
+            for (const std::pair<std::string_view, char>& name : names) {
+                if (name.first == word) return name.second;
+            }
+            return '?';
+        }
+
+        bool number(int& value) {
+            skipSpaces();
+            bool negative = pos < end && *pos == '-';
+            const char* digits = negative ? pos + 1 : pos;
+            long long parsed = 0;
+            const char* p = digits;
+            while (p < end && *p >= '0' && *p <= '9' && parsed <= INT_MAX) {
+                parsed = parsed * 10 + (*p++ - '0');
+            }
+            if (p == digits || parsed > INT_MAX || (p < end && *p != ' ')) {
+                return false;
+            }
+            pos = p;
+            value = negative ? -(int)parsed : (int)parsed;
+            return true;
+        }
+
+        // A time of day, as HH:MM or as minutes after midnight. Out-of-range
+        // values are left for the Graph to reject.
+        bool clock(int& minute) {
+            if (!number(minute)) {
+                int hours = 0, minutes = 0;
+                const char* p = pos;
+                if (!digits(p, hours) || p == end || *p++ != ':' || !digits(p, minutes) ||
+                    (p < end && *p != ' ') || minutes >= 60) {
+                    return false;
+                }
+                pos = p;
+                minute = hours * 60 + minutes;
+            }
+            return true;
+        }
+
+        // The next space-separated word; empty at the end of the line.
+        std::string_view word() {
+            skipSpaces();
+            const char* start = pos;
+            while (pos < end && *pos != ' ') pos++;
+            return std::string_view(start, pos - start);
+        }
+
+        std::string rest() {
+            skipSpaces();
+            return std::string(pos, end);
+        }
+
+        bool done() {
+            skipSpaces();
+            return pos == end;
+        }
+
+    private:
+        void skipSpaces() {
+            while (pos < end && *pos == ' ') pos++;
+        }
+
+        // One or two decimal digits.
+        bool digits(const char*& p, int& value) {
+            const char* start = p;
+            value = 0;
+            while (p < end && p - start < 2 && *p >= '0' && *p <= '9') {
+                value = value * 10 + (*p++ - '0');
+            }
+            return p > start;
+        }
+    };
+
+    Graph& graph;
+
+    // Largest per-toll price R takes: tolls * 255 still fits in the 32-bit
+    // route cost (see TollModel).
+    static const int MAX_PER_TOLL = 255;
+
+    // Runs R's query with the cost model named on the rest of the line.
+    // False if the rest isn't one.
+    bool route(RequestReader& request, int src, int dest, PathResult& path) {
+        std::string_view model = request.word();
+        int first, second;
+        if (model.empty()) {
+            path = graph.dijkstra(src, dest);
+        } else if (model == "distance" && request.done()) {
+            path = graph.dijkstra(src, dest, DistanceModel());
+        } else if (model == "toll" && request.number(first) && first >= 0 && first <= MAX_PER_TOLL && request.done()) {
+            path = graph.dijkstra(src, dest, TollModel<uint32_t>(first));
+        } else if (model == "truck" && request.number(first) && request.number(second) && request.done()) {
+            path = graph.dijkstra(src, dest, TruckModel(first, second));
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // Every status that leaves the route in the requested state is an OK.
+    static void reply(GraphStatus status, std::string& out) {
+        switch (status) {
+            case GraphStatus::OK:
+            case GraphStatus::ROUTE_UPDATED:
+            case GraphStatus::ALREADY_BLOCKED:
+            case GraphStatus::ALREADY_OPEN:
+            case GraphStatus::AUTO_BLOCKED:
+            case GraphStatus::STILL_BLOCKED:
+                out += "OK\n";
+                break;
+            case GraphStatus::EMPTY_NAME: out += "ERR empty name\n"; break;
+            case GraphStatus::DUPLICATE_NAME: out += "ERR duplicate name\n"; break;
+            case GraphStatus::NO_SOURCE: out += "ERR unknown source city\n"; break;
+            case GraphStatus::NO_DESTINATION: out += "ERR unknown destination city\n"; break;
+            case GraphStatus::NO_SUCH_CITY: out += "ERR unknown city\n"; break;
+            case GraphStatus::SAME_CITY: out += "ERR same city\n"; break;
+            case GraphStatus::INVALID_DISTANCE: out += "ERR distance must be positive\n"; break;
+            case GraphStatus::DISTANCE_TOO_LARGE: out += "ERR distance too large\n"; break;
+            case GraphStatus::INVALID_TRAFFIC: out += "ERR traffic level must be 0-10\n"; break;
+            case GraphStatus::NO_SUCH_ROUTE: out += "ERR no such route\n"; break;
+            case GraphStatus::INVALID_PROFILE: out += "ERR invalid profile\n"; break;
+            case GraphStatus::NOT_FIFO: out += "ERR profile is not FIFO\n"; break;
+            case GraphStatus::INVALID_TOLL: out += "ERR invalid toll\n"; break;
+            case GraphStatus::INVALID_LIMIT: out += "ERR limits must be positive\n"; break;
+        }
+    }
+
+    // The reply to a query that found nothing for a reason the command's own
+    // checks don't cover.
+    static void reply(PathStatus status, std::string& out) {
+        switch (status) {
+            case PathStatus::NO_PATH: out += "NOPATH\n"; break;
+            case PathStatus::EMPTY_GRAPH: out += "ERR empty graph\n"; break;
+            default: out += "ERR unknown city\n"; break;
+        }
+    }
+
+    // Search counters and wall time (nanoseconds) over every dijkstra()
+    // since startup, as percentiles.
+    static void stats(std::string& out) {
+#ifdef SPF_INSTRUMENT
+        static const char* names[SEARCH_METRICS] = {
+            "wall_ns", "settled", "relaxed", "pushes", "pops", "decrease_keys", "stale_pops",
+        };
+        out += "OK ";
+        out += std::to_string(SearchStats::summarize(WALL_NANOSECONDS).count);
+        for (int metric = 0; metric < SEARCH_METRICS; metric++) {
+            SearchStats::Summary summary = SearchStats::summarize(SearchMetric(metric));
+            out += ' ';
+            out += names[metric];
+            const uint64_t values[] = {summary.p50, summary.p90, summary.p99, summary.p999, summary.maximum};
+            for (size_t i = 0; i < 5; i++) {
+                out += i == 0 ? ':' : ',';
+                out += std::to_string(values[i]);
+            }
+        }
+        out += '\n';
+#else
+        out += "ERR built without SPF_INSTRUMENT\n";
+#endif
+    }
+
+    void respond(RequestReader request, std::string& out) {
+        if (request.done()) return;
+
+        char command = request.command();
+        int a, b, c, d, n;
+        switch (command) {
+            case 'R':
+            case 'D': {
+                PathResult path;
+                bool valid = request.number(a) && request.number(b);
+                if (command == 'R') {
+                    valid = valid && route(request, a, b, path);
+                } else if (valid && request.clock(c) && request.done()) {
+                    path = graph.dijkstraAt(a, b, c);
+                } else {
+                    valid = false;
+                }
+                if (!valid) {
+                    out += command == 'R' ? "ERR usage: R src dest [distance | toll 0-255 | truck cm kg]\n"
+                                          : "ERR usage: D src dest HH:MM\n";
+                    break;
+                }
+                if (path.status == PathStatus::INVALID_DEPARTURE) {
+                    out += "ERR departure must be 00:00-23:59\n";
+                } else if (path.found()) {
+                    out += "OK ";
+                    out += std::to_string(path.cost);
+                    out += ' ';
+                    out += std::to_string(path.hops);
+                    for (int id : path.nodes) {
+                        out += ' ';
+                        out += std::to_string(id);
+                    }
+                    out += '\n';
+                } else {
+                    reply(path.status, out);
+                }
+                break;
+            }
+            case 'Q': {
+                if (!request.number(n) || n < 0) {
+                    out += "ERR usage: Q n src dest ...\n";
+                    break;
+                }
+                std::string costs = "OK";
+                bool valid = true;
+                for (int i = 0; i < n && valid; i++) {
+                    valid = request.number(a) && request.number(b);
+                    costs += ' ';
+                    costs += valid ? std::to_string(graph.dijkstra(a, b).cost) : std::string();
+                }
+                if (!valid || !request.done()) {
+                    out += "ERR usage: Q n src dest ...\n";
+                } else {
+                    out += costs;
+                    out += '\n';
+                }
+                break;
+            }
+            case 'K':
+            case 'A': {
+                if (!request.number(a) || !request.number(b) || !request.number(n) || !request.done()) {
+                    out += command == 'K' ? "ERR usage: K src dest k\n" : "ERR usage: A src dest n\n";
+                    break;
+                }
+                std::vector<PathResult> paths = command == 'K' ? graph.kShortestPaths(a, b, n)
+                                                          : graph.alternativeRoutes(a, b, n);
+                if (!paths.empty() && !paths[0].found()) {
+                    reply(paths[0].status, out);
+                    break;
+                }
+                // OK count, then cost:id,id,... per path, cheapest first.
+                out += "OK ";
+                out += std::to_string(paths.size());
+                for (const PathResult& path : paths) {
+                    out += ' ';
+                    out += std::to_string(path.cost);
+                    for (size_t i = 0; i < path.nodes.size(); i++) {
+                        out += i == 0 ? ':' : ',';
+                        out += std::to_string(path.nodes[i]);
+                    }
+                }
+                out += '\n';
+                break;
+            }
+            case 'I': {
+                if (!request.number(a) || !request.number(b) || !request.done()) {
+                    out += "ERR usage: I src budget\n";
+                    break;
+                }
+                Isochrone area = graph.reachableWithin(a, b);
+                if (area.status == PathStatus::INVALID_BUDGET) {
+                    out += "ERR budget cannot be negative\n";
+                    break;
+                }
+                if (area.status != PathStatus::FOUND) {
+                    reply(area.status, out);
+                    break;
+                }
+                out += "OK ";
+                out += std::to_string(area.cities.size());
+                out += ' ';
+                out += std::to_string(area.frontier.size());
+                for (const ReachedCity& city : area.cities) {
+                    out += ' ';
+                    out += std::to_string(city.city);
+                    out += ':';
+                    out += std::to_string(city.cost);
+                }
+                for (const FrontierRoute& route : area.frontier) {
+                    out += ' ';
+                    out += std::to_string(route.from);
+                    out += '>';
+                    out += std::to_string(route.to);
+                    out += ':';
+                    out += std::to_string(route.remaining);
+                }
+                out += '\n';
+                break;
+            }
+            case 'P': {
+                std::vector<ProfilePoint> points;
+                bool valid = request.number(a) && request.number(b) && request.number(n) && n >= 0;
+                for (int i = 0; i < n && valid; i++) {
+                    valid = request.clock(c) && request.number(d);
+                    points.push_back(ProfilePoint(c, d));
+                }
+                if (!valid || !request.done()) {
+                    out += "ERR usage: P u v n HH:MM time ...\n";
+                } else {
+                    reply(graph.setProfile(a, b, points), out);
+                }
+                break;
+            }
+            case 'O':
+                if (!request.number(a) || !request.number(b) || !request.number(c) || !request.done()) {
+                    out += "ERR usage: O u v toll\n";
+                } else {
+                    reply(graph.setToll(a, b, c), out);
+                }
+                break;
+            case 'L':
+                if (!request.number(a) || !request.number(b) || !request.number(c) || !request.number(d) ||
+                    !request.done()) {
+                    out += "ERR usage: L u v height weight\n";
+                } else {
+                    reply(graph.setLimits(a, b, c, d), out);
+                }
+                break;
+            case 'B':
+            case 'U': {
+                if (!request.number(a) || !request.number(b) || !request.done()) {
+                    out += command == 'B' ? "ERR usage: B u v\n" : "ERR usage: U u v\n";
+                } else {
+                    reply(command == 'B' ? graph.blockRoute(a, b) : graph.unblockRoute(a, b), out);
+                }
+                break;
+            }
+            case 'T': {
+                if (!request.number(a) || !request.number(b) || !request.number(c) || !request.done()) {
+                    out += "ERR usage: T u v level\n";
+                } else {
+                    reply(graph.setTraffic(a, b, c), out);
+                }
+                break;
+            }
+            case 'F': {
+                std::vector<TrafficUpdate> updates;
+                bool valid = request.number(n) && n >= 0;
+                for (int i = 0; i < n && valid; i++) {
+                    valid = request.number(a) && request.number(b) && request.number(c);
+                    updates.push_back(TrafficUpdate(a, b, c));
+                }
+                if (!valid || !request.done()) {
+                    out += "ERR usage: F n u v level ...\n";
+                    break;
+                }
+                TrafficBatchReport report = graph.applyTrafficBatch(updates);
+                out += "OK ";
+                out += std::to_string(report.applied);
+                out += ' ';
+                out += std::to_string(report.autoBlocked);
+                out += ' ';
+                out += std::to_string(report.rejected);
+                out += ' ';
+                out += std::to_string(report.version);
+                out += '\n';
+                break;
+            }
+            case 'C': {
+                int id;
+                GraphStatus status = graph.addCity(request.rest(), &id);
+                if (status == GraphStatus::OK) {
+                    out += "OK ";
+                    out += std::to_string(id);
+                    out += '\n';
+                } else {
+                    reply(status, out);
+                }
+                break;
+            }
+            case 'E': {
+                if (!request.number(a) || !request.number(b) || !request.number(c) || !request.number(d) ||
+                    !request.done()) {
+                    out += "ERR usage: E u v distance oneWay\n";
+                } else {
+                    reply(graph.addEdge(a, b, c, d != 0), out);
+                }
+                break;
+            }
+            case 'V': {
+                out += "OK ";
+                out += std::to_string(graph.getVersion());
+                out += '\n';
+                break;
+            }
+            case 'S': {
+                if (!request.done()) {
+                    out += "ERR usage: S\n";
+                    break;
+                }
+                stats(out);
+                break;
+            }
+            default:
+                out += "ERR unknown command\n";
+                break;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,245 @@
+// Console text of the interactive menu in main.cpp, over the routing
+// library in spf.h. Like commands.h it belongs to the command-line client.
+
+#ifndef SPF_CONSOLE_H
+#define SPF_CONSOLE_H
+
+#include "spf.h"
+
+#include <iostream>
+#include <string>
+#include <string_view>
+
+// Presentation layer of the interactive menu: all console text for Graph
+// results and statuses. Graph itself never prints.
+class ConsoleView {
+public:
+    explicit ConsoleView(const Graph& graph) : graph(graph) {}
+
+    void cityAdded(const std::string& name, GraphStatus status, int id) const {
+        switch (status) {
+            case GraphStatus::OK:
+                std::cout << "City '" << name << "' added with ID: " << id << '\n';
+                break;
+            case GraphStatus::EMPTY_NAME:
+                std::cout << "Error: City name cannot be empty!\n";
+                break;
+            case GraphStatus::DUPLICATE_NAME:
+                std::cout << "Error: City '" << name << "' already exists with ID: " << id << '\n';
+                break;
+            default:
+                unexpected(status);
+        }
+    }
+
+    void routeAdded(int u, int v, int w, GraphStatus status) const {
+        switch (status) {
+            case GraphStatus::OK:
+                std::cout << "Route added between " << graph.cityName(u) << " and " << graph.cityName(v)
+                     << " with distance: " << w << '\n';
+                break;
+            case GraphStatus::ROUTE_UPDATED:
+                std::cout << "Warning: Route already exists between " << graph.cityName(u)
+                     << " and " << graph.cityName(v) << ". Updating distance to " << w << '\n';
+                break;
+            case GraphStatus::NO_SOURCE:
+                std::cout << "Error: Source city with ID " << u << " does not exist!\n";
+                break;
+            case GraphStatus::NO_DESTINATION:
+                std::cout << "Error: Destination city with ID " << v << " does not exist!\n";
+                break;
+            case GraphStatus::SAME_CITY:
+                std::cout << "Error: Cannot create a route from a city to itself!\n";
+                break;
+            case GraphStatus::INVALID_DISTANCE:
+                std::cout << "Error: Distance must be positive!\n";
+                break;
+            case GraphStatus::DISTANCE_TOO_LARGE:
+                std::cout << "Error: Distance cannot exceed " << Route::MAX_DISTANCE << "!\n";
+                break;
+            default:
+                unexpected(status);
+        }
+    }
+
+    void routeBlocked(int u, int v, GraphStatus status) const {
+        blockingChanged(u, v, status, " has been blocked!\n");
+    }
+
+    void routeUnblocked(int u, int v, GraphStatus status) const {
+        blockingChanged(u, v, status, " has been unblocked!\n");
+    }
+
+    void trafficSet(int u, int v, int level, GraphStatus status) const {
+        switch (status) {
+            case GraphStatus::OK:
+                std::cout << "Traffic set to " << level << " on route from "
+                     << graph.cityName(u) << " to " << graph.cityName(v) << '\n';
+                break;
+            case GraphStatus::AUTO_BLOCKED:
+                std::cout << "Traffic set to " << level << " on route from "
+                     << graph.cityName(u) << " to " << graph.cityName(v)
+                     << ". Route AUTO-BLOCKED due to high traffic!\n";
+                break;
+            case GraphStatus::STILL_BLOCKED:
+                std::cout << "Traffic set to " << level << " on route from "
+                     << graph.cityName(u) << " to " << graph.cityName(v)
+                     << ". Route is still BLOCKED (use unblock to open).\n";
+                break;
+            case GraphStatus::INVALID_TRAFFIC:
+                std::cout << "Error: Traffic level must be between 0 and 10!\n";
+                break;
+            default:
+                routeError(u, v, status);
+        }
+    }
+
+    void path(const PathResult& result) const {
+        ReadGuard names = graph.snapshot();
+        switch (result.status) {
+            case PathStatus::EMPTY_GRAPH:
+                std::cout << "Error: No cities in the graph!\n";
+                return;
+            case PathStatus::INVALID_SOURCE:
+                std::cout << "Error: Source city with ID " << result.src << " does not exist!\n";
+                return;
+            case PathStatus::INVALID_DESTINATION:
+                std::cout << "Error: Destination city with ID " << result.dest << " does not exist!\n";
+                return;
+            case PathStatus::INVALID_DEPARTURE:
+                std::cout << "Error: Departure time must be between 00:00 and 23:59!\n";
+                return;
+            case PathStatus::INVALID_BUDGET:
+                std::cout << "Error: Budget cannot be negative!\n";
+                return;
+            case PathStatus::SAME_CITY:
+                std::cout << "\nSource and destination are the same!\n";
+                std::cout << "City: " << name(*names, result.src) << " (ID: " << result.src << ")\n";
+                std::cout << "Total Distance: 0 units\n";
+                return;
+            case PathStatus::NO_PATH:
+                std::cout << "\nNo path exists between " << name(*names, result.src)
+                     << " (ID: " << result.src << ") and " << name(*names, result.dest)
+                     << " (ID: " << result.dest << ").\n";
+                std::cout << "These cities are in different disconnected components or all routes are blocked.\n";
+                return;
+            case PathStatus::FOUND:
+                break;
+        }
+
+        std::cout << "\n=== Shortest Path Result ===\n";
+        std::cout << "From: " << name(*names, result.src) << " (ID: " << result.src << ")\n";
+        std::cout << "To: " << name(*names, result.dest) << " (ID: " << result.dest << ")\n";
+        std::cout << "Path: ";
+        for (size_t i = 0; i < result.nodes.size(); i++) {
+            if (i > 0) std::cout << " -> ";
+            std::cout << name(*names, result.nodes[i]);
+        }
+        std::cout << "\nTotal Effective Cost (with traffic): " << result.cost << " units\n";
+        std::cout << "Number of hops: " << result.hops << '\n';
+    }
+
+    void cities() const {
+        ReadGuard snapshot = graph.snapshot();
+        if (snapshot->cityCount == 0) {
+            std::cout << "No cities in the graph.\n";
+            return;
+        }
+        std::cout << "\n=== Cities in Graph ===\n";
+        for (int id = 1; id < snapshot->nextCityId; id++) {
+            if (!snapshot->hasCity(id)) continue;
+            std::cout << "ID: " << id << " - Name: " << snapshot->city(id).name << '\n';
+        }
+    }
+
+    void structure() const {
+        ReadGuard snapshot = graph.snapshot();
+        if (snapshot->cityCount == 0) {
+            std::cout << "No cities in the graph.\n";
+            return;
+        }
+        std::cout << "\n=== Graph Structure ===\n";
+        for (int id = 1; id < snapshot->nextCityId; id++) {
+            if (!snapshot->hasCity(id)) continue;
+            std::cout << snapshot->city(id).name << " (ID: " << id << ") -> ";
+            const GraphVersion::LinkBlock& links = snapshot->links(id);
+            if (links.empty()) {
+                std::cout << "No connections";
+            } else {
+                for (const Link& link : links) {
+                    Route route = snapshot->route(link);
+                    std::cout << snapshot->city(route.neighbor).name << "(Dist:" << route.distance()
+                         << ", Traffic:" << route.traffic();
+                    if (route.isBlocked()) {
+                        std::cout << ", BLOCKED";
+                    }
+                    std::cout << ") ";
+                }
+            }
+            std::cout << '\n';
+        }
+    }
+
+    void trafficFeedApplied(const TrafficBatchReport& report) const {
+        std::cout << "Traffic feed applied: " << report.applied << " updates ("
+             << report.autoBlocked << " auto-blocked, " << report.rejected << " rejected) in "
+             << report.microseconds << " us. Graph version: " << report.version << '\n';
+    }
+
+    void cityFound(const std::string& name, int id) const {
+        if (id == -1) {
+            std::cout << "No city named '" << name << "' exists.\n";
+        } else {
+            std::cout << "City '" << name << "' has ID: " << id << '\n';
+        }
+    }
+
+    void graphCleared() const {
+        std::cout << "Graph cleared successfully!\n";
+    }
+
+private:
+    const Graph& graph;
+
+    static std::string_view name(const GraphVersion& snapshot, int id) {
+        return snapshot.hasCity(id) ? snapshot.city(id).name : std::string_view();
+    }
+
+    void blockingChanged(int u, int v, GraphStatus status, const char* changed) const {
+        switch (status) {
+            case GraphStatus::OK:
+                std::cout << "Route from " << graph.cityName(u) << " to " << graph.cityName(v) << changed;
+                break;
+            case GraphStatus::ALREADY_BLOCKED:
+                std::cout << "Route from " << graph.cityName(u) << " to " << graph.cityName(v)
+                     << " is already blocked!\n";
+                break;
+            case GraphStatus::ALREADY_OPEN:
+                std::cout << "Route from " << graph.cityName(u) << " to " << graph.cityName(v)
+                     << " is already open!\n";
+                break;
+            default:
+                routeError(u, v, status);
+        }
+    }
+
+    void routeError(int u, int v, GraphStatus status) const {
+        switch (status) {
+            case GraphStatus::NO_SUCH_CITY:
+                std::cout << "Error: One or both cities do not exist!\n";
+                break;
+            case GraphStatus::NO_SUCH_ROUTE:
+                std::cout << "Error: No route exists from " << graph.cityName(u) << " to " << graph.cityName(v)
+                          << "!\n";
+                break;
+            default:
+                unexpected(status);
+        }
+    }
+
+    static void unexpected(GraphStatus status) {
+        std::cout << "Error: Unexpected status " << static_cast<int>(status) << "!\n";
+    }
+};
+
+#endif
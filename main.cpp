@@ -1,437 +1,367 @@
-#include <iostream>
-#include <unordered_map>
-#include <list>
-#include <vector>
-#include <climits>
-#include <string>
+// Command-line client of the routing library in spf.h: the interactive
+// menu, batch mode (--batch) and the daemon (--serve).
+
+#include "spf.h"
+#include "commands.h"
+#include "console.h"
+
+#include <cstdio>
+#ifdef __linux__
+#include <deque>
+#include <csignal>
+#include <cerrno>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
 using namespace std;
 
-class City {
-public:
-    int distance;
-    string name;
+#ifdef __linux__
+static volatile sig_atomic_t serverStopRequested = 0;
+static int serverWakeFd = -1;
 
-    City(string name = "", int distance = INT_MAX) : name(name), distance(distance) {}
-};
+static void requestServerStop(int) {
+    serverStopRequested = 1;
+    uint64_t one = 1;
+    ssize_t ignored = write(serverWakeFd, &one, sizeof(one));
+    (void)ignored;
+}
 
-class Route {
+// Daemon mode (--serve). One epoll thread owns every socket: it accepts,
+// reads and writes, and hands each connection's complete request lines to a
+// worker pool that runs them through a CommandProcessor on the shared Graph.
+// A connection has at most one job in flight, so responses come back in
+// request order even when a client pipelines.
+class RouteServer {
 public:
-    int neighbor;
-    int distance;
-    int traffic;
-    bool isBlocked;
-    
-    Route(int n, int d) : neighbor(n), distance(d), traffic(0), isBlocked(false) {}
-};
-
-class MinHeap {
-private:
-    vector<pair<int, int>> heap;
-    unordered_map<int, int> indexMap;
-
-    int parent(int i) { return (i - 1) / 2; }
-    int leftChild(int i) { return 2 * i + 1; }
-    int rightChild(int i) { return 2 * i + 2; }
-
-    void swap(int i, int j) {
-        indexMap[heap[i].second] = j;
-        indexMap[heap[j].second] = i;
-        pair<int, int> temp = heap[i];
-        heap[i] = heap[j];
-        heap[j] = temp;
-    }
-
-    void heapifyUp(int i) {
-        while (i > 0 && heap[parent(i)].first > heap[i].first) {
-            swap(i, parent(i));
-            i = parent(i);
+    RouteServer(Graph& graph, int workerCount)
+        : commands(graph), listenFd(-1), epollFd(epoll_create1(EPOLL_CLOEXEC)),
+          wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), stopping(false) {
+        watch(wakeFd, EPOLLIN, EPOLL_CTL_ADD);
+        for (int i = 0; i < workerCount; i++) {
+            workers.emplace_back([this] { work(); });
         }
     }
 
-    void heapifyDown(int i) {
-        int minIndex = i;
-        int left = leftChild(i);
-        int right = rightChild(i);
-
-        if (left < heap.size() && heap[left].first < heap[minIndex].first) {
-            minIndex = left;
+    ~RouteServer() {
+        {
+            lock_guard<mutex> lock(jobLock);
+            stopping = true;
         }
-        if (right < heap.size() && heap[right].first < heap[minIndex].first) {
-            minIndex = right;
+        jobReady.notify_all();
+        for (thread& worker : workers) {
+            worker.join();
         }
-
-        if (i != minIndex) {
-            swap(i, minIndex);
-            heapifyDown(minIndex);
+        for (auto& entry : connections) {
+            close(entry.first);
         }
-    }
-
-public:
-    void push(int distance, int node) {
-        if (indexMap.find(node) != indexMap.end()) {
-            int idx = indexMap[node];
-            if (distance < heap[idx].first) {
-                heap[idx].first = distance;
-                heapifyUp(idx);
-            }
-            return;
-        }
-
-        heap.push_back({distance, node});
-        int idx = heap.size() - 1;
-        indexMap[node] = idx;
-        heapifyUp(idx);
-    }
-
-    pair<int, int> top() {
-        if (heap.empty()) {
-            return {-1, -1};
-        }
-        return heap[0];
-    }
-
-    void pop() {
-        if (heap.empty()) return;
-
-        indexMap.erase(heap[0].second);
-
-        if (heap.size() == 1) {
-            heap.pop_back();
-            return;
+        if (listenFd >= 0) {
+            close(listenFd);
         }
-
-        heap[0] = heap.back();
-        heap.pop_back();
-        
-        if (!heap.empty()) {
-            indexMap[heap[0].second] = 0;
-            heapifyDown(0);
+        if (!unixPath.empty()) {
+            unlink(unixPath.c_str());
         }
+        close(wakeFd);
+        close(epollFd);
     }
 
-    bool empty() {
-        return heap.size() == 0;
-    }
-
-    int size() {
-        return heap.size();
-    }
-};
-
-class Graph {
-private:
-    int nextCityId;
-
-public:
-    unordered_map<int, list<Route>> adj;
-    unordered_map<int, City> cities;
-
-    Graph() : nextCityId(1) {}
-
-    int addCity(const string& name) {
-        if (name.empty()) {
-            cout << "Error: City name cannot be empty!\n";
-            return -1;
-        }
-        
-        for (auto& city : cities) {
-            if (city.second.name == name) {
-                cout << "Error: City '" << name << "' already exists with ID: " << city.first << endl;
-                return -1;
+    RouteServer(const RouteServer&) = delete;
+    RouteServer& operator=(const RouteServer&) = delete;
+
+    // address is "unix:/path/to/socket", "host:port" or just "port"
+    // (loopback only).
+    bool listenOn(const string& address) {
+        if (address.compare(0, 5, "unix:") == 0) {
+            sockaddr_un local;
+            memset(&local, 0, sizeof(local));
+            local.sun_family = AF_UNIX;
+            string path = address.substr(5);
+            if (path.empty() || path.size() >= sizeof(local.sun_path)) {
+                cout << "Error: Invalid socket path '" << path << "'!\n";
+                return false;
             }
-        }
-        
-        int id = nextCityId++;
-        cities[id] = City(name);
-        cout << "City '" << name << "' added with ID: " << id << endl;
-        return id;
-    }
-
-    void addEdge(int u, int v, int w, bool direction) {
-        if (cities.find(u) == cities.end()) {
-            cout << "Error: Source city with ID " << u << " does not exist!\n";
-            return;
-        }
-        if (cities.find(v) == cities.end()) {
-            cout << "Error: Destination city with ID " << v << " does not exist!\n";
-            return;
-        }
-        if (u == v) {
-            cout << "Error: Cannot create a route from a city to itself!\n";
-            return;
-        }
-        if (w <= 0) {
-            cout << "Error: Distance must be positive!\n";
-            return;
-        }
-        
-        for (auto& route : adj[u]) {
-            if (route.neighbor == v) {
-                cout << "Warning: Route already exists between " << cities[u].name 
-                     << " and " << cities[v].name << ". Updating distance to " << w << endl;
-                route.distance = w;
-                if (!direction) {
-                    for (auto& reverseRoute : adj[v]) {
-                        if (reverseRoute.neighbor == u) {
-                            reverseRoute.distance = w;
-                            break;
-                        }
-                    }
-                }
-                return;
+            memcpy(local.sun_path, path.c_str(), path.size() + 1);
+            listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            unlink(path.c_str());
+            if (listenFd < 0 || bind(listenFd, (sockaddr*)&local, sizeof(local)) < 0) {
+                return listenFailed(address);
             }
-        }
-        
-        adj[u].push_back(Route(v, w));
-        if (!direction) {
-            adj[v].push_back(Route(u, w));
-        }
-        cout << "Route added between " << cities[u].name << " and " << cities[v].name 
-             << " with distance: " << w << endl;
-    }
-
-    void blockRoute(int u, int v) {
-        if (cities.find(u) == cities.end() || cities.find(v) == cities.end()) {
-            cout << "Error: One or both cities do not exist!\n";
-            return;
-        }
-
-        bool found = false;
-        for (auto& route : adj[u]) {
-            if (route.neighbor == v) {
-                if (route.isBlocked) {
-                    cout << "Route from " << cities[u].name << " to " << cities[v].name 
-                         << " is already blocked!\n";
-                } else {
-                    route.isBlocked = true;
-                    cout << "Route from " << cities[u].name << " to " << cities[v].name 
-                         << " has been blocked!\n";
-                }
-                found = true;
-                break;
+            unixPath = path;
+        } else {
+            size_t colon = address.rfind(':');
+            string host = colon == string::npos ? "127.0.0.1" : address.substr(0, colon);
+            int port = atoi(address.c_str() + (colon == string::npos ? 0 : colon + 1));
+            sockaddr_in inet;
+            memset(&inet, 0, sizeof(inet));
+            inet.sin_family = AF_INET;
+            inet.sin_port = htons(port);
+            if (port <= 0 || port > 65535 || inet_pton(AF_INET, host.c_str(), &inet.sin_addr) != 1) {
+                cout << "Error: Invalid address '" << address << "'!\n";
+                return false;
+            }
+            listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            int on = 1;
+            if (listenFd < 0 || setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 ||
+                bind(listenFd, (sockaddr*)&inet, sizeof(inet)) < 0) {
+                return listenFailed(address);
             }
         }
-
-        if (!found) {
-            cout << "Error: No route exists from " << cities[u].name << " to " << cities[v].name << "!\n";
+        if (listen(listenFd, SOMAXCONN) < 0) {
+            return listenFailed(address);
         }
+        watch(listenFd, EPOLLIN, EPOLL_CTL_ADD);
+        return true;
     }
 
-    void unblockRoute(int u, int v) {
-        if (cities.find(u) == cities.end() || cities.find(v) == cities.end()) {
-            cout << "Error: One or both cities do not exist!\n";
-            return;
-        }
-
-        bool found = false;
-        for (auto& route : adj[u]) {
-            if (route.neighbor == v) {
-                if (!route.isBlocked) {
-                    cout << "Route from " << cities[u].name << " to " << cities[v].name 
-                         << " is already open!\n";
-                } else {
-                    route.isBlocked = false;
-                    cout << "Route from " << cities[u].name << " to " << cities[v].name 
-                         << " has been unblocked!\n";
-                }
-                found = true;
+    // Serves until SIGINT or SIGTERM.
+    void run() {
+        serverWakeFd = wakeFd;
+        signal(SIGINT, requestServerStop);
+        signal(SIGTERM, requestServerStop);
+        signal(SIGPIPE, SIG_IGN);
+
+        epoll_event events[64];
+        while (!serverStopRequested) {
+            int ready = epoll_wait(epollFd, events, 64, -1);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                cout << "Error: epoll_wait failed: " << strerror(errno) << endl;
                 break;
             }
-        }
-
-        if (!found) {
-            cout << "Error: No route exists from " << cities[u].name << " to " << cities[v].name << "!\n";
-        }
-    }
-
-    void setTraffic(int u, int v, int trafficLevel) {
-        if (cities.find(u) == cities.end() || cities.find(v) == cities.end()) {
-            cout << "Error: One or both cities do not exist!\n";
-            return;
-        }
-
-        if (trafficLevel < 0 || trafficLevel > 10) {
-            cout << "Error: Traffic level must be between 0 and 10!\n";
-            return;
-        }
-
-        bool found = false;
-        for (auto& route : adj[u]) {
-            if (route.neighbor == v) {
-                route.traffic = trafficLevel;
-                
-                if (trafficLevel >= 8 && !route.isBlocked) {
-                    route.isBlocked = true;
-                    cout << "Traffic set to " << trafficLevel << " on route from " 
-                         << cities[u].name << " to " << cities[v].name 
-                         << ". Route AUTO-BLOCKED due to high traffic!\n";
-                } else if (trafficLevel < 8 && route.isBlocked) {
-                    cout << "Traffic set to " << trafficLevel << " on route from " 
-                         << cities[u].name << " to " << cities[v].name 
-                         << ". Route is still BLOCKED (use unblock to open).\n";
+            for (int i = 0; i < ready; i++) {
+                int fd = events[i].data.fd;
+                if (fd == listenFd) {
+                    acceptAll();
+                } else if (fd == wakeFd) {
+                    uint64_t count;
+                    while (read(wakeFd, &count, sizeof(count)) > 0) {}
+                    collectFinished();
                 } else {
-                    cout << "Traffic set to " << trafficLevel << " on route from " 
-                         << cities[u].name << " to " << cities[v].name << endl;
+                    auto entry = connections.find(fd);
+                    if (entry == connections.end()) continue;
+                    shared_ptr<Connection> connection = entry->second;
+                    if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                        readFrom(connection);
+                    }
+                    if (connection->fd >= 0 && (events[i].events & EPOLLOUT)) {
+                        flush(connection);
+                        dispatch(connection);
+                    }
                 }
-                found = true;
-                break;
             }
         }
+    }
 
-        if (!found) {
-            cout << "Error: No route exists from " << cities[u].name << " to " << cities[v].name << "!\n";
-        }
+private:
+    // Requests buffered without a newline beyond this close the connection,
+    // and responses buffered beyond it hold back the connection's next job.
+    static const size_t MAX_BUFFERED = 1 << 22;
+
+    class Connection {
+    public:
+        int fd;
+        string in;
+        string out;
+        size_t sent;
+        bool busy;       // a job for this connection is queued or running
+        bool peerClosed; // the client shut down its side
+        bool writing;    // registered for EPOLLOUT
+        // Set by the event loop when the socket is closed, so a worker can
+        // skip a job nobody will read the answers to.
+        atomic<bool> abandoned;
+
+        Connection(int fd) : fd(fd), sent(0), busy(false), peerClosed(false), writing(false), abandoned(false) {}
+    };
+
+    class Job {
+    public:
+        shared_ptr<Connection> connection;
+        string requests;
+        string responses;
+    };
+
+    CommandProcessor commands;
+    int listenFd;
+    int epollFd;
+    int wakeFd;
+    string unixPath;
+    unordered_map<int, shared_ptr<Connection>> connections;
+
+    vector<thread> workers;
+    mutex jobLock;
+    condition_variable jobReady;
+    deque<Job> pending;
+    bool stopping;
+
+    mutex doneLock;
+    vector<Job> finished;
+
+    bool listenFailed(const string& address) {
+        cout << "Error: Cannot listen on " << address << ": " << strerror(errno) << endl;
+        if (listenFd >= 0) {
+            close(listenFd);
+            listenFd = -1;
+        }
+        return false;
     }
 
-    void displayCities() {
-        if (cities.empty()) {
-            cout << "No cities in the graph.\n";
-            return;
-        }
-        cout << "\n=== Cities in Graph ===\n";
-        for (auto& city : cities) {
-            cout << "ID: " << city.first << " - Name: " << city.second.name << endl;
-        }
+    void watch(int fd, uint32_t events, int operation) {
+        epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, operation, fd, &event);
     }
 
-    void displayGraph() {
-        if (cities.empty()) {
-            cout << "No cities in the graph.\n";
-            return;
-        }
-        cout << "\n=== Graph Structure ===\n";
-        for (auto& city : cities) {
-            cout << cities[city.first].name << " (ID: " << city.first << ") -> ";
-            if (adj[city.first].empty()) {
-                cout << "No connections";
-            } else {
-                for (auto& route : adj[city.first]) {
-                    cout << cities[route.neighbor].name << "(Dist:" << route.distance 
-                         << ", Traffic:" << route.traffic;
-                    if (route.isBlocked) {
-                        cout << ", BLOCKED";
-                    }
-                    cout << ") ";
-                }
+    void work() {
+        for (;;) {
+            Job job;
+            {
+                unique_lock<mutex> lock(jobLock);
+                jobReady.wait(lock, [this] { return stopping || !pending.empty(); });
+                if (stopping) return;
+                job = move(pending.front());
+                pending.pop_front();
+            }
+            if (!job.connection->abandoned.load(memory_order_relaxed)) {
+                commands.execute(job.requests.data(), job.requests.data() + job.requests.size(), job.responses);
+            }
+            {
+                lock_guard<mutex> lock(doneLock);
+                finished.push_back(move(job));
             }
-            cout << endl;
+            uint64_t one = 1;
+            ssize_t ignored = write(wakeFd, &one, sizeof(one));
+            (void)ignored;
         }
     }
 
-    int calculateEffectiveCost(int distance, int traffic) {
-       return distance + (distance * traffic / 10); 
+    void acceptAll() {
+        for (;;) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            connections[fd] = make_shared<Connection>(fd);
+            watch(fd, EPOLLIN, EPOLL_CTL_ADD);
+        }
     }
 
-    void dijkstra(int src, int dest) {
-        if (cities.empty()) {
-            cout << "Error: No cities in the graph!\n";
-            return;
-        }
-        if (cities.find(src) == cities.end()) {
-            cout << "Error: Source city with ID " << src << " does not exist!\n";
-            return;
-        }
-        if (cities.find(dest) == cities.end()) {
-            cout << "Error: Destination city with ID " << dest << " does not exist!\n";
-            return;
+    void readFrom(const shared_ptr<Connection>& connection) {
+        char buffer[1 << 16];
+        for (;;) {
+            ssize_t received = read(connection->fd, buffer, sizeof(buffer));
+            if (received > 0) {
+                connection->in.append(buffer, received);
+                continue;
+            }
+            if (received == 0) {
+                connection->peerClosed = true;
+                updateEvents(connection);
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                closeConnection(connection);
+                return;
+            }
+            break;
         }
-        if (src == dest) {
-            cout << "\nSource and destination are the same!\n";
-            cout << "City: " << cities[src].name << " (ID: " << src << ")\n";
-            cout << "Total Distance: 0 units\n";
+        if (connection->in.size() > MAX_BUFFERED && connection->in.find('\n') == string::npos) {
+            closeConnection(connection);
             return;
         }
+        dispatch(connection);
+        closeIfDone(connection);
+    }
 
-        unordered_map<int, int> parents;
-        unordered_map<int, int> distances;
-        MinHeap minHeap;
+    void dispatch(const shared_ptr<Connection>& connection) {
+        if (connection->fd < 0 || connection->busy || connection->out.size() > MAX_BUFFERED) return;
+        size_t lastLine = connection->in.rfind('\n');
+        if (lastLine == string::npos) return;
+
+        Job job;
+        job.connection = connection;
+        job.requests.assign(connection->in, 0, lastLine + 1);
+        connection->in.erase(0, lastLine + 1);
+        connection->busy = true;
+        {
+            lock_guard<mutex> lock(jobLock);
+            pending.push_back(move(job));
+        }
+        jobReady.notify_one();
+    }
 
-        for (auto& city : cities) {
-            distances[city.first] = INT_MAX;
+    void collectFinished() {
+        vector<Job> done;
+        {
+            lock_guard<mutex> lock(doneLock);
+            done.swap(finished);
+        }
+        for (Job& job : done) {
+            shared_ptr<Connection>& connection = job.connection;
+            connection->busy = false;
+            if (connection->fd < 0) continue;
+            connection->out += job.responses;
+            flush(connection);
+            dispatch(connection);
+            closeIfDone(connection);
         }
+    }
 
-        distances[src] = 0;
-        parents[src] = src;
-        minHeap.push(0, src);
-
-        while (!minHeap.empty()) {
-            pair<int, int> current = minHeap.top();
-            int nodeDist = current.first;
-            int node = current.second;
-            minHeap.pop();
-
-            if (nodeDist > distances[node]) continue;
-
-            for (auto& route : adj[node]) {
-                int nbr = route.neighbor;
-                
-                if (route.isBlocked) continue;
-                
-                int effectiveCost = calculateEffectiveCost(route.distance, route.traffic);
-
-                if (distances[node] != INT_MAX && distances[node] + effectiveCost < distances[nbr]) {
-                    distances[nbr] = distances[node] + effectiveCost;
-                    parents[nbr] = node;
-                    minHeap.push(distances[nbr], nbr);
-                }
+    void flush(const shared_ptr<Connection>& connection) {
+        if (connection->fd < 0) return;
+        string& out = connection->out;
+        while (connection->sent < out.size()) {
+            ssize_t written = send(connection->fd, out.data() + connection->sent, out.size() - connection->sent,
+                                   MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                if (errno == EINTR) continue;
+                closeConnection(connection);
+                return;
             }
+            connection->sent += written;
         }
-
-        if (distances[dest] == INT_MAX) {
-            cout << "\nNo path exists between " << cities[src].name 
-                 << " (ID: " << src << ") and " << cities[dest].name 
-                 << " (ID: " << dest << ").\n";
-            cout << "These cities are in different disconnected components or all routes are blocked.\n";
-            return;
+        if (connection->sent == out.size()) {
+            out.clear();
+            connection->sent = 0;
         }
 
-        vector<int> path;
-        int currentNode = dest;
-        
-        while (currentNode != src) {
-            path.push_back(currentNode);
-            currentNode = parents[currentNode];
+        if (connection->writing != !out.empty()) {
+            updateEvents(connection);
         }
-        path.push_back(src);
-
-        cout << "\n=== Shortest Path Result ===\n";
-        cout << "From: " << cities[src].name << " (ID: " << src << ")\n";
-        cout << "To: " << cities[dest].name << " (ID: " << dest << ")\n";
-        cout << "Path: ";
-        for (int i = path.size() - 1; i >= 0; i--) {
-            cout << cities[path[i]].name;
-            if (i > 0) cout << " -> ";
-        }
-        cout << "\nTotal Effective Cost (with traffic): " << distances[dest] << " units\n";
-        cout << "Number of hops: " << path.size() - 1 << endl;
     }
 
-    void loadSampleData() {
-        addCity("karachi");
-        addCity("hyderabad");
-        addCity("sukkur");
-        addCity("islamabad");
-        addCity("lahore");
-        addCity("wazirabad");
-
-        addEdge(1, 2, 150, false);
-        addEdge(1, 5, 220, false);
-        addEdge(2, 3, 120, false);
-        addEdge(3, 4, 200, false);
-        addEdge(4, 6, 210, false);
-        addEdge(4, 5, 80, false);
-        addEdge(6, 5, 180, false);
-        
-        cout << "\nSample data loaded successfully!\n";
+    // Input is watched until the client shuts down its side, output while
+    // responses are waiting to be sent.
+    void updateEvents(const shared_ptr<Connection>& connection) {
+        connection->writing = !connection->out.empty();
+        uint32_t events = (connection->peerClosed ? 0u : uint32_t(EPOLLIN)) | (connection->writing ? uint32_t(EPOLLOUT) : 0u);
+        watch(connection->fd, events, EPOLL_CTL_MOD);
     }
 
-    void clearGraph() {
-        cities.clear();
-        adj.clear();
-        nextCityId = 1;
-        cout << "Graph cleared successfully!\n";
+    // A client that has shut down its side is closed once everything it sent
+    // has been answered.
+    void closeIfDone(const shared_ptr<Connection>& connection) {
+        if (connection->fd >= 0 && connection->peerClosed && !connection->busy && connection->out.empty() &&
+            connection->in.find('\n') == string::npos) {
+            closeConnection(connection);
+        }
+    }
+
+    void closeConnection(const shared_ptr<Connection>& connection) {
+        int fd = connection->fd;
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connection->fd = -1;
+        connection->abandoned.store(true, memory_order_relaxed);
+        connections.erase(fd);
     }
 };
+#endif
 
 void displayMenu() {
     cout << "\n================================================\n";
@@ -448,7 +378,9 @@ void displayMenu() {
     cout << "8.  Set Traffic Level on Route\n";
     cout << "9.  Load Sample Data\n";
     cout << "10. Clear Graph\n";
-    cout << "11. Exit\n";
+    cout << "11. Apply Traffic Feed from File\n";
+    cout << "12. Find City by Name\n";
+    cout << "13. Exit\n";
     cout << "================================================\n";
     cout << "Note: Traffic level 0-7 (normal), 8-10 (auto-blocks)\n";
     cout << "      Cost = Distance + (Distance x Traffic x 10%)\n";
@@ -456,8 +388,131 @@ void displayMenu() {
     cout << "Enter your choice: ";
 }
 
-int main() {
+// --serve ADDRESS [--workers N] [--sample]
+int runServer(int argc, char* argv[]) {
+#ifdef __linux__
+    string address;
+    int workers = max(1u, thread::hardware_concurrency());
+    bool sample = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            address = argv[++i];
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sample") == 0) {
+            sample = true;
+        } else {
+            address.clear();
+            break;
+        }
+    }
+    if (address.empty() || workers < 1) {
+        cout << "Usage: " << argv[0] << " --serve <port|host:port|unix:path> [--workers N] [--sample]\n";
+        return 1;
+    }
+
     Graph g;
+    if (sample) {
+        g.loadSampleData();
+    }
+    RouteServer server(g, workers);
+    if (!server.listenOn(address)) {
+        return 1;
+    }
+    cout << "Serving on " << address << " with " << workers << " workers. Ctrl+C to stop.\n";
+    server.run();
+    return 0;
+#else
+    (void)argc;
+    cout << "Error: " << argv[0] << " --serve is only supported on Linux.\n";
+    return 1;
+#endif
+}
+
+// --batch [FILE|-] [--sample]: runs the commands in FILE (stdin by default)
+// through a CommandProcessor. No menu is printed; the responses, one line per
+// command, go through one buffered writer.
+int runBatch(int argc, char* argv[]) {
+    const char* path = "-";
+    bool sample = false;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--sample") == 0) {
+            sample = true;
+        } else if (i == 2) {
+            path = argv[i];
+        } else {
+            cout << "Usage: " << argv[0] << " --batch [FILE|-] [--sample]\n";
+            return 1;
+        }
+    }
+
+    FILE* input = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (input == nullptr) {
+        cout << "Error: Could not open file " << path << "!\n";
+        return 1;
+    }
+
+    Graph g;
+    if (sample) {
+        g.loadSampleData();
+    }
+    CommandProcessor commands(g);
+
+    const size_t CHUNK = 1 << 20;
+    const size_t FLUSH_AT = 1 << 16;
+    vector<char> buffer(CHUNK);
+    size_t carried = 0;
+    string out;
+    out.reserve(FLUSH_AT * 2);
+
+    for (;;) {
+        size_t read = fread(buffer.data() + carried, 1, buffer.size() - carried, input);
+        size_t filled = carried + read;
+        if (read == 0) {
+            // End of input: a last line without '\n' still counts.
+            commands.execute(buffer.data(), buffer.data() + filled, out);
+            break;
+        }
+
+        // Run the complete lines and carry the partial last one over.
+        size_t complete = filled;
+        while (complete > 0 && buffer[complete - 1] != '\n') {
+            complete--;
+        }
+        if (complete == 0) {
+            carried = filled;
+            if (carried == buffer.size()) {
+                buffer.resize(buffer.size() * 2);
+            }
+            continue;
+        }
+        commands.execute(buffer.data(), buffer.data() + complete, out);
+        if (out.size() >= FLUSH_AT) {
+            fwrite(out.data(), 1, out.size(), stdout);
+            out.clear();
+        }
+        carried = filled - complete;
+        memmove(buffer.data(), buffer.data() + complete, carried);
+    }
+
+    fwrite(out.data(), 1, out.size(), stdout);
+    fflush(stdout);
+    if (input != stdin) {
+        fclose(input);
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        if (strcmp(argv[1], "--batch") == 0) {
+            return runBatch(argc, argv);
+        }
+        return runServer(argc, argv);
+    }
+
+    Graph g;
+    ConsoleView view(g);
     int choice;
 
     do {
@@ -466,7 +521,7 @@ int main() {
         if (!(cin >> choice)) {
             cin.clear();
             cin.ignore(10000, '\n');
-            cout << "Invalid input! Please enter a number between 1 and 11.\n";
+            cout << "Invalid input! Please enter a number between 1 and 13.\n";
             continue;
         }
 
@@ -483,14 +538,16 @@ int main() {
                     name = name.substr(start, end - start + 1);
                 }
                 
-                g.addCity(name);
+                int id = -1;
+                GraphStatus status = g.addCity(name, &id);
+                view.cityAdded(name, status, id);
                 break;
             }
             case 2: {
                 int u, v, w;
                 char dirChoice;
                 
-                if (g.cities.empty()) {
+                if (g.cityCount() == 0) {
                     cout << "Error: No cities available. Please add cities first!\n";
                     break;
                 }
@@ -522,21 +579,21 @@ int main() {
                 cout << "Is it a one-way route? (y/n): ";
                 cin >> dirChoice;
                 bool direction = (dirChoice == 'y' || dirChoice == 'Y');
-                g.addEdge(u, v, w, direction);
+                view.routeAdded(u, v, w, g.addEdge(u, v, w, direction));
                 break;
             }
             case 3: {
-                g.displayCities();
+                view.cities();
                 break;
             }
             case 4: {
-                g.displayGraph();
+                view.structure();
                 break;
             }
             case 5: {
                 int src, dest;
                 
-                if (g.cities.empty()) {
+                if (g.cityCount() == 0) {
                     cout << "Error: No cities available. Please add cities first!\n";
                     break;
                 }
@@ -557,7 +614,7 @@ int main() {
                     break;
                 }
                 
-                g.dijkstra(src, dest);
+                view.path(g.dijkstra(src, dest));
                 break;
             }
             case 6: {
@@ -576,7 +633,7 @@ int main() {
                     cout << "Invalid input!\n";
                     break;
                 }
-                g.blockRoute(u, v);
+                view.routeBlocked(u, v, g.blockRoute(u, v));
                 break;
             }
             case 7: {
@@ -595,7 +652,7 @@ int main() {
                     cout << "Invalid input!\n";
                     break;
                 }
-                g.unblockRoute(u, v);
+                view.routeUnblocked(u, v, g.unblockRoute(u, v));
                 break;
             }
             case 8: {
@@ -621,11 +678,19 @@ int main() {
                     cout << "Invalid input!\n";
                     break;
                 }
-                g.setTraffic(u, v, traffic);
+                view.trafficSet(u, v, traffic, g.setTraffic(u, v, traffic));
                 break;
             }
             case 9: {
-                g.loadSampleData();
+                for (const char* name : Graph::SAMPLE_CITIES) {
+                    int id = -1;
+                    GraphStatus status = g.addCity(name, &id);
+                    view.cityAdded(name, status, id);
+                }
+                for (const int* route : Graph::SAMPLE_ROUTES) {
+                    view.routeAdded(route[0], route[1], route[2], g.addEdge(route[0], route[1], route[2], false));
+                }
+                cout << "\nSample data loaded successfully!\n";
                 break;
             }
             case 10: {
@@ -634,12 +699,48 @@ int main() {
                 cin >> confirm;
                 if (confirm == 'y' || confirm == 'Y') {
                     g.clearGraph();
+                    view.graphCleared();
                 } else {
                     cout << "Clear operation cancelled.\n";
                 }
                 break;
             }
             case 11: {
+                string filename;
+                cout << "Enter traffic feed filename (lines of: source destination level): ";
+                cin >> filename;
+
+                ifstream feed(filename);
+                if (!feed.is_open()) {
+                    cout << "Error: Unable to open file '" << filename << "'!\n";
+                    break;
+                }
+
+                vector<TrafficUpdate> updates;
+                int u, v, level;
+                while (feed >> u >> v >> level) {
+                    updates.push_back(TrafficUpdate(u, v, level));
+                }
+
+                view.trafficFeedApplied(g.applyTrafficBatch(updates));
+                break;
+            }
+            case 12: {
+                string name;
+                cout << "Enter City Name: ";
+                cin.ignore();
+                getline(cin, name);
+
+                size_t start = name.find_first_not_of(" \t\n\r");
+                size_t end = name.find_last_not_of(" \t\n\r");
+                if (start != string::npos && end != string::npos) {
+                    name = name.substr(start, end - start + 1);
+                }
+
+                view.cityFound(name, g.findCityId(name));
+                break;
+            }
+            case 13: {
                 cout << "Exiting program. Goodbye!\n";
                 break;
             }
@@ -647,7 +748,7 @@ int main() {
                 cout << "Invalid choice! Please try again.\n";
             }
         }
-    } while (choice != 11);
+    } while (choice != 13);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -22,30 +22,50 @@ public:
 // ============== HASH TABLE FOR CITIES ==============
 class CityHashTable {
 private:
-    static const int TABLE_SIZE = 100;
+    static const int INITIAL_SIZE = 100;
     CityHashNode** table;
+    int tableSize;
+    int count;
     
     int hashFunction(int key) {
-        return (key % TABLE_SIZE + TABLE_SIZE) % TABLE_SIZE;
+        return (key % tableSize + tableSize) % tableSize;
+    }
+    
+    // Doubles the bucket count once there are more cities than buckets, so
+    // chains stay short when many cities are added.
+    void grow() {
+        int oldSize = tableSize;
+        CityHashNode** oldTable = table;
+        tableSize *= 2;
+        table = new CityHashNode*[tableSize];
+        for (int i = 0; i < tableSize; i++) {
+            table[i] = nullptr;
+        }
+        for (int i = 0; i < oldSize; i++) {
+            CityHashNode* current = oldTable[i];
+            while (current != nullptr) {
+                CityHashNode* next = current->next;
+                int index = hashFunction(current->key);
+                current->next = table[index];
+                table[index] = current;
+                current = next;
+            }
+        }
+        delete[] oldTable;
     }
     
 public:
     CityHashTable() {
-        table = new CityHashNode*[TABLE_SIZE];
-        for (int i = 0; i < TABLE_SIZE; i++) {
+        tableSize = INITIAL_SIZE;
+        count = 0;
+        table = new CityHashNode*[tableSize];
+        for (int i = 0; i < tableSize; i++) {
             table[i] = nullptr;
         }
     }
     
     ~CityHashTable() {
-        for (int i = 0; i < TABLE_SIZE; i++) {
-            CityHashNode* current = table[i];
-            while (current != nullptr) {
-                CityHashNode* temp = current;
-                current = current->next;
-                delete temp;
-            }
-        }
+        clear();
         delete[] table;
     }
     
@@ -64,6 +84,11 @@ public:
         CityHashNode* newNode = new CityHashNode(key, name);
         newNode->next = table[index];
         table[index] = newNode;
+        count++;
+        
+        if (count > tableSize) {
+            grow();
+        }
     }
     
     bool find(int key, string& name) {
@@ -94,7 +119,7 @@ public:
     }
     
     void clear() {
-        for (int i = 0; i < TABLE_SIZE; i++) {
+        for (int i = 0; i < tableSize; i++) {
             CityHashNode* current = table[i];
             while (current != nullptr) {
                 CityHashNode* temp = current;
@@ -103,6 +128,122 @@ public:
             }
             table[i] = nullptr;
         }
+        count = 0;
+    }
+};
+
+// ============== HASH NODE FOR CITY NAMES ==============
+class NameHashNode {
+public:
+    string name;
+    int id;
+    NameHashNode* next;
+    
+    NameHashNode(const string& n, int i) : name(n), id(i), next(nullptr) {}
+};
+
+// ============== HASH TABLE FOR CITY NAMES ==============
+// Name -> city ID, so addCity can reject duplicates without scanning every
+// city. Grows like CityHashTable.
+class NameHashTable {
+private:
+    static const int INITIAL_SIZE = 128;
+    NameHashNode** table;
+    int tableSize;
+    int count;
+    
+    // FNV-1a
+    int hashFunction(const string& name, int size) {
+        unsigned int h = 2166136261u;
+        for (int i = 0; i < (int)name.size(); i++) {
+            h ^= (unsigned char)name[i];
+            h *= 16777619u;
+        }
+        return (int)(h % (unsigned int)size);
+    }
+    
+    void grow() {
+        int newSize = tableSize * 2;
+        NameHashNode** newTable = new NameHashNode*[newSize];
+        for (int i = 0; i < newSize; i++) {
+            newTable[i] = nullptr;
+        }
+        for (int i = 0; i < tableSize; i++) {
+            NameHashNode* current = table[i];
+            while (current != nullptr) {
+                NameHashNode* next = current->next;
+                int index = hashFunction(current->name, newSize);
+                current->next = newTable[index];
+                newTable[index] = current;
+                current = next;
+            }
+        }
+        delete[] table;
+        table = newTable;
+        tableSize = newSize;
+    }
+    
+public:
+    NameHashTable() {
+        tableSize = INITIAL_SIZE;
+        count = 0;
+        table = new NameHashNode*[tableSize];
+        for (int i = 0; i < tableSize; i++) {
+            table[i] = nullptr;
+        }
+    }
+    
+    ~NameHashTable() {
+        clear();
+        delete[] table;
+    }
+    
+    void insert(const string& name, int id) {
+        int index = hashFunction(name, tableSize);
+        NameHashNode* current = table[index];
+        
+        while (current != nullptr) {
+            if (current->name == name) {
+                current->id = id;
+                return;
+            }
+            current = current->next;
+        }
+        
+        NameHashNode* newNode = new NameHashNode(name, id);
+        newNode->next = table[index];
+        table[index] = newNode;
+        count++;
+        
+        if (count > tableSize) {
+            grow();
+        }
+    }
+    
+    bool find(const string& name, int& id) {
+        NameHashNode* current = table[hashFunction(name, tableSize)];
+        
+        while (current != nullptr) {
+            if (current->name == name) {
+                id = current->id;
+                return true;
+            }
+            current = current->next;
+        }
+        return false;
+    }
+    
+    void clear() {
+        for (int i = 0; i < tableSize; i++) {
+            NameHashNode* current = table[i];
+            while (current != nullptr) {
+                NameHashNode* temp = current;
+                current = current->next;
+                delete temp;
+            }
+            table[i] = nullptr;
+        }
+        count = 0;
     }
 };
 
@@ -211,6 +352,122 @@ public:
     }
 };
 
+// ============== HASH NODE FOR EDGE SLOTS ==============
+class EdgeHashNode {
+public:
+    long long key;
+    int slot;
+    EdgeHashNode* next;
+    
+    EdgeHashNode(long long k, int s) : key(k), slot(s), next(nullptr) {}
+};
+
+// ============== HASH TABLE FOR EDGE SLOTS ==============
+// Maps (u, v) packed into one 64-bit key to the index of route u -> v in
+// u's RouteList. Unlike the fixed-size tables above it doubles its bucket
+// count when it gets full, so lookups stay O(1) for hub cities too.
+class EdgeHashTable {
+private:
+    EdgeHashNode** table;
+    int tableSize;
+    int count;
+    
+    int hashFunction(long long key, int size) {
+        unsigned long long h = (unsigned long long)key * 0x9E3779B97F4A7C15ULL;
+        return (int)(h >> 32) & (size - 1);
+    }
+    
+    void grow() {
+        int newSize = tableSize * 2;
+        EdgeHashNode** newTable = new EdgeHashNode*[newSize];
+        for (int i = 0; i < newSize; i++) {
+            newTable[i] = nullptr;
+        }
+        for (int i = 0; i < tableSize; i++) {
+            EdgeHashNode* current = table[i];
+            while (current != nullptr) {
+                EdgeHashNode* next = current->next;
+                int index = hashFunction(current->key, newSize);
+                current->next = newTable[index];
+                newTable[index] = current;
+                current = next;
+            }
+        }
+        delete[] table;
+        table = newTable;
+        tableSize = newSize;
+    }
+    
+public:
+    EdgeHashTable() {
+        tableSize = 128;
+        count = 0;
+        table = new EdgeHashNode*[tableSize];
+        for (int i = 0; i < tableSize; i++) {
+            table[i] = nullptr;
+        }
+    }
+    
+    ~EdgeHashTable() {
+        clear();
+        delete[] table;
+    }
+    
+    static long long makeKey(int u, int v) {
+        return (long long)(((unsigned long long)(unsigned int)u << 32) | (unsigned int)v);
+    }
+    
+    void insert(int u, int v, int slot) {
+        long long key = makeKey(u, v);
+        int index = hashFunction(key, tableSize);
+        EdgeHashNode* current = table[index];
+        
+        while (current != nullptr) {
+            if (current->key == key) {
+                current->slot = slot;
+                return;
+            }
+            current = current->next;
+        }
+        
+        EdgeHashNode* newNode = new EdgeHashNode(key, slot);
+        newNode->next = table[index];
+        table[index] = newNode;
+        count++;
+        
+        if (count > tableSize) {
+            grow();
+        }
+    }
+    
+    bool find(int u, int v, int& slot) {
+        long long key = makeKey(u, v);
+        EdgeHashNode* current = table[hashFunction(key, tableSize)];
+        
+        while (current != nullptr) {
+            if (current->key == key) {
+                slot = current->slot;
+                return true;
+            }
+            current = current->next;
+        }
+        return false;
+    }
+    
+    void clear() {
+        for (int i = 0; i < tableSize; i++) {
+            EdgeHashNode* current = table[i];
+            while (current != nullptr) {
+                EdgeHashNode* temp = current;
+                current = current->next;
+                delete temp;
+            }
+            table[i] = nullptr;
+        }
+        count = 0;
+    }
+};
+
 // ============== ARRAY LIST FOR INTEGERS ==============
 class IntArrayList {
 private:
@@ -257,56 +514,108 @@ public:
     bool empty() {
         return length == 0;
     }
+    
+    void clear() {
+        length = 0;
+    }
 };
 
 // ============== ROUTE CLASS ==============
+int calculateEffectiveCost(int distance, int traffic) {
+    return distance + (distance * traffic / 10);
+}
+
+// Packed edge: neighbor + cached effective cost are what dijkstra reads,
+// distance/traffic/blocked live together in one word (24/4/1 bits).
 class Route {
 public:
+    static const unsigned int MAX_DISTANCE = (1u << 24) - 1;
+    static const unsigned int BLOCKED_COST = 0xFFFFFFFFu;
+    
     int neighbor;
-    int distance;
-    int traffic;
-    bool isBlocked;
-    Route* next;
+    unsigned int cost;
+    
+    Route() : neighbor(0), cost(0), attrs(0) {}
+    Route(int n, int d) : neighbor(n), cost(0), attrs(0) { setDistance(d); }
+    
+    int distance() { return attrs & MAX_DISTANCE; }
+    int traffic() { return (attrs >> TRAFFIC_SHIFT) & TRAFFIC_MASK; }
+    bool isBlocked() { return (attrs & BLOCKED_BIT) != 0; }
+    
+    void setDistance(int d) {
+        attrs = (attrs & ~MAX_DISTANCE) | ((unsigned int)d & MAX_DISTANCE);
+        refreshCost();
+    }
+    
+    void setTraffic(int t) {
+        attrs = (attrs & ~(TRAFFIC_MASK << TRAFFIC_SHIFT)) | (((unsigned int)t & TRAFFIC_MASK) << TRAFFIC_SHIFT);
+        refreshCost();
+    }
     
-    Route(int n, int d) : neighbor(n), distance(d), traffic(0), 
-                          isBlocked(false), next(nullptr) {}
+    void setBlocked(bool blocked) {
+        attrs = blocked ? (attrs | BLOCKED_BIT) : (attrs & ~BLOCKED_BIT);
+        refreshCost();
+    }
+    
+private:
+    static const unsigned int TRAFFIC_SHIFT = 24;
+    static const unsigned int TRAFFIC_MASK = 0xF;
+    static const unsigned int BLOCKED_BIT = 1u << 28;
+    
+    unsigned int attrs;
+    
+    void refreshCost() {
+        cost = isBlocked() ? BLOCKED_COST : calculateEffectiveCost(distance(), traffic());
+    }
 };
 
-// ============== LINKED LIST FOR ROUTES ==============
+// ============== ARRAY LIST FOR ROUTES ==============
+// Routes are stored by value in one growable array, so there is no per-edge
+// allocation or next pointer and push_back doesn't walk the list.
 class RouteList {
 private:
-    Route* head;
+    Route* arr;
+    int capacity;
+    int length;
+    
+    void resize() {
+        capacity *= 2;
+        Route* newArr = new Route[capacity];
+        for (int i = 0; i < length; i++) {
+            newArr[i] = arr[i];
+        }
+        delete[] arr;
+        arr = newArr;
+    }
     
 public:
-    RouteList() : head(nullptr) {}
+    RouteList() {
+        capacity = 4;
+        length = 0;
+        arr = new Route[capacity];
+    }
     
     ~RouteList() {
-        Route* current = head;
-        while (current != nullptr) {
-            Route* temp = current;
-            current = current->next;
-            delete temp;
-        }
+        delete[] arr;
     }
     
-    void push_back(Route* route) {
-        if (head == nullptr) {
-            head = route;
-        } else {
-            Route* current = head;
-            while (current->next != nullptr) {
-                current = current->next;
-            }
-            current->next = route;
+    void push_back(const Route& route) {
+        if (length >= capacity) {
+            resize();
         }
+        arr[length++] = route;
+    }
+    
+    Route& get(int index) {
+        return arr[index];
     }
     
-    Route* getHead() {
-        return head;
+    int size() {
+        return length;
     }
     
     bool empty() {
-        return head == nullptr;
+        return length == 0;
     }
 };
 
@@ -323,31 +632,48 @@ public:
 // ============== HASH TABLE FOR ADJACENCY LIST ==============
 class AdjacencyHashTable {
 private:
-    static const int TABLE_SIZE = 100;
+    static const int INITIAL_SIZE = 100;
     RouteListHashNode** table;
+    int tableSize;
+    int count;
     
     int hashFunction(int key) {
-        return (key % TABLE_SIZE + TABLE_SIZE) % TABLE_SIZE;
+        return (key % tableSize + tableSize) % tableSize;
+    }
+    
+    void grow() {
+        int oldSize = tableSize;
+        RouteListHashNode** oldTable = table;
+        tableSize *= 2;
+        table = new RouteListHashNode*[tableSize];
+        for (int i = 0; i < tableSize; i++) {
+            table[i] = nullptr;
+        }
+        for (int i = 0; i < oldSize; i++) {
+            RouteListHashNode* current = oldTable[i];
+            while (current != nullptr) {
+                RouteListHashNode* next = current->next;
+                int index = hashFunction(current->key);
+                current->next = table[index];
+                table[index] = current;
+                current = next;
+            }
+        }
+        delete[] oldTable;
     }
     
 public:
     AdjacencyHashTable() {
-        table = new RouteListHashNode*[TABLE_SIZE];
-        for (int i = 0; i < TABLE_SIZE; i++) {
+        tableSize = INITIAL_SIZE;
+        count = 0;
+        table = new RouteListHashNode*[tableSize];
+        for (int i = 0; i < tableSize; i++) {
             table[i] = nullptr;
         }
     }
     
     ~AdjacencyHashTable() {
-        for (int i = 0; i < TABLE_SIZE; i++) {
-            RouteListHashNode* current = table[i];
-            while (current != nullptr) {
-                RouteListHashNode* temp = current;
-                current = current->next;
-                delete temp->value;
-                delete temp;
-            }
-        }
+        clear();
         delete[] table;
     }
     
@@ -367,6 +693,11 @@ public:
         RouteListHashNode* newNode = new RouteListHashNode(key, value);
         newNode->next = table[index];
         table[index] = newNode;
+        count++;
+        
+        if (count > tableSize) {
+            grow();
+        }
     }
     
     bool find(int key, RouteList*& value) {
@@ -384,7 +715,7 @@ public:
     }
     
     void clear() {
-        for (int i = 0; i < TABLE_SIZE; i++) {
+        for (int i = 0; i < tableSize; i++) {
             RouteListHashNode* current = table[i];
             while (current != nullptr) {
                 RouteListHashNode* temp = current;
@@ -394,6 +725,7 @@ public:
             }
             table[i] = nullptr;
         }
+        count = 0;
     }
 };
 
@@ -518,19 +850,168 @@ public:
     }
 };
 
+// ============== UNION-FIND FOR COMPONENTS ==============
+// Cities joined by open routes, ignoring direction. Cities in different
+// components have no path between them, so dijkstra can say so without a
+// search. Adding or opening a route joins two components; blocking one may
+// split a component, which union-find cannot undo, so it only marks the
+// index stale and the next query rebuilds it.
+class ComponentIndex {
+private:
+    int* parent;
+    int* size;
+    int capacity;
+    
+    // Makes room for IDs up to id; new IDs are components of their own.
+    void reserve(int id) {
+        if (id < capacity) {
+            return;
+        }
+        int newCapacity = capacity;
+        while (newCapacity <= id) {
+            newCapacity *= 2;
+        }
+        int* newParent = new int[newCapacity];
+        int* newSize = new int[newCapacity];
+        for (int i = 0; i < newCapacity; i++) {
+            newParent[i] = i < capacity ? parent[i] : i;
+            newSize[i] = i < capacity ? size[i] : 1;
+        }
+        delete[] parent;
+        delete[] size;
+        parent = newParent;
+        size = newSize;
+        capacity = newCapacity;
+    }
+    
+public:
+    bool stale;
+    
+    ComponentIndex() {
+        capacity = 16;
+        parent = new int[capacity];
+        size = new int[capacity];
+        stale = false;
+        clear();
+    }
+    
+    ~ComponentIndex() {
+        delete[] parent;
+        delete[] size;
+    }
+    
+    // Root of id's component, halving the path on the way.
+    int find(int id) {
+        reserve(id);
+        while (parent[id] != id) {
+            parent[id] = parent[parent[id]];
+            id = parent[id];
+        }
+        return id;
+    }
+    
+    void unite(int a, int b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) {
+            return;
+        }
+        if (size[a] < size[b]) {
+            int temp = a;
+            a = b;
+            b = temp;
+        }
+        parent[b] = a;
+        size[a] += size[b];
+    }
+    
+    void clear() {
+        for (int i = 0; i < capacity; i++) {
+            parent[i] = i;
+            size[i] = 1;
+        }
+        stale = false;
+    }
+};
+
 // ============== GRAPH CLASS ==============
 class Graph {
 private:
-    static const int MAX_CITIES = 100;
     CityHashTable cities;
+    NameHashTable cityNames;
     AdjacencyHashTable adj;
+    EdgeHashTable edgeSlots;
     int nextCityId;
-    int cityIds[MAX_CITIES];
+    IntArrayList cityIds;
     int cityCount;
+    ComponentIndex components;
+    
+    // Route u -> v via the edge index, or nullptr if there is none.
+    Route* findRoute(int u, int v) {
+        int slot;
+        if (!edgeSlots.find(u, v, slot)) {
+            return nullptr;
+        }
+        RouteList* routes = nullptr;
+        adj.find(u, routes);
+        return &routes->get(slot);
+    }
+    
+    void registerCity(int id, const string& name) {
+        cities.insert(id, name);
+        cityNames.insert(name, id);
+        cityIds.push_back(id);
+        cityCount++;
+        adj.insert(id, new RouteList());
+    }
+    
+    void appendRoute(int u, const Route& route) {
+        RouteList* routes = nullptr;
+        adj.find(u, routes);
+        edgeSlots.insert(u, route.neighbor, routes->size());
+        routes->push_back(route);
+        if (routes->get(routes->size() - 1).isBlocked()) {
+            components.stale = true;
+        } else {
+            components.unite(u, route.neighbor);
+        }
+    }
+    
+    void printNoPath(const string& cityS, int src, const string& cityD, int dest) {
+        cout << "\nNo path exists between " << cityS 
+             << " (ID: " << src << ") and " << cityD 
+             << " (ID: " << dest << ").\n";
+        cout << "These cities are in different disconnected components or all routes are blocked.\n";
+    }
+    
+    // Recomputes the components from the open routes after blocking.
+    void rebuildComponents() {
+        components.clear();
+        for (int i = 0; i < cityCount; i++) {
+            int id = cityIds.get(i);
+            RouteList* routes = nullptr;
+            adj.find(id, routes);
+            for (int j = 0; j < routes->size(); j++) {
+                Route* current = &routes->get(j);
+                if (!current->isBlocked()) {
+                    components.unite(id, current->neighbor);
+                }
+            }
+        }
+    }
     
 public:
     Graph() : nextCityId(1), cityCount(0) {}
     
+    // ID of the city with this exact name, or -1.
+    int findCityId(const string& name) {
+        int id;
+        if (!cityNames.find(name, id)) {
+            return -1;
+        }
+        return id;
+    }
+    
     int addCity(const string& name) {
         if (name.empty()) {
             cout << "Error: City name cannot be empty!\n";
@@ -538,19 +1019,14 @@ public:
         }
         
         // Check for duplicate
-        for (int i = 0; i < cityCount; i++) {
-            string cityName;
-            cities.find(cityIds[i], cityName);
-            if (cityName == name) {
-                cout << "Error: City '" << name << "' already exists with ID: " << cityIds[i] << endl;
-                return -1;
-            }
+        int existing = findCityId(name);
+        if (existing != -1) {
+            cout << "Error: City '" << name << "' already exists with ID: " << existing << endl;
+            return -1;
         }
         
         int id = nextCityId++;
-        cities.insert(id, name);
-        cityIds[cityCount++] = id;
-        adj.insert(id, new RouteList());
+        registerCity(id, name);
         
         cout << "City '" << name << "' added with ID: " << id << endl;
         return id;
@@ -574,40 +1050,35 @@ public:
             cout << "Error: Distance must be positive!\n";
             return;
         }
-        
-        RouteList* routes;
-        adj.find(u, routes);
+        if (w > (int)Route::MAX_DISTANCE) {
+            cout << "Error: Distance cannot exceed " << Route::MAX_DISTANCE << "!\n";
+            return;
+        }
         
         // Check for duplicate
-        Route* current = routes->getHead();
-        while (current != nullptr) {
-            if (current->neighbor == v) {
-                cout << "Warning: Route already exists between " << cityU 
-                     << " and " << cityV << ". Updating distance to " << w << endl;
-                current->distance = w;
-                
-                if (!direction) {
-                    RouteList* reverseRoutes;
-                    adj.find(v, reverseRoutes);
-                    Route* revCurrent = reverseRoutes->getHead();
-                    while (revCurrent != nullptr) {
-                        if (revCurrent->neighbor == u) {
-                            revCurrent->distance = w;
-                            break;
-                        }
-                        revCurrent = revCurrent->next;
-                    }
+        Route* current = findRoute(u, v);
+        if (current != nullptr) {
+            cout << "Warning: Route already exists between " << cityU 
+                 << " and " << cityV << ". Updating distance to " << w << endl;
+            current->setDistance(w);
+            
+            if (!direction) {
+                Route* revCurrent = findRoute(v, u);
+                if (revCurrent != nullptr) {
+                    revCurrent->setDistance(w);
                 }
-                return;
             }
-            current = current->next;
+            return;
         }
         
-        routes->push_back(new Route(v, w));
+        appendRoute(u, Route(v, w));
         if (!direction) {
-            RouteList* reverseRoutes;
-            adj.find(v, reverseRoutes);
-            reverseRoutes->push_back(new Route(u, w));
+            Route* revCurrent = findRoute(v, u);
+            if (revCurrent != nullptr) {
+                revCurrent->setDistance(w);
+            } else {
+                appendRoute(v, Route(u, w));
+            }
         }
         
         cout << "Route added between " << cityU << " and " << cityV 
@@ -621,29 +1092,20 @@ public:
             return;
         }
         
-        RouteList* routes;
-        adj.find(u, routes);
-        Route* current = routes->getHead();
-        bool found = false;
-        
-        while (current != nullptr) {
-            if (current->neighbor == v) {
-                if (current->isBlocked) {
-                    cout << "Route from " << cityU << " to " << cityV 
-                         << " is already blocked!\n";
-                } else {
-                    current->isBlocked = true;
-                    cout << "Route from " << cityU << " to " << cityV 
-                         << " has been blocked!\n";
-                }
-                found = true;
-                break;
-            }
-            current = current->next;
+        Route* current = findRoute(u, v);
+        if (current == nullptr) {
+            cout << "Error: No route exists from " << cityU << " to " << cityV << "!\n";
+            return;
         }
         
-        if (!found) {
-            cout << "Error: No route exists from " << cityU << " to " << cityV << "!\n";
+        if (current->isBlocked()) {
+            cout << "Route from " << cityU << " to " << cityV 
+                 << " is already blocked!\n";
+        } else {
+            current->setBlocked(true);
+            components.stale = true;
+            cout << "Route from " << cityU << " to " << cityV 
+                 << " has been blocked!\n";
         }
     }
     
@@ -654,29 +1116,20 @@ public:
             return;
         }
         
-        RouteList* routes;
-        adj.find(u, routes);
-        Route* current = routes->getHead();
-        bool found = false;
-        
-        while (current != nullptr) {
-            if (current->neighbor == v) {
-                if (!current->isBlocked) {
-                    cout << "Route from " << cityU << " to " << cityV 
-                         << " is already open!\n";
-                } else {
-                    current->isBlocked = false;
-                    cout << "Route from " << cityU << " to " << cityV 
-                         << " has been unblocked!\n";
-                }
-                found = true;
-                break;
-            }
-            current = current->next;
+        Route* current = findRoute(u, v);
+        if (current == nullptr) {
+            cout << "Error: No route exists from " << cityU << " to " << cityV << "!\n";
+            return;
         }
         
-        if (!found) {
-            cout << "Error: No route exists from " << cityU << " to " << cityV << "!\n";
+        if (!current->isBlocked()) {
+            cout << "Route from " << cityU << " to " << cityV 
+                 << " is already open!\n";
+        } else {
+            current->setBlocked(false);
+            components.unite(u, v);
+            cout << "Route from " << cityU << " to " << cityV 
+                 << " has been unblocked!\n";
         }
     }
     
@@ -692,36 +1145,27 @@ public:
             return;
         }
         
-        RouteList* routes;
-        adj.find(u, routes);
-        Route* current = routes->getHead();
-        bool found = false;
-        
-        while (current != nullptr) {
-            if (current->neighbor == v) {
-                current->traffic = trafficLevel;
-                
-                if (trafficLevel >= 8 && !current->isBlocked) {
-                    current->isBlocked = true;
-                    cout << "Traffic set to " << trafficLevel << " on route from " 
-                         << cityU << " to " << cityV 
-                         << ". Route AUTO-BLOCKED due to high traffic!\n";
-                } else if (trafficLevel < 8 && current->isBlocked) {
-                    cout << "Traffic set to " << trafficLevel << " on route from " 
-                         << cityU << " to " << cityV 
-                         << ". Route is still BLOCKED (use unblock to open).\n";
-                } else {
-                    cout << "Traffic set to " << trafficLevel << " on route from " 
-                         << cityU << " to " << cityV << endl;
-                }
-                found = true;
-                break;
-            }
-            current = current->next;
+        Route* current = findRoute(u, v);
+        if (current == nullptr) {
+            cout << "Error: No route exists from " << cityU << " to " << cityV << "!\n";
+            return;
         }
         
-        if (!found) {
-            cout << "Error: No route exists from " << cityU << " to " << cityV << "!\n";
+        current->setTraffic(trafficLevel);
+        
+        if (trafficLevel >= 8 && !current->isBlocked()) {
+            current->setBlocked(true);
+            components.stale = true;
+            cout << "Traffic set to " << trafficLevel << " on route from " 
+                 << cityU << " to " << cityV 
+                 << ". Route AUTO-BLOCKED due to high traffic!\n";
+        } else if (trafficLevel < 8 && current->isBlocked()) {
+            cout << "Traffic set to " << trafficLevel << " on route from " 
+                 << cityU << " to " << cityV 
+                 << ". Route is still BLOCKED (use unblock to open).\n";
+        } else {
+            cout << "Traffic set to " << trafficLevel << " on route from " 
+                 << cityU << " to " << cityV << endl;
         }
     }
     
@@ -733,8 +1177,8 @@ public:
         cout << "\n=== Cities in Graph ===\n";
         for (int i = 0; i < cityCount; i++) {
             string cityName;
-            cities.find(cityIds[i], cityName);
-            cout << "ID: " << cityIds[i] << " - Name: " << cityName << endl;
+            cities.find(cityIds.get(i), cityName);
+            cout << "ID: " << cityIds.get(i) << " - Name: " << cityName << endl;
         }
     }
     
@@ -746,57 +1190,40 @@ public:
         cout << "\n=== Graph Structure ===\n";
         for (int i = 0; i < cityCount; i++) {
             string cityName;
-            cities.find(cityIds[i], cityName);
-            cout << cityName << " (ID: " << cityIds[i] << ") -> ";
+            cities.find(cityIds.get(i), cityName);
+            cout << cityName << " (ID: " << cityIds.get(i) << ") -> ";
             
-            RouteList* routes;
-            adj.find(cityIds[i], routes);
-            Route* current = routes->getHead();
+            RouteList* routes = nullptr;
+            adj.find(cityIds.get(i), routes);
             
-            if (current == nullptr) {
+            if (routes->empty()) {
                 cout << "No connections";
             } else {
-                while (current != nullptr) {
+                for (int j = 0; j < routes->size(); j++) {
+                    Route* current = &routes->get(j);
                     string neighborName;
                     cities.find(current->neighbor, neighborName);
-                    cout << neighborName << "(Dist:" << current->distance 
-                         << ", Traffic:" << current->traffic;
-                    if (current->isBlocked) {
+                    cout << neighborName << "(Dist:" << current->distance() 
+                         << ", Traffic:" << current->traffic();
+                    if (current->isBlocked()) {
                         cout << ", BLOCKED";
                     }
                     cout << ") ";
-                    current = current->next;
                 }
             }
             cout << endl;
         }
     }
     
-    int calculateEffectiveCost(int distance, int traffic) {
-        return distance + (distance * traffic / 10);
-    }
-    
-    void dijkstra(int src, int dest) {
-        if (cityCount == 0) {
-            cout << "Error: No cities in the graph!\n";
-            return;
+    // Cheapest cost from src to dest, with the path from dest back to src in
+    // path, or INT_MAX if there is none. Both cities must exist and differ.
+    int shortestPath(int src, int dest, IntArrayList& path) {
+        // Different components: no search needed to know there is no path.
+        if (components.stale) {
+            rebuildComponents();
         }
-        
-        string cityS, cityD;
-        if (!cities.find(src, cityS)) {
-            cout << "Error: Source city with ID " << src << " does not exist!\n";
-            return;
-        }
-        if (!cities.find(dest, cityD)) {
-            cout << "Error: Destination city with ID " << dest << " does not exist!\n";
-            return;
-        }
-        
-        if (src == dest) {
-            cout << "\nSource and destination are the same!\n";
-            cout << "City: " << cityS << " (ID: " << src << ")\n";
-            cout << "Total Distance: 0 units\n";
-            return;
+        if (components.find(src) != components.find(dest)) {
+            return INT_MAX;
         }
         
         IntHashTable parents;
@@ -804,7 +1231,7 @@ public:
         MinHeap minHeap;
         
         for (int i = 0; i < cityCount; i++) {
-            distances.insert(cityIds[i], INT_MAX);
+            distances.insert(cityIds.get(i), INT_MAX);
         }
         
         distances.insert(src, 0);
@@ -816,52 +1243,76 @@ public:
             int node = minHeap.getTopNode();
             minHeap.pop();
             
-            int storedDist;
+            int storedDist = INT_MAX;
             distances.find(node, storedDist);
             if (nodeDist > storedDist) continue;
             
-            RouteList* routes;
+            RouteList* routes = nullptr;
             adj.find(node, routes);
-            Route* route = routes->getHead();
             
-            while (route != nullptr) {
+            for (int i = 0; i < routes->size(); i++) {
+                Route* route = &routes->get(i);
                 int nbr = route->neighbor;
                 
-                if (!route->isBlocked) {
-                    int effectiveCost = calculateEffectiveCost(route->distance, route->traffic);
-                    int currentDist;
-                    distances.find(node, currentDist);
-                    int nbrDist;
-                    distances.find(nbr, nbrDist);
-                    
-                    if (currentDist != INT_MAX && currentDist + effectiveCost < nbrDist) {
-                        distances.insert(nbr, currentDist + effectiveCost);
-                        parents.insert(nbr, node);
-                        minHeap.push(currentDist + effectiveCost, nbr);
-                    }
+                // Blocked routes cost BLOCKED_COST, so the sum can never win.
+                long long candidate = (long long)storedDist + route->cost;
+                int nbrDist = INT_MAX;
+                distances.find(nbr, nbrDist);
+                
+                if (candidate < nbrDist) {
+                    distances.insert(nbr, (int)candidate);
+                    parents.insert(nbr, node);
+                    minHeap.push((int)candidate, nbr);
                 }
-                route = route->next;
             }
         }
         
-        int finalDist;
+        int finalDist = INT_MAX;
         distances.find(dest, finalDist);
         
         if (finalDist == INT_MAX) {
-            cout << "\nNo path exists between " << cityS 
-                 << " (ID: " << src << ") and " << cityD 
-                 << " (ID: " << dest << ").\n";
-            cout << "These cities are in different disconnected components or all routes are blocked.\n";
-            return;
+            return INT_MAX;
         }
         
-        IntArrayList path;
         int currentNode = dest;
         while (currentNode != src) {
             path.push_back(currentNode);
             parents.find(currentNode, currentNode);
         }
         path.push_back(src);
+        return finalDist;
+    }
+    
+    void dijkstra(int src, int dest) {
+        if (cityCount == 0) {
+            cout << "Error: No cities in the graph!\n";
+            return;
+        }
+        
+        string cityS, cityD;
+        if (!cities.find(src, cityS)) {
+            cout << "Error: Source city with ID " << src << " does not exist!\n";
+            return;
+        }
+        if (!cities.find(dest, cityD)) {
+            cout << "Error: Destination city with ID " << dest << " does not exist!\n";
+            return;
+        }
+        
+        if (src == dest) {
+            cout << "\nSource and destination are the same!\n";
+            cout << "City: " << cityS << " (ID: " << src << ")\n";
+            cout << "Total Distance: 0 units\n";
+            return;
+        }
+        
+        IntArrayList path;
+        int finalDist = shortestPath(src, dest, path);
+        
+        if (finalDist == INT_MAX) {
+            printNoPath(cityS, src, cityD, dest);
+            return;
+        }
         
         cout << "\n=== Shortest Path Result ===\n";
         cout << "From: " << cityS << " (ID: " << src << ")\n";
@@ -911,31 +1362,26 @@ public:
         outFile << "CITIES " << cityCount << endl;
         for (int i = 0; i < cityCount; i++) {
             string cityName;
-            cities.find(cityIds[i], cityName);
-            outFile << cityIds[i] << " " << cityName << endl;
+            cities.find(cityIds.get(i), cityName);
+            outFile << cityIds.get(i) << " " << cityName << endl;
         }
         
         int edgeCount = 0;
         for (int i = 0; i < cityCount; i++) {
-            RouteList* routes;
-            adj.find(cityIds[i], routes);
-            Route* current = routes->getHead();
-            while (current != nullptr) {
-                edgeCount++;
-                current = current->next;
-            }
+            RouteList* routes = nullptr;
+            adj.find(cityIds.get(i), routes);
+            edgeCount += routes->size();
         }
         
         outFile << "EDGES " << edgeCount << endl;
         for (int i = 0; i < cityCount; i++) {
-            RouteList* routes;
-            adj.find(cityIds[i], routes);
-            Route* current = routes->getHead();
-            while (current != nullptr) {
-                outFile << cityIds[i] << " " << current->neighbor << " " 
-                       << current->distance << " " << current->traffic << " " 
-                       << current->isBlocked << endl;
-                current = current->next;
+            RouteList* routes = nullptr;
+            adj.find(cityIds.get(i), routes);
+            for (int j = 0; j < routes->size(); j++) {
+                Route* current = &routes->get(j);
+                outFile << cityIds.get(i) << " " << current->neighbor << " " 
+                       << current->distance() << " " << current->traffic() << " " 
+                       << current->isBlocked() << endl;
             }
         }
         
@@ -976,36 +1422,57 @@ public:
                 name = name.substr(1);
             }
             
-            cities.insert(id, name);
-            cityIds[cityCount++] = id;
-            adj.insert(id, new RouteList());
+            registerCity(id, name);
         }
         
         inFile >> keyword >> count;
         inFile.ignore();
         
+        // Routes are checked as addEdge and setTraffic check typed input: a
+        // distance or level too large for its bits would be stored masked.
+        int skipped = 0;
         for (int i = 0; i < count; i++) {
             int u, v, distance, traffic;
             bool isBlocked;
             inFile >> u >> v >> distance >> traffic >> isBlocked;
             inFile.ignore();
             
-            RouteList* routes;
-            adj.find(u, routes);
-            Route* route = new Route(v, distance);
-            route->traffic = traffic;
-            route->isBlocked = isBlocked;
-            routes->push_back(route);
+            string cityU, cityV;
+            if (!cities.find(u, cityU) || !cities.find(v, cityV) || u == v) {
+                cout << "Error: Skipping route " << u << " -> " << v << ": no such cities!\n";
+                skipped++;
+                continue;
+            }
+            if (distance <= 0 || distance > (int)Route::MAX_DISTANCE) {
+                cout << "Error: Skipping route " << u << " -> " << v << ": distance must be between 1 and "
+                     << Route::MAX_DISTANCE << "!\n";
+                skipped++;
+                continue;
+            }
+            if (traffic < 0 || traffic > 10) {
+                cout << "Error: Skipping route " << u << " -> " << v << ": traffic level must be between 0 and 10!\n";
+                skipped++;
+                continue;
+            }
+            
+            Route route(v, distance);
+            route.setTraffic(traffic);
+            route.setBlocked(isBlocked);
+            appendRoute(u, route);
         }
         
         inFile.close();
         cout << "Graph data loaded successfully from '" << filename << "'!\n";
-        cout << "Loaded " << cityCount << " cities and " << count << " routes.\n";
+        cout << "Loaded " << cityCount << " cities and " << count - skipped << " routes.\n";
     }
     
     void clearGraph() {
         cities.clear();
+        cityNames.clear();
+        cityIds.clear();
         adj.clear();
+        edgeSlots.clear();
+        components.clear();
         cityCount = 0;
         nextCityId = 1;
         cout << "Graph cleared successfully!\n";
@@ -1029,7 +1496,8 @@ void displayMenu() {
     cout << "10. Save Graph to File\n";
     cout << "11. Load Graph from File\n";
     cout << "12. Clear Graph\n";
-    cout << "13. Exit\n";
+    cout << "13. Find City by Name\n";
+    cout << "14. Exit\n";
     cout << "================================================\n";
     cout << "Note: Traffic level 0-7 (normal), 8-10 (auto-blocks)\n";
     cout << "      Cost = Distance + (Distance x Traffic x 10%)\n";
@@ -1037,6 +1505,7 @@ void displayMenu() {
     cout << "Enter your choice: ";
 }
 
+#ifndef SPF_NO_MAIN
 int main() {
     Graph g;
     int choice;
@@ -1047,7 +1516,7 @@ int main() {
         if (!(cin >> choice)) {
             cin.clear();
             cin.ignore(10000, '\n');
-            cout << "Invalid input! Please enter a number between 1 and 13.\n";
+            cout << "Invalid input! Please enter a number between 1 and 14.\n";
             continue;
         }
         
@@ -1231,13 +1700,34 @@ int main() {
                 }
                 break;
             }
-            case 13:
+            case 13: {
+                string name;
+                cout << "Enter City Name: ";
+                cin.ignore();
+                getline(cin, name);
+                
+                size_t start = name.find_first_not_of(" \t\n\r");
+                size_t end = name.find_last_not_of(" \t\n\r");
+                if (start != string::npos && end != string::npos) {
+                    name = name.substr(start, end - start + 1);
+                }
+                
+                int id = g.findCityId(name);
+                if (id == -1) {
+                    cout << "No city named '" << name << "' exists.\n";
+                } else {
+                    cout << "City '" << name << "' has ID: " << id << endl;
+                }
+                break;
+            }
+            case 14:
                 cout << "Exiting program. Goodbye!\n";
                 break;
             default:
                 cout << "Invalid choice! Please try again.\n";
         }
-    } while (choice != 13);
+    } while (choice != 14);
     
     return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,4230 @@
+// Shortest Path Finder routing library, header-only: include it and build
+// with C++17 (and -pthread). Graph is the full engine: versioned snapshots
+// for concurrent readers, traffic batches, blocking, k-shortest and
+// alternative routes, time-dependent routing, isochrones, and the
+// OverlayRouter and HubLabels accelerators over it. Graph is BasicGraph<>:
+// the engine is templated on weight and ID types, priority queue, and
+// traffic-cost and blocking policies. main.cpp is the command-line client:
+// the interactive menu, batch mode and the daemon, whose line protocol is in
+// commands.h. Any number of translation units may include the header; it
+// names std members in full and has no using-directives.
+
+#ifndef SPF_H
+#define SPF_H
+
+#include <iostream>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <set>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Append-only storage for city names. Names are copied into fixed-size blocks
+// that never move, so the views handed out stay valid until clear().
+class NameArena {
+private:
+    static constexpr size_t BLOCK_SIZE = 1 << 16;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t capacity;
+    size_t used;
+
+public:
+    NameArena() : capacity(0), used(0) {}
+
+    std::string_view intern(const std::string& name) {
+        if (name.size() > capacity - used) {
+            capacity = std::max(BLOCK_SIZE, name.size());
+            blocks.push_back(std::unique_ptr<char[]>(new char[capacity]));
+            used = 0;
+        }
+        char* stored = blocks.back().get() + used;
+        std::memcpy(stored, name.data(), name.size());
+        used += name.size();
+        return std::string_view(stored, name.size());
+    }
+
+    void clear() {
+        blocks.clear();
+        capacity = 0;
+        used = 0;
+    }
+};
+
+class City {
+public:
+    int distance;
+    std::string_view name;
+
+    City(std::string_view name = "", int distance = INT_MAX) : distance(distance), name(name) {}
+};
+
+inline int calculateEffectiveCost(int distance, int traffic) {
+    return distance + (distance * traffic / 10);
+}
+
+// Packed edge record. The relaxation loop only touches the first 8 bytes
+// (neighbor + cached effective cost); distance, traffic and the blocked flag
+// share one 32-bit word that is only read when the route is displayed or
+// edited. Any edit goes through a setter so the cached cost never goes stale.
+class Route {
+public:
+    static const uint32_t MAX_DISTANCE = (1u << 24) - 1;
+    static const uint32_t BLOCKED_COST = UINT32_MAX;
+
+    int32_t neighbor;
+    uint32_t cost;
+
+    Route(int n, int d) : neighbor(n), cost(0), attrs(0) { setDistance(d); }
+
+    // The cost and attribute words as one 64-bit value (cost in the low half),
+    // the unit EdgeOverlay stores atomically.
+    static Route fromWord(int n, uint64_t word) {
+        Route route(n, 0);
+        route.cost = uint32_t(word);
+        route.attrs = uint32_t(word >> 32);
+        return route;
+    }
+
+    uint64_t word() const { return (uint64_t(attrs) << 32) | cost; }
+
+    int distance() const { return attrs & MAX_DISTANCE; }
+    int traffic() const { return (attrs >> TRAFFIC_SHIFT) & TRAFFIC_MASK; }
+    bool isBlocked() const { return (attrs & BLOCKED_BIT) != 0; }
+
+    void setDistance(int d) {
+        attrs = (attrs & ~MAX_DISTANCE) | (uint32_t(d) & MAX_DISTANCE);
+        refreshCost();
+    }
+
+    // Bulk updates pass refresh=false and run recomputeCosts() over the
+    // whole adjacency block afterwards.
+    void setTraffic(int t, bool refresh = true) {
+        attrs = (attrs & ~(TRAFFIC_MASK << TRAFFIC_SHIFT)) | ((uint32_t(t) & TRAFFIC_MASK) << TRAFFIC_SHIFT);
+        if (refresh) refreshCost();
+    }
+
+    void setBlocked(bool blocked, bool refresh = true) {
+        attrs = blocked ? (attrs | BLOCKED_BIT) : (attrs & ~BLOCKED_BIT);
+        if (refresh) refreshCost();
+    }
+
+private:
+    static const uint32_t TRAFFIC_SHIFT = 24;
+    static const uint32_t TRAFFIC_MASK = 0xF;
+    static const uint32_t BLOCKED_BIT = 1u << 28;
+
+    // distance:24 | traffic:4 | blocked:1
+    uint32_t attrs;
+
+    void refreshCost() {
+        cost = isBlocked() ? BLOCKED_COST : calculateEffectiveCost(distance(), traffic());
+    }
+
+    friend void recomputeCosts(Route* routes, size_t count);
+};
+
+// Recomputes the cached cost of a run of routes from their attribute words.
+// With AVX2 eight routes (three 256-bit words) are done per step: the attribute
+// words are shuffled into one register, distance * traffic / 10 uses the exact
+// (x * 0xCCCCCCCD) >> 35 division, and the costs are blended back in place.
+inline void recomputeCosts(Route* routes, size_t count) {
+    size_t i = 0;
+#ifdef __AVX2__
+    static_assert(sizeof(Route) == 3 * sizeof(uint32_t), "AVX2 path assumes {neighbor, cost, attrs}");
+    const __m256i attrsFrom0 = _mm256_setr_epi32(2, 5, 0, 0, 0, 0, 0, 0);
+    const __m256i attrsFrom1 = _mm256_setr_epi32(0, 0, 0, 3, 6, 0, 0, 0);
+    const __m256i attrsFrom2 = _mm256_setr_epi32(0, 0, 0, 0, 0, 1, 4, 7);
+    const __m256i costTo0 = _mm256_setr_epi32(0, 0, 0, 0, 1, 0, 0, 2);
+    const __m256i costTo1 = _mm256_setr_epi32(0, 0, 3, 0, 0, 4, 0, 0);
+    const __m256i costTo2 = _mm256_setr_epi32(5, 0, 0, 6, 0, 0, 7, 0);
+    const __m256i distanceMask = _mm256_set1_epi32(Route::MAX_DISTANCE);
+    const __m256i trafficMask = _mm256_set1_epi32(Route::TRAFFIC_MASK);
+    const __m256i blockedBit = _mm256_set1_epi32(Route::BLOCKED_BIT);
+    const __m256i tenth = _mm256_set1_epi64x(0xCCCCCCCDLL);
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i* words = reinterpret_cast<__m256i*>(routes + i);
+        __m256i w0 = _mm256_loadu_si256(words);
+        __m256i w1 = _mm256_loadu_si256(words + 1);
+        __m256i w2 = _mm256_loadu_si256(words + 2);
+
+        __m256i attrs = _mm256_blend_epi32(_mm256_permutevar8x32_epi32(w0, attrsFrom0),
+                                           _mm256_permutevar8x32_epi32(w1, attrsFrom1), 0x1C);
+        attrs = _mm256_blend_epi32(attrs, _mm256_permutevar8x32_epi32(w2, attrsFrom2), 0xE0);
+
+        __m256i distance = _mm256_and_si256(attrs, distanceMask);
+        __m256i traffic = _mm256_and_si256(_mm256_srli_epi32(attrs, Route::TRAFFIC_SHIFT), trafficMask);
+        __m256i product = _mm256_mullo_epi32(distance, traffic);
+        __m256i evenQuot = _mm256_srli_epi64(_mm256_mul_epu32(product, tenth), 35);
+        __m256i oddQuot = _mm256_srli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(product, 32), tenth), 35);
+        __m256i quotient = _mm256_blend_epi32(evenQuot, _mm256_slli_epi64(oddQuot, 32), 0xAA);
+        __m256i blocked = _mm256_cmpeq_epi32(_mm256_and_si256(attrs, blockedBit), blockedBit);
+        __m256i cost = _mm256_or_si256(_mm256_add_epi32(distance, quotient), blocked);
+
+        _mm256_storeu_si256(words, _mm256_blend_epi32(w0, _mm256_permutevar8x32_epi32(cost, costTo0), 0x92));
+        _mm256_storeu_si256(words + 1, _mm256_blend_epi32(w1, _mm256_permutevar8x32_epi32(cost, costTo1), 0x24));
+        _mm256_storeu_si256(words + 2, _mm256_blend_epi32(w2, _mm256_permutevar8x32_epi32(cost, costTo2), 0x49));
+    }
+#endif
+    for (; i < count; i++) {
+        routes[i].refreshCost();
+    }
+}
+
+// Binary min-heap of (distance, city) with decrease-key: pushing a city that
+// is already queued lowers its key instead. The default queue policy of
+// BasicGraph's dijkstra(); MinHeap is the instance the other searches use.
+template <class Weight, class Id>
+class BasicMinHeap {
+private:
+    std::vector<std::pair<Weight, Id>> heap;
+    // Heap position of each node, or -1. Nodes are dense city IDs, so this
+    // is a plain array, grown on demand.
+    std::vector<int> indexMap;
+
+    int parent(int i) { return (i - 1) / 2; }
+    int leftChild(int i) { return 2 * i + 1; }
+    int rightChild(int i) { return 2 * i + 2; }
+
+    void swap(int i, int j) {
+        indexMap[heap[i].second] = j;
+        indexMap[heap[j].second] = i;
+        std::pair<Weight, Id> temp = heap[i];
+        heap[i] = heap[j];
+        heap[j] = temp;
+    }
+
+    void heapifyUp(int i) {
+        while (i > 0 && heap[parent(i)].first > heap[i].first) {
+            swap(i, parent(i));
+            i = parent(i);
+        }
+    }
+
+    void heapifyDown(int i) {
+        int minIndex = i;
+        int left = leftChild(i);
+        int right = rightChild(i);
+
+        if (left < (int)heap.size() && heap[left].first < heap[minIndex].first) {
+            minIndex = left;
+        }
+        if (right < (int)heap.size() && heap[right].first < heap[minIndex].first) {
+            minIndex = right;
+        }
+
+        if (i != minIndex) {
+            swap(i, minIndex);
+            heapifyDown(minIndex);
+        }
+    }
+
+public:
+    void push(Weight distance, Id node) {
+        if ((size_t)node >= indexMap.size()) {
+            indexMap.resize(std::max((size_t)node + 1, indexMap.size() * 2), -1);
+        }
+        if (indexMap[node] != -1) {
+            int idx = indexMap[node];
+            if (distance < heap[idx].first) {
+                heap[idx].first = distance;
+                heapifyUp(idx);
+            }
+            return;
+        }
+
+        heap.push_back({distance, node});
+        int idx = heap.size() - 1;
+        indexMap[node] = idx;
+        heapifyUp(idx);
+    }
+
+    std::pair<Weight, Id> top() {
+        if (heap.empty()) {
+            return {-1, -1};
+        }
+        return heap[0];
+    }
+
+    void pop() {
+        if (heap.empty()) return;
+
+        indexMap[heap[0].second] = -1;
+
+        if (heap.size() == 1) {
+            heap.pop_back();
+            return;
+        }
+
+        heap[0] = heap.back();
+        heap.pop_back();
+        
+        if (!heap.empty()) {
+            indexMap[heap[0].second] = 0;
+            heapifyDown(0);
+        }
+    }
+
+    bool empty() {
+        return heap.size() == 0;
+    }
+
+    int size() {
+        return heap.size();
+    }
+
+    // Empties the heap in O(size), keeping the index array for reuse.
+    void clear() {
+        for (const std::pair<Weight, Id>& entry : heap) {
+            indexMap[entry.second] = -1;
+        }
+        heap.clear();
+    }
+};
+
+typedef BasicMinHeap<int, int> MinHeap;
+
+// Reusable arrays for one search at a time. Entries are only valid while
+// their stamp matches the current search, so starting one costs nothing
+// however large the graph is. Costs are Weight labels queued in a Queue (see
+// the Graph policies); SearchScratch is the int one the searches outside
+// dijkstra() use.
+template <class Weight = int, template <class, class> class Queue = BasicMinHeap>
+class BasicSearchScratch {
+public:
+    std::vector<uint32_t> reached;
+    std::vector<uint32_t> banned;
+    std::vector<Weight> costs;
+    std::vector<int> parents;
+    Queue<Weight, int> minHeap;
+    uint32_t stamp;
+
+    BasicSearchScratch() : stamp(0) {}
+
+    void begin(int cityCount) {
+        if ((int)reached.size() < cityCount) {
+            reached.assign(cityCount, 0);
+            banned.assign(cityCount, 0);
+            costs.resize(cityCount);
+            parents.resize(cityCount);
+            stamp = 0;
+        }
+        if (++stamp == 0) {
+            std::fill(reached.begin(), reached.end(), 0);
+            std::fill(banned.begin(), banned.end(), 0);
+            stamp = 1;
+        }
+        minHeap.clear();
+    }
+};
+
+typedef BasicSearchScratch<> SearchScratch;
+
+// A Scratch borrowed from the calling thread's pool for one search. A pool
+// rather than one per thread, so a search's callbacks can run searches of
+// their own. Each Scratch type has a pool of its own.
+template <class Scratch = SearchScratch>
+class BasicScratchLease {
+private:
+    std::unique_ptr<Scratch> scratch;
+
+    static std::vector<std::unique_ptr<Scratch>>& pool() {
+        thread_local std::vector<std::unique_ptr<Scratch>> idle;
+        return idle;
+    }
+
+public:
+    BasicScratchLease() {
+        std::vector<std::unique_ptr<Scratch>>& idle = pool();
+        if (idle.empty()) {
+            scratch.reset(new Scratch());
+        } else {
+            scratch = std::move(idle.back());
+            idle.pop_back();
+        }
+    }
+    ~BasicScratchLease() { pool().push_back(std::move(scratch)); }
+
+    BasicScratchLease(const BasicScratchLease&) = delete;
+    BasicScratchLease& operator=(const BasicScratchLease&) = delete;
+
+    Scratch& operator*() const { return *scratch; }
+};
+
+typedef BasicScratchLease<> ScratchLease;
+
+// What one dijkstra() search did. SearchProbe counts it while the search
+// runs; with SPF_INSTRUMENT defined at build time every finished search is
+// added to its thread's SearchStats histograms (the "stats" command reads
+// them). Without it the probe is empty and its calls compile to nothing.
+enum SearchMetric {
+    WALL_NANOSECONDS,
+    SETTLED,
+    RELAXED,
+    HEAP_PUSHES,
+    HEAP_POPS,
+    DECREASE_KEYS,
+    STALE_POPS,
+    SEARCH_METRICS
+};
+
+#ifdef SPF_INSTRUMENT
+// HDR-style histogram: values below 32 are counted exactly, larger ones in
+// 16 linear sub-buckets per power of two (within 1/16 of the value). One
+// thread records; any thread may read. Counts are atomics written with plain
+// relaxed stores by the owner, so recording takes no lock and no
+// read-modify-write.
+class LatencyHistogram {
+public:
+    static constexpr int BUCKETS = 32 + 59 * 16;
+
+    LatencyHistogram() : total(0), largest(0) {
+        for (std::atomic<uint64_t>& count : counts) count.store(0, std::memory_order_relaxed);
+    }
+
+    void record(uint64_t value) {
+        std::atomic<uint64_t>& count = counts[bucket(value)];
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        total.store(total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (value > largest.load(std::memory_order_relaxed)) largest.store(value, std::memory_order_relaxed);
+    }
+
+    void addTo(std::vector<uint64_t>& merged, uint64_t& count, uint64_t& maximum) const {
+        merged.resize(BUCKETS);
+        for (int i = 0; i < BUCKETS; i++) merged[i] += counts[i].load(std::memory_order_relaxed);
+        count += total.load(std::memory_order_relaxed);
+        maximum = std::max(maximum, largest.load(std::memory_order_relaxed));
+    }
+
+    static int bucket(uint64_t value) {
+        if (value < 32) return (int)value;
+        int shift = 63 - __builtin_clzll(value) - 4;
+        return 32 + (shift - 1) * 16 + (int)((value >> shift) - 16);
+    }
+
+    // The largest value counted in bucket i.
+    static uint64_t highest(int i) {
+        if (i < 32) return i;
+        int shift = (i - 32) / 16 + 1;
+        uint64_t sub = (i - 32) % 16 + 16;
+        return ((sub + 1) << shift) - 1;
+    }
+
+private:
+    std::atomic<uint64_t> counts[BUCKETS];
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> largest;
+};
+
+// Per-thread search histograms, one per SearchMetric. A thread registers
+// its set on its first search and never takes the lock again; the sets are
+// kept after their thread exits so nothing recorded is lost.
+class SearchStats {
+public:
+    class Summary {
+    public:
+        uint64_t count = 0;
+        uint64_t maximum = 0;
+        uint64_t p50 = 0, p90 = 0, p99 = 0, p999 = 0;
+    };
+
+    static void record(const uint64_t (&values)[SEARCH_METRICS]) {
+        thread_local Histograms* mine = enroll();
+        for (int metric = 0; metric < SEARCH_METRICS; metric++) mine->metrics[metric].record(values[metric]);
+    }
+
+    // Percentiles over every thread's searches so far.
+    static Summary summarize(SearchMetric metric) {
+        std::vector<uint64_t> merged;
+        Summary summary;
+        {
+            std::lock_guard<std::mutex> lock(registry().lock);
+            for (const std::unique_ptr<Histograms>& histograms : registry().threads) {
+                histograms->metrics[metric].addTo(merged, summary.count, summary.maximum);
+            }
+        }
+        summary.p50 = percentile(merged, summary, 0.5);
+        summary.p90 = percentile(merged, summary, 0.9);
+        summary.p99 = percentile(merged, summary, 0.99);
+        summary.p999 = percentile(merged, summary, 0.999);
+        return summary;
+    }
+
+private:
+    class alignas(64) Histograms {
+    public:
+        LatencyHistogram metrics[SEARCH_METRICS];
+    };
+
+    class Registry {
+    public:
+        std::mutex lock;
+        std::vector<std::unique_ptr<Histograms>> threads;
+    };
+
+    static Registry& registry() {
+        static Registry shared;
+        return shared;
+    }
+
+    static Histograms* enroll() {
+        std::lock_guard<std::mutex> lock(registry().lock);
+        registry().threads.push_back(std::unique_ptr<Histograms>(new Histograms()));
+        return registry().threads.back().get();
+    }
+
+    static uint64_t percentile(const std::vector<uint64_t>& merged, const Summary& summary, double p) {
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t)(p * summary.count + 0.999999));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < merged.size(); i++) {
+            seen += merged[i];
+            if (seen >= rank) return std::min(LatencyHistogram::highest(i), summary.maximum);
+        }
+        return summary.maximum;
+    }
+};
+
+class SearchProbe {
+public:
+    SearchProbe() : start(std::chrono::steady_clock::now()), values() {}
+    ~SearchProbe() {
+        values[WALL_NANOSECONDS] =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        SearchStats::record(values);
+    }
+
+    void settled() { values[SETTLED]++; }
+    void relaxed() { values[RELAXED]++; }
+    void pushed() { values[HEAP_PUSHES]++; }
+    void decreased() { values[DECREASE_KEYS]++; }
+    void popped() { values[HEAP_POPS]++; }
+    void stale() { values[STALE_POPS]++; }
+
+private:
+    std::chrono::steady_clock::time_point start;
+    uint64_t values[SEARCH_METRICS];
+};
+#else
+class SearchProbe {
+public:
+    void settled() {}
+    void relaxed() {}
+    void pushed() {}
+    void decreased() {}
+    void popped() {}
+    void stale() {}
+};
+#endif
+
+// Runs work(worker, i) for every i in [0, count) on up to workers threads;
+// the calling thread is worker 0.
+inline void parallelFor(int count, int workers, const std::function<void(int, int)>& work) {
+    workers = std::min(workers, count);
+    if (workers <= 1) {
+        for (int i = 0; i < count; i++) work(0, i);
+        return;
+    }
+    std::atomic<int> nextIndex(0);
+    auto drain = [&](int worker) {
+        for (int i = nextIndex++; i < count; i = nextIndex++) work(worker, i);
+    };
+    std::vector<std::thread> helpers;
+    for (int worker = 1; worker < workers; worker++) {
+        helpers.emplace_back(drain, worker);
+    }
+    drain(0);
+    for (std::thread& helper : helpers) helper.join();
+}
+
+class TrafficUpdate {
+public:
+    int from;
+    int to;
+    int level;
+
+    TrafficUpdate(int from = 0, int to = 0, int level = 0) : from(from), to(to), level(level) {}
+};
+
+class NewRoute {
+public:
+    int from;
+    int to;
+    int distance;
+    bool oneWay;
+
+    NewRoute(int from = 0, int to = 0, int distance = 0, bool oneWay = false)
+        : from(from), to(to), distance(distance), oneWay(oneWay) {}
+};
+
+// One breakpoint of a travel-time profile: leaving at this minute of the
+// day, the route takes travelTime. Route costs double as minutes of travel.
+class ProfilePoint {
+public:
+    int minute;
+    int travelTime;
+
+    ProfilePoint(int minute = 0, int travelTime = 0) : minute(minute), travelTime(travelTime) {}
+};
+
+class RouteProfile {
+public:
+    int from;
+    int to;
+    std::vector<ProfilePoint> points;  // empty: back to the static cost
+
+    RouteProfile(int from = 0, int to = 0, const std::vector<ProfilePoint>& points = std::vector<ProfilePoint>())
+        : from(from), to(to), points(points) {}
+};
+
+class RouteToll {
+public:
+    int from;
+    int to;
+    int toll;
+
+    RouteToll(int from = 0, int to = 0, int toll = 0) : from(from), to(to), toll(toll) {}
+};
+
+class RouteLimits {
+public:
+    int from;
+    int to;
+    int maxHeight;  // centimetres
+    int maxWeight;  // kilograms
+
+    RouteLimits(int from = 0, int to = 0, int maxHeight = 0, int maxWeight = 0)
+        : from(from), to(to), maxHeight(maxHeight), maxWeight(maxWeight) {}
+};
+
+class TrafficBatchReport {
+public:
+    int applied;
+    int autoBlocked;
+    int rejected;
+    long long microseconds;
+    unsigned long long version;
+
+    TrafficBatchReport() : applied(0), autoBlocked(0), rejected(0), microseconds(0), version(0) {}
+};
+
+// Outcome of a Graph mutation. The client turns each into text: menu text
+// in ConsoleView, protocol replies in CommandProcessor (commands.h).
+enum class GraphStatus {
+    OK,
+    ROUTE_UPDATED,
+    ALREADY_BLOCKED,
+    ALREADY_OPEN,
+    AUTO_BLOCKED,
+    STILL_BLOCKED,
+    EMPTY_NAME,
+    DUPLICATE_NAME,
+    NO_SOURCE,
+    NO_DESTINATION,
+    NO_SUCH_CITY,
+    SAME_CITY,
+    INVALID_DISTANCE,
+    DISTANCE_TOO_LARGE,
+    INVALID_TRAFFIC,
+    NO_SUCH_ROUTE,
+    INVALID_PROFILE,
+    NOT_FIFO,
+    INVALID_TOLL,
+    INVALID_LIMIT,
+};
+
+enum class PathStatus {
+    FOUND,
+    SAME_CITY,
+    NO_PATH,
+    EMPTY_GRAPH,
+    INVALID_SOURCE,
+    INVALID_DESTINATION,
+    INVALID_DEPARTURE,
+    INVALID_BUDGET,
+};
+
+// A path query's answer, with costs in Weight and cities in Id (see
+// BasicGraph::Path).
+template <class Weight, class Id>
+class BasicPathResult {
+public:
+    PathStatus status;
+    Id src;
+    Id dest;
+    // Effective cost (with traffic) and the cities from src to dest; only
+    // set when found().
+    Weight cost;
+    int hops;
+    std::vector<Id> nodes;
+
+    BasicPathResult(PathStatus status = PathStatus::NO_PATH, Id src = Id(-1), Id dest = Id(-1))
+        : status(status), src(src), dest(dest), cost(-1), hops(0) {}
+
+    bool found() const { return status == PathStatus::FOUND || status == PathStatus::SAME_CITY; }
+};
+
+typedef BasicPathResult<long long, int> PathResult;
+
+// A city inside an isochrone, with its cost from the source and its parent
+// on that cheapest path (the source is its own parent).
+class ReachedCity {
+public:
+    int city;
+    int cost;
+    int parent;
+
+    ReachedCity(int city = -1, int cost = 0, int parent = -1) : city(city), cost(cost), parent(parent) {}
+};
+
+// A route out of an isochrone: it leaves a reached city, but its far end is
+// not reachable within the budget. remaining is the budget left on leaving
+// from, so a map can draw how far along the route one gets.
+class FrontierRoute {
+public:
+    int from;
+    int to;
+    int remaining;
+    uint32_t cost;
+
+    FrontierRoute(int from = -1, int to = -1, int remaining = 0, uint32_t cost = 0)
+        : from(from), to(to), remaining(remaining), cost(cost) {}
+};
+
+class Isochrone {
+public:
+    PathStatus status;
+    int src;
+    int budget;
+    std::vector<ReachedCity> cities;  // cheapest first
+    std::vector<FrontierRoute> frontier;
+
+    Isochrone(PathStatus status = PathStatus::FOUND, int src = -1, int budget = 0)
+        : status(status), src(src), budget(budget) {}
+};
+
+// ===== Graph policies =====
+// BasicGraph, the engine below, is a template over
+//   Weight  the labels dijkstra() sums route costs into, and the type of its
+//           path costs (int, long long, double, ...)
+//   Id      city IDs in the per-city calls and in returned paths (any
+//           integral type; IDs past INT_MAX name no city)
+//   Queue   the priority queue of dijkstra() and dijkstraAt():
+//           BasicMinHeap (decrease-key) or LazyMinHeap (duplicates, skipped
+//           when stale)
+//   Cost    how traffic changes a route's cost: TrafficCost or DistanceCost
+//   Block   whether routes can be closed: Blocking or NoBlocking
+// and Graph is BasicGraph<>. Effective costs are computed when a route's
+// overlay word is written, and a blocked route costs Route::BLOCKED_COST,
+// so the relaxation loop reads a neighbour and a cost and nothing else,
+// whatever the policies. Disabled features take their member functions with
+// them: calling setTraffic() on a DistanceCost graph or blockRoute() on a
+// NoBlocking one does not compile. Each query can also pick what to
+// minimize: see the cost models below.
+
+// Traffic levels 0-10 add 10% of the distance each, as
+// calculateEffectiveCost does; levels 8-10 also block the route when the
+// graph has Blocking.
+class TrafficCost {
+public:
+    static constexpr bool usesTraffic = true;
+
+    template <class Weight>
+    static Weight effective(Weight distance, int traffic) {
+        if constexpr (std::is_integral<Weight>::value) {
+            // distance * traffic / 10 without the product overflowing.
+            return distance + distance / 10 * traffic + distance % 10 * traffic / 10;
+        } else {
+            return distance + distance * traffic / 10;
+        }
+    }
+};
+
+// Routes cost their distance; there are no traffic levels.
+class DistanceCost {
+public:
+    static constexpr bool usesTraffic = false;
+
+    template <class Weight>
+    static Weight effective(Weight distance, int) {
+        return distance;
+    }
+};
+
+class Blocking {
+public:
+    static constexpr bool enabled = true;
+};
+
+class NoBlocking {
+public:
+    static constexpr bool enabled = false;
+};
+
+// The cost of a blocked or forbidden route, and of an unreached city.
+template <class Weight>
+constexpr Weight unreachableCost() {
+    return std::numeric_limits<Weight>::has_infinity ? std::numeric_limits<Weight>::infinity()
+                                                     : std::numeric_limits<Weight>::max();
+}
+
+// What a cost model may read of a route besides its travel cost: its
+// distance, its toll and the largest vehicle allowed on it.
+template <class Weight>
+class RouteTerms {
+public:
+    Weight distance = Weight();
+    Weight toll = Weight();
+    int maxHeight = INT_MAX;  // centimetres
+    int maxWeight = INT_MAX;  // kilograms
+};
+
+// ===== Cost models =====
+// A cost model is what Graph::dijkstra() minimizes, chosen per query as a
+// template argument, so each model gets its own relaxation loop with the
+// cost inlined. cost(travel, terms) gets a route's travel cost (the
+// effective cost with traffic, unreachableCost() when blocked) and its
+// RouteTerms; usesTerms = false keeps the terms out of the loop entirely.
+// Route costs are uint32_t, so queries take TollModel<uint32_t>.
+// Costs are written as selects, leaving the compiler free to use
+// conditional moves; whether it does is its call (GCC branches on
+// TruckModel's limits).
+
+// Effective cost with traffic: the default for Graph::dijkstra(), and the
+// only cost its other queries know.
+class TravelModel {
+public:
+    static constexpr bool usesTerms = false;
+
+    template <class Weight>
+    Weight cost(Weight travel, const RouteTerms<Weight>&) const {
+        return travel;
+    }
+};
+
+// Distance alone, ignoring traffic; blocked routes stay closed.
+class DistanceModel {
+public:
+    static constexpr bool usesTerms = true;
+
+    template <class Weight>
+    Weight cost(Weight travel, const RouteTerms<Weight>& terms) const {
+        return travel == unreachableCost<Weight>() ? travel : terms.distance;
+    }
+};
+
+// Travel cost plus each toll times perToll, the cost of one unit of toll in
+// units of travel cost; tolls * perToll must fit in a Weight (in Graph, with
+// tolls up to Route::MAX_DISTANCE, perToll up to 255).
+template <class Weight>
+class TollModel {
+public:
+    static constexpr bool usesTerms = true;
+    Weight perToll;
+
+    explicit TollModel(Weight perToll = 1) : perToll(perToll) {}
+
+    Weight cost(Weight travel, const RouteTerms<Weight>& terms) const {
+        Weight extra = terms.toll * perToll;
+        return travel > unreachableCost<Weight>() - extra ? unreachableCost<Weight>() : travel + extra;
+    }
+};
+
+// Travel cost for a vehicle of this height and weight: routes whose limits
+// it exceeds are closed to it.
+class TruckModel {
+public:
+    static constexpr bool usesTerms = true;
+    int height;  // centimetres
+    int weight;  // kilograms
+
+    TruckModel(int height, int weight) : height(height), weight(weight) {}
+
+    template <class Weight>
+    Weight cost(Weight travel, const RouteTerms<Weight>& terms) const {
+        bool forbidden = (height > terms.maxHeight) | (weight > terms.maxWeight);
+        return forbidden ? unreachableCost<Weight>() : travel;
+    }
+};
+
+// Binary heap without decrease-key: a cheaper label is pushed again and the
+// search skips the stale one when it surfaces. No per-city index to keep, at
+// the price of a larger heap.
+template <class Weight, class Id>
+class LazyMinHeap {
+private:
+    std::vector<std::pair<Weight, Id>> heap;
+
+public:
+    void push(Weight distance, Id node) {
+        heap.push_back(std::make_pair(distance, node));
+        std::push_heap(heap.begin(), heap.end(), std::greater<std::pair<Weight, Id>>());
+    }
+
+    std::pair<Weight, Id> top() const { return heap.front(); }
+
+    void pop() {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<std::pair<Weight, Id>>());
+        heap.pop_back();
+    }
+
+    bool empty() const { return heap.empty(); }
+    int size() const { return heap.size(); }
+    void clear() { heap.clear(); }
+};
+
+// Static topology entry: a neighbour and the ID of the edge's overlay word.
+class Link {
+public:
+    int32_t neighbor;
+    uint32_t edge;
+
+    Link(int neighbor, uint32_t edge) : neighbor(neighbor), edge(edge) {}
+};
+
+// Per-edge Route::word() values indexed by edge ID, shared by every version
+// built on the same topology. Words sit in chunks that never move, so readers
+// load them without a lock while the writer appends edges and overwrites
+// words in place with relaxed stores. The cost and the attributes it was
+// computed from share one 64-bit word, so a load never sees them torn apart.
+class EdgeOverlay {
+public:
+    static const int CHUNK_BITS = 16;
+    static const int CHUNK_SIZE = 1 << CHUNK_BITS;
+    // Enough chunks for every 32-bit edge ID.
+    static const int MAX_CHUNKS = 1 << (32 - CHUNK_BITS);
+
+    EdgeOverlay() : count(0) {}
+
+    EdgeOverlay(const EdgeOverlay&) = delete;
+    EdgeOverlay& operator=(const EdgeOverlay&) = delete;
+
+    // Writer only. The word must be stored before any version that links to
+    // the new edge is published.
+    uint32_t append(uint64_t word) {
+        uint32_t edge = count++;
+        if ((edge & (CHUNK_SIZE - 1)) == 0) {
+            chunks[edge >> CHUNK_BITS].reset(new std::atomic<uint64_t>[CHUNK_SIZE]);
+        }
+        store(edge, word);
+        return edge;
+    }
+
+    // Writer only.
+    uint32_t size() const { return count; }
+
+    uint64_t load(uint32_t edge) const {
+        return at(edge).load(std::memory_order_relaxed);
+    }
+
+    uint32_t cost(uint32_t edge) const {
+        return uint32_t(load(edge));
+    }
+
+    void store(uint32_t edge, uint64_t word) {
+        at(edge).store(word, std::memory_order_relaxed);
+    }
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> chunks[MAX_CHUNKS];
+    uint32_t count;
+
+    std::atomic<uint64_t>& at(uint32_t edge) const {
+        return chunks[edge >> CHUNK_BITS][edge & (CHUNK_SIZE - 1)];
+    }
+};
+
+// Connected components of the open routes, ignoring direction, as a
+// union-find forest over city IDs: cities in different components have no
+// path between them either way. Like EdgeOverlay, one index is shared by
+// every version and read without locks. A join is one store pointing a root
+// at another root, so a reader's find() always ends at a root; only the
+// writer joins and compresses paths.
+//
+// Blocking a route may split a component, which a forest cannot undo, so it
+// only marks the index stale. A stale index still joins everything the open
+// routes join, which is all that ruling a search out needs; Graph replaces
+// it with a fresh one when it next fails to rule out a search.
+class ComponentIndex {
+public:
+    static const int CHUNK_BITS = 16;
+    static const int CHUNK_SIZE = 1 << CHUNK_BITS;
+    // Enough chunks for every non-negative int city ID.
+    static const int MAX_CHUNKS = 1 << (31 - CHUNK_BITS);
+
+    // GraphVersion::generation of the graph this index describes; versions
+    // from before a clearGraph() have an older one.
+    const unsigned long long generation;
+    std::atomic<bool> stale;
+
+    explicit ComponentIndex(unsigned long long generation) : generation(generation), stale(false), count(0) {}
+
+    ComponentIndex(const ComponentIndex&) = delete;
+    ComponentIndex& operator=(const ComponentIndex&) = delete;
+
+    // Writer only. Makes every ID below cityCount a component of its own,
+    // unless it already has one.
+    void grow(int cityCount) {
+        for (; count < cityCount; count++) {
+            if ((count & (CHUNK_SIZE - 1)) == 0) {
+                chunks[count >> CHUNK_BITS].reset(new std::atomic<int>[CHUNK_SIZE]);
+            }
+            at(count).store(count, std::memory_order_relaxed);
+            sizes.push_back(1);
+        }
+    }
+
+    int find(int city) const {
+        for (int parent = at(city).load(std::memory_order_relaxed); parent != city;
+             parent = at(city).load(std::memory_order_relaxed)) {
+            city = parent;
+        }
+        return city;
+    }
+
+    // Writer only. Joins the components of a and b; false if they were
+    // already one.
+    bool unite(int a, int b) {
+        a = compress(a);
+        b = compress(b);
+        if (a == b) return false;
+        if (sizes[a] < sizes[b]) std::swap(a, b);
+        at(b).store(a, std::memory_order_relaxed);
+        sizes[a] += sizes[b];
+        return true;
+    }
+
+private:
+    std::unique_ptr<std::atomic<int>[]> chunks[MAX_CHUNKS];
+    int count;
+    std::vector<int> sizes;  // writer only; valid at roots
+
+    std::atomic<int>& at(int city) const {
+        return chunks[city >> CHUNK_BITS][city & (CHUNK_SIZE - 1)];
+    }
+
+    // find() with path halving.
+    int compress(int city) {
+        while (true) {
+            int parent = at(city).load(std::memory_order_relaxed);
+            if (parent == city) return city;
+            int grandparent = at(parent).load(std::memory_order_relaxed);
+            at(city).store(grandparent, std::memory_order_relaxed);
+            city = grandparent;
+        }
+    }
+};
+
+// Piecewise-linear travel-time profiles by time of day, and which edge
+// follows which. A profile's breakpoints wrap around midnight: after the last
+// one, travel time moves linearly towards the first, a day later. Identical
+// profiles are stored once. A table is immutable once published with a
+// version; the writer changes a copy.
+class TravelProfiles {
+public:
+    static const int DAY_MINUTES = 24 * 60;
+    static const int MAX_POINTS = 288;
+    // Each profile's minutes are padded with INT_MAX to a multiple of LANES,
+    // so the vector search never runs into the next profile.
+    static const int LANES = 8;
+
+    std::vector<int32_t> minutes;
+    std::vector<int32_t> travelTimes;
+    std::vector<uint32_t> starts;
+    std::vector<uint32_t> sizes;
+    std::vector<uint32_t> edgeProfiles;  // edge -> profile + 1, or 0 for none
+
+    int profileOf(uint32_t edge) const {
+        return edge < edgeProfiles.size() ? (int)edgeProfiles[edge] - 1 : -1;
+    }
+
+    // Travel time on profile leaving at minute (0 <= minute < DAY_MINUTES).
+    int travelTime(int profile, int minute) const {
+        const int32_t* at = minutes.data() + starts[profile];
+        const int32_t* times = travelTimes.data() + starts[profile];
+        int size = sizes[profile];
+        int count = countUpTo(at, size, minute);
+
+        int fromMinute, fromTime, toMinute, toTime;
+        if (count == 0) {
+            fromMinute = at[size - 1] - DAY_MINUTES;
+            fromTime = times[size - 1];
+            toMinute = at[0];
+            toTime = times[0];
+        } else if (count == size) {
+            fromMinute = at[size - 1];
+            fromTime = times[size - 1];
+            toMinute = at[0] + DAY_MINUTES;
+            toTime = times[0];
+        } else {
+            fromMinute = at[count - 1];
+            fromTime = times[count - 1];
+            toMinute = at[count];
+            toTime = times[count];
+        }
+        // Division truncates towards the earlier breakpoint's time, which
+        // keeps minute + travelTime non-decreasing (FIFO) after rounding.
+        return fromTime + (int)((long long)(toTime - fromTime) * (minute - fromMinute) / (toMinute - fromMinute));
+    }
+
+    // INVALID_PROFILE unless minutes strictly increase within the day and
+    // travel times are positive distances; NOT_FIFO if leaving later could
+    // ever arrive earlier, i.e. a segment falls faster than one minute per
+    // minute.
+    static GraphStatus check(const std::vector<ProfilePoint>& points) {
+        if (points.empty() || (int)points.size() > MAX_POINTS) return GraphStatus::INVALID_PROFILE;
+        for (size_t i = 0; i < points.size(); i++) {
+            const ProfilePoint& point = points[i];
+            if (point.minute < 0 || point.minute >= DAY_MINUTES) return GraphStatus::INVALID_PROFILE;
+            if (point.travelTime <= 0 || point.travelTime > (int)Route::MAX_DISTANCE) return GraphStatus::INVALID_PROFILE;
+            if (i > 0 && point.minute <= points[i - 1].minute) return GraphStatus::INVALID_PROFILE;
+        }
+        for (size_t i = 0; i < points.size(); i++) {
+            const ProfilePoint& from = points[i];
+            const ProfilePoint& to = points[(i + 1) % points.size()];
+            int span = to.minute - from.minute + (i + 1 == points.size() ? DAY_MINUTES : 0);
+            if (from.travelTime - to.travelTime > span) return GraphStatus::NOT_FIFO;
+        }
+        return GraphStatus::OK;
+    }
+
+    // Appends a checked profile and returns its index.
+    int add(const std::vector<ProfilePoint>& points) {
+        starts.push_back(minutes.size());
+        sizes.push_back(points.size());
+        for (const ProfilePoint& point : points) {
+            minutes.push_back(point.minute);
+            travelTimes.push_back(point.travelTime);
+        }
+        while (minutes.size() % LANES != 0) {
+            minutes.push_back(INT_MAX);
+            travelTimes.push_back(points.back().travelTime);
+        }
+        return starts.size() - 1;
+    }
+
+    void assign(uint32_t edge, int profile) {
+        if (edge >= edgeProfiles.size()) {
+            if (profile < 0) return;
+            edgeProfiles.resize(edge + 1, 0);
+        }
+        edgeProfiles[edge] = profile + 1;
+    }
+
+private:
+    // Number of breakpoints at or before minute. With AVX2, a binary search
+    // over the first minute of each LANES-wide block picks the block, and
+    // one compare counts within it.
+    static int countUpTo(const int32_t* at, int size, int minute) {
+#ifdef __AVX2__
+        int low = 0, high = (size + LANES - 1) / LANES;
+        while (low < high) {
+            int middle = (low + high) / 2;
+            if (at[middle * LANES] <= minute) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (low == 0) return 0;
+        int block = (low - 1) * LANES;
+        __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(at + block));
+        __m256i upTo = _mm256_cmpgt_epi32(_mm256_set1_epi32(minute + 1), lanes);
+        return block + __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(upTo)));
+#else
+        return std::upper_bound(at, at + size, minute) - at;
+#endif
+    }
+};
+
+// Tolls and vehicle limits by edge, for the cost models that read them
+// (TollModel, TruckModel). Edges past the end have no toll and no limits,
+// and the distance term is not kept here: searches fill it in from the
+// overlay. Like TravelProfiles, a table is immutable once published with a
+// version; the writer changes a copy.
+class RouteTermsTable {
+public:
+    std::vector<RouteTerms<uint32_t>> edgeTerms;
+
+    RouteTerms<uint32_t> of(uint32_t edge) const {
+        return edge < edgeTerms.size() ? edgeTerms[edge] : RouteTerms<uint32_t>();
+    }
+
+    RouteTerms<uint32_t>& at(uint32_t edge) {
+        if (edge >= edgeTerms.size()) edgeTerms.resize(edge + 1);
+        return edgeTerms[edge];
+    }
+};
+
+// One immutable snapshot of the road network topology. City records and
+// adjacency blocks are reached through fixed-size pages indexed by city ID,
+// and pages and blocks are shared between consecutive versions: a writer
+// copies only the page table plus the pages and blocks it actually changes.
+// Edge costs, traffic and blocking are not versioned; they are read live from
+// the overlay. Travel-time profiles, tolls and limits change rarely and are
+// versioned whole.
+class GraphVersion {
+public:
+    static const int PAGE_BITS = 10;
+    static const int PAGE_SIZE = 1 << PAGE_BITS;
+
+    typedef std::vector<Link> LinkBlock;
+
+    class Page {
+    public:
+        City cities[PAGE_SIZE];
+        std::shared_ptr<const LinkBlock> links[PAGE_SIZE];
+        // The same links seen from the other end: Link::neighbor is the
+        // source. Backward searches walk these.
+        std::shared_ptr<const LinkBlock> inLinks[PAGE_SIZE];
+    };
+
+    unsigned long long number;
+    // Counts clearGraph() calls. Indexes derived from a version record it,
+    // since a freed overlay's address may come back for the next graph.
+    unsigned long long generation;
+    int nextCityId;
+    int cityCount;
+    std::vector<std::shared_ptr<const Page>> pages;
+    // Keeps the arena the City names point into alive.
+    std::shared_ptr<const NameArena> names;
+    std::shared_ptr<EdgeOverlay> overlay;
+    std::shared_ptr<const TravelProfiles> profiles;
+    std::shared_ptr<const RouteTermsTable> terms;
+
+    GraphVersion()
+        : number(0), generation(0), nextCityId(1), cityCount(0), profiles(std::make_shared<TravelProfiles>()),
+          terms(std::make_shared<RouteTermsTable>()) {}
+
+    bool hasCity(int id) const {
+        return id >= 1 && id < nextCityId && !city(id).name.empty();
+    }
+
+    const City& city(int id) const {
+        return pages[id >> PAGE_BITS]->cities[id & (PAGE_SIZE - 1)];
+    }
+
+    const LinkBlock& links(int id) const {
+        return block(pages[id >> PAGE_BITS]->links[id & (PAGE_SIZE - 1)]);
+    }
+
+    const LinkBlock& inLinks(int id) const {
+        return block(pages[id >> PAGE_BITS]->inLinks[id & (PAGE_SIZE - 1)]);
+    }
+
+    // The link's current overlay state.
+    Route route(const Link& link) const {
+        return Route::fromWord(link.neighbor, overlay->load(link.edge));
+    }
+
+private:
+    static const LinkBlock& block(const std::shared_ptr<const LinkBlock>& links) {
+        static const LinkBlock none;
+        return links ? *links : none;
+    }
+};
+
+// Writer-side draft of the next version. Pages and blocks are copied the
+// first time they are touched, so a draft costs O(pages + what changed).
+class VersionBuilder {
+private:
+    std::unique_ptr<GraphVersion> next;
+    std::vector<GraphVersion::Page*> ownPages;
+    std::unordered_map<int, GraphVersion::LinkBlock*> ownBlocks;
+    std::unordered_map<int, GraphVersion::LinkBlock*> ownInBlocks;
+
+    GraphVersion::Page& page(int id) {
+        size_t index = id >> GraphVersion::PAGE_BITS;
+        while (next->pages.size() <= index) {
+            std::shared_ptr<GraphVersion::Page> fresh = std::make_shared<GraphVersion::Page>();
+            ownPages.push_back(fresh.get());
+            next->pages.push_back(fresh);
+        }
+        if (ownPages[index] == nullptr) {
+            std::shared_ptr<GraphVersion::Page> copy = std::make_shared<GraphVersion::Page>(*next->pages[index]);
+            ownPages[index] = copy.get();
+            next->pages[index] = copy;
+        }
+        return *ownPages[index];
+    }
+
+    GraphVersion::LinkBlock& block(
+        int id, std::unordered_map<int, GraphVersion::LinkBlock*>& own,
+        std::shared_ptr<const GraphVersion::LinkBlock> (GraphVersion::Page::*blocks)[GraphVersion::PAGE_SIZE]) {
+        auto copied = own.find(id);
+        if (copied != own.end()) {
+            return *copied->second;
+        }
+        std::shared_ptr<const GraphVersion::LinkBlock>& slot = (page(id).*blocks)[id & (GraphVersion::PAGE_SIZE - 1)];
+        std::shared_ptr<GraphVersion::LinkBlock> copy = slot ? std::make_shared<GraphVersion::LinkBlock>(*slot)
+                                                        : std::make_shared<GraphVersion::LinkBlock>();
+        own[id] = copy.get();
+        slot = copy;
+        return *copy;
+    }
+
+public:
+    explicit VersionBuilder(const GraphVersion& base)
+        : next(new GraphVersion(base)), ownPages(base.pages.size(), nullptr) {
+        next->number = base.number + 1;
+    }
+
+    GraphVersion& version() { return *next; }
+
+    void setCity(int id, const City& city) {
+        page(id).cities[id & (GraphVersion::PAGE_SIZE - 1)] = city;
+    }
+
+    GraphVersion::LinkBlock& links(int id) {
+        return block(id, ownBlocks, &GraphVersion::Page::links);
+    }
+
+    GraphVersion::LinkBlock& inLinks(int id) {
+        return block(id, ownInBlocks, &GraphVersion::Page::inLinks);
+    }
+
+    GraphVersion* release() { return next.release(); }
+};
+
+class VersionManager;
+
+// A pinned version. It stays valid, however many newer versions are
+// published, until the guard goes out of scope.
+class ReadGuard {
+private:
+    VersionManager* manager;
+    int slot;
+    const GraphVersion* version;
+
+public:
+    ReadGuard(VersionManager* manager, int slot, const GraphVersion* version)
+        : manager(manager), slot(slot), version(version) {}
+    ReadGuard(ReadGuard&& other) : manager(other.manager), slot(other.slot), version(other.version) {
+        other.manager = nullptr;
+    }
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+    ~ReadGuard();
+
+    const GraphVersion* operator->() const { return version; }
+    const GraphVersion& operator*() const { return *version; }
+};
+
+// RCU-style publication of graph versions with epoch-based reclamation.
+// A reader claims an idle slot by CAS-ing the current epoch into it and then
+// loads the current version; releasing is one store. Readers never wait on
+// the writer. The writer (serialised by Graph's write lock) swaps in the next
+// version, tags the old one with the epoch it was retired in, and frees it
+// once every active slot holds a later epoch, i.e. once the last reader that
+// could still see it has let go.
+class VersionManager {
+public:
+    static const int MAX_READERS = 256;
+
+    explicit VersionManager(GraphVersion* initial) : current(initial), epoch(1) {
+        for (int i = 0; i < MAX_READERS; i++) {
+            readers[i].epoch.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    ~VersionManager() {
+        delete current.load();
+        for (auto& entry : retired) {
+            delete entry.second;
+        }
+    }
+
+    VersionManager(const VersionManager&) = delete;
+    VersionManager& operator=(const VersionManager&) = delete;
+
+    // Spins only if all MAX_READERS slots are pinned at once.
+    ReadGuard pin() {
+        static thread_local unsigned int hint = std::hash<std::thread::id>()(std::this_thread::get_id());
+        for (unsigned int i = hint;; i++) {
+            int slot = i % MAX_READERS;
+            unsigned long long idle = 0;
+            if (readers[slot].epoch.compare_exchange_strong(idle, epoch.load())) {
+                hint = slot;
+                return ReadGuard(this, slot, current.load());
+            }
+        }
+    }
+
+    void unpin(int slot) {
+        readers[slot].epoch.store(0, std::memory_order_release);
+    }
+
+    // Writer only: the newest version, without pinning it.
+    const GraphVersion& latest() const {
+        return *current.load();
+    }
+
+    // Writer only.
+    void publish(GraphVersion* next) {
+        const GraphVersion* old = current.exchange(next);
+        retired.push_back(std::make_pair(epoch.fetch_add(1), old));
+        reclaim();
+    }
+
+    // Writer only. Frees every retired version no active reader can hold.
+    void reclaim() {
+        unsigned long long oldestActive = ULLONG_MAX;
+        for (int i = 0; i < MAX_READERS; i++) {
+            unsigned long long pinned = readers[i].epoch.load();
+            if (pinned != 0 && pinned < oldestActive) {
+                oldestActive = pinned;
+            }
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < retired.size(); i++) {
+            if (retired[i].first < oldestActive) {
+                delete retired[i].second;
+            } else {
+                retired[kept++] = retired[i];
+            }
+        }
+        retired.resize(kept);
+    }
+
+    size_t retiredCount() const { return retired.size(); }
+
+private:
+    class alignas(64) ReaderSlot {
+    public:
+        std::atomic<unsigned long long> epoch;
+    };
+
+    std::atomic<const GraphVersion*> current;
+    std::atomic<unsigned long long> epoch;
+    ReaderSlot readers[MAX_READERS];
+    std::vector<std::pair<unsigned long long, const GraphVersion*>> retired;
+};
+
+inline ReadGuard::~ReadGuard() {
+    if (manager != nullptr) {
+        manager->unpin(slot);
+    }
+}
+
+// Directed reachability over the open routes of one version, for ruling out
+// queries before they search. Cities are grouped into strongly connected
+// components (Tarjan), numbered in topological order of the condensation
+// DAG, so a route between components always leads to a higher number. Each
+// component also carries LABELS interval labels (GRAIL): for every label a
+// DFS over the DAG, children in a different order each time, gives a
+// component the post-order range of everything it reaches. If one
+// component reaches another, every interval of the second is inside the
+// matching interval of the first; the converse is usually but not always
+// true, so mayReach() can say "maybe" for an unreachable pair, never "no"
+// for a reachable one. Immutable once built.
+class ReachabilityIndex {
+public:
+    static const int LABELS = 3;
+
+    unsigned long long generation;  // GraphVersion::generation it was built from
+    unsigned long long openings;    // Graph's count of route openings at build time
+    int componentCount;
+    int dagEdges;
+    std::vector<int> component;        // city -> component, in topological order
+
+    bool mayReach(int src, int dest) const {
+        int from = component[src], to = component[dest];
+        if (from == to) return true;
+        if (from > to) return false;
+        for (int label = 0; label < LABELS; label++) {
+            const int* a = &intervals[(size_t)(label * componentCount + from) * 2];
+            const int* b = &intervals[(size_t)(label * componentCount + to) * 2];
+            if (b[0] < a[0] || b[1] > a[1]) return false;
+        }
+        return true;
+    }
+
+    // Indexes graph's open routes (as of the calls to overlay->cost() the
+    // build makes). Labels are computed on up to workers threads.
+    static std::shared_ptr<ReachabilityIndex> build(const GraphVersion& graph, unsigned long long openings,
+                                                    int workers) {
+        std::shared_ptr<ReachabilityIndex> index = std::make_shared<ReachabilityIndex>();
+        index->generation = graph.generation;
+        index->openings = openings;
+        int cityCount = graph.nextCityId;
+
+        std::vector<int> firstOut(cityCount + 1, 0), heads;
+        for (int city = 1; city < cityCount; city++) {
+            firstOut[city] = heads.size();
+            if (!graph.hasCity(city)) continue;
+            for (const Link& link : graph.links(city)) {
+                if (graph.overlay->cost(link.edge) != Route::BLOCKED_COST) heads.push_back(link.neighbor);
+            }
+        }
+        firstOut[0] = 0;
+        firstOut[cityCount] = heads.size();
+
+        index->componentCount = strongComponents(cityCount, firstOut, heads, index->component);
+        int count = index->componentCount;
+
+        // Condensation DAG, duplicates removed.
+        std::vector<std::vector<int>> dag(count);
+        for (int city = 1; city < cityCount; city++) {
+            int from = index->component[city];
+            for (int i = firstOut[city]; i < firstOut[city + 1]; i++) {
+                int to = index->component[heads[i]];
+                if (to != from) dag[from].push_back(to);
+            }
+        }
+        index->dagEdges = 0;
+        for (std::vector<int>& next : dag) {
+            std::sort(next.begin(), next.end());
+            next.erase(std::unique(next.begin(), next.end()), next.end());
+            index->dagEdges += next.size();
+        }
+
+        index->intervals.resize((size_t)LABELS * count * 2);
+        parallelFor(LABELS, workers, [&](int, int label) {
+            index->labelIntervals(dag, label);
+        });
+        return index;
+    }
+
+private:
+    // Per label and component: lowest post-order number it reaches, and its
+    // own post-order number.
+    std::vector<int> intervals;
+
+    // Iterative Tarjan. Components are numbered in the order they complete,
+    // sinks first, then renumbered so routes lead to higher numbers. Cities
+    // that don't exist get components of their own. Returns the count.
+    static int strongComponents(int cityCount, const std::vector<int>& firstOut, const std::vector<int>& heads,
+                                std::vector<int>& component) {
+        std::vector<int> order(cityCount, -1), low(cityCount, 0), nextArc(cityCount, 0);
+        std::vector<int> stack, path;
+        component.assign(cityCount, -1);
+        int visited = 0, count = 0;
+        for (int root = 0; root < cityCount; root++) {
+            if (order[root] != -1) continue;
+            path.push_back(root);
+            order[root] = low[root] = visited++;
+            nextArc[root] = firstOut[root];
+            stack.push_back(root);
+            while (!path.empty()) {
+                int city = path.back();
+                if (nextArc[city] < firstOut[city + 1]) {
+                    int next = heads[nextArc[city]++];
+                    if (order[next] == -1) {
+                        order[next] = low[next] = visited++;
+                        nextArc[next] = firstOut[next];
+                        stack.push_back(next);
+                        path.push_back(next);
+                    } else if (component[next] == -1) {
+                        low[city] = std::min(low[city], order[next]);
+                    }
+                    continue;
+                }
+                path.pop_back();
+                if (!path.empty()) low[path.back()] = std::min(low[path.back()], low[city]);
+                if (low[city] == order[city]) {
+                    int member;
+                    do {
+                        member = stack.back();
+                        stack.pop_back();
+                        component[member] = count;
+                    } while (member != city);
+                    count++;
+                }
+            }
+        }
+        for (int& id : component) id = count - 1 - id;
+        return count;
+    }
+
+    // One GRAIL labeling: DFS from every unvisited component, each visiting
+    // its children from a different starting offset per label.
+    void labelIntervals(const std::vector<std::vector<int>>& dag, int label) {
+        int count = dag.size();
+        int* own = &intervals[(size_t)label * count * 2];
+        std::vector<int> nextChild(count, -1), path;
+        int post = 0;
+        for (int i = 0; i < count; i++) {
+            int root = label % 2 == 0 ? i : count - 1 - i;
+            if (nextChild[root] != -1) continue;
+            nextChild[root] = 0;
+            own[root * 2] = INT_MAX;
+            path.push_back(root);
+            while (!path.empty()) {
+                int node = path.back();
+                const std::vector<int>& children = dag[node];
+                if (nextChild[node] < (int)children.size()) {
+                    size_t offset = (size_t)node * (label + 1) * 2654435761u;
+                    int child = children[(offset + nextChild[node]++) % children.size()];
+                    if (nextChild[child] == -1) {
+                        nextChild[child] = 0;
+                        own[child * 2] = INT_MAX;
+                        path.push_back(child);
+                    } else {
+                        own[node * 2] = std::min(own[node * 2], own[child * 2]);
+                    }
+                    continue;
+                }
+                own[node * 2 + 1] = post++;
+                own[node * 2] = std::min(own[node * 2], own[node * 2 + 1]);
+                path.pop_back();
+                if (!path.empty()) own[path.back() * 2] = std::min(own[path.back() * 2], own[node * 2]);
+            }
+        }
+    }
+};
+
+// Queries (dijkstra, display*) pin the current version and never lock, so
+// they can run on any number of threads. Mutators take writeLock. Topology
+// changes (cities, new routes) build the next version copy-on-write and
+// publish it atomically, so a query sees all of such a change or none of it.
+// Distance, traffic and blocking changes are one relaxed store to the edge's
+// overlay word and become visible to running queries edge by edge, except
+// that a traffic batch is bracketed by batchSequence: the path queries
+// (dijkstra, dijkstraAt, kShortestPaths, alternativeRoutes and the Isochrone
+// form of reachableWithin) see all of a batch or none of it.
+//
+// The policies (see Graph policies) shape the write side, dijkstra() and
+// dijkstraAt()'s queue; the overlay words stay packed 32-bit costs under
+// every policy, and the other queries (k-shortest, alternatives,
+// isochrones, dijkstraAt's minutes) keep int labels. Bulk records (NewRoute, TrafficUpdate, ...), isochrones
+// and snapshots name cities by their stored int IDs.
+template <class Weight = int, class Id = int, template <class, class> class Queue = BasicMinHeap,
+          class Cost = TrafficCost, class Block = Blocking>
+class BasicGraph {
+    static_assert(std::is_signed<Weight>::value, "labels are compared with sums of costs: signed or floating-point");
+    static_assert((long double)std::numeric_limits<Weight>::max() >= INT_MAX, "labels hold any int path cost");
+    static_assert(std::is_integral<Id>::value, "city IDs are integers");
+
+public:
+    // Narrow integer labels are summed in 64 bits, and paths report the
+    // sums.
+    typedef typename std::conditional<std::is_integral<Weight>::value && sizeof(Weight) < sizeof(long long), long long,
+                                 Weight>::type PathCost;
+    typedef BasicPathResult<PathCost, Id> Path;
+
+private:
+    // Pooled arrays for dijkstra()'s labels and for dijkstraAt()'s minutes.
+    typedef BasicSearchScratch<Weight, Queue> WeightScratch;
+    typedef BasicSearchScratch<int, Queue> MinuteScratch;
+
+    mutable std::mutex writeLock;
+
+    // Writer-side state, guarded by writeLock. Names are interned in the
+    // arena and the name -> ID keys are views into it.
+    std::shared_ptr<NameArena> names;
+    std::unordered_map<std::string_view, int> cityIds;
+
+    // (u, v) -> overlay word of route u -> v, until clearGraph(), which also
+    // bumps generation.
+    std::shared_ptr<EdgeOverlay> overlay;
+    unsigned long long generation;
+    std::unordered_map<uint64_t, uint32_t> edgeIds;
+    // Flattened (minute, travel time) breakpoints -> profile index in the
+    // latest version's table.
+    std::map<std::vector<int>, int> profileIds;
+
+    mutable VersionManager versions;
+    std::atomic<unsigned long long> changes;
+
+    // Odd while applyTrafficBatch() is storing a batch's words; bumped by two
+    // per batch. batchLock is held exclusively over the same stores, for
+    // queries that keep colliding with batches (see wholeBatches()).
+    std::atomic<unsigned long long> batchSequence;
+    mutable std::shared_mutex batchLock;
+    static const int BATCH_RETRIES = 4;
+
+    // Components of the open routes (see ComponentIndex). Queries load it
+    // atomically; the writer joins into it and swaps in a rebuilt one.
+    mutable std::shared_ptr<ComponentIndex> components;
+
+    // Directed reachability of the open routes (see ReachabilityIndex),
+    // rebuilt by a background thread whenever a route is added, blocked or
+    // opened. Opening a route can make an index wrong, so openings counts
+    // them, and an index is only used while the count matches its own.
+    mutable std::shared_ptr<const ReachabilityIndex> reachability;
+    std::atomic<unsigned long long> openings;
+    std::mutex rebuildLock;
+    std::condition_variable rebuildWanted;
+    bool rebuildPending;
+    bool stopping;
+    std::thread rebuilder;
+
+    // A rebuild waits until changes have paused for REBUILD_QUIET, or at
+    // most REBUILD_MAX_WAIT, so a burst of edits costs one rebuild.
+    static constexpr std::chrono::milliseconds REBUILD_QUIET{20};
+    static constexpr std::chrono::milliseconds REBUILD_MAX_WAIT{1000};
+
+    // Edges whose overlay word was rewritten, oldest first, for consumers
+    // that derive data from costs (see changedEdges()). Positions count up
+    // from journalStart, the position of journal[0]; only the latest
+    // JOURNAL_KEEP or so are kept.
+    static const size_t JOURNAL_KEEP = 1 << 20;
+    std::vector<uint32_t> journal;
+    unsigned long long journalStart;
+
+    static uint64_t edgeKey(int u, int v) {
+        return (uint64_t(uint32_t(u)) << 32) | uint32_t(v);
+    }
+
+    // The stored ID of a caller's city ID; 0, which names no city, if it is
+    // out of int's range.
+    static int cityIndex(Id id) {
+        return id >= Id(1) && (unsigned long long)id <= (unsigned long long)INT_MAX ? int(id) : 0;
+    }
+
+    // route's overlay word, priced by the Cost policy. Route prices its own
+    // cost as TrafficCost does.
+    static uint64_t priced(Route route) {
+        if constexpr (!std::is_same<Cost, TrafficCost>::value) {
+            if (!route.isBlocked()) route.cost = Cost::effective(uint32_t(route.distance()), route.traffic());
+        }
+        return route.word();
+    }
+
+    static GraphVersion* emptyVersion(const std::shared_ptr<NameArena>& names,
+                                      const std::shared_ptr<EdgeOverlay>& overlay, unsigned long long number,
+                                      unsigned long long generation) {
+        GraphVersion* version = new GraphVersion();
+        version->names = names;
+        version->overlay = overlay;
+        version->number = number;
+        version->generation = generation;
+        return version;
+    }
+
+    int lookupCityId(std::string_view name) const {
+        auto entry = cityIds.find(name);
+        return entry == cityIds.end() ? -1 : entry->second;
+    }
+
+    int registerCity(VersionBuilder& builder, const std::string& name) {
+        GraphVersion& next = builder.version();
+        int id = next.nextCityId++;
+        std::string_view stored = names->intern(name);
+        builder.setCity(id, City(stored));
+        next.cityCount++;
+        cityIds[stored] = id;
+        components->grow(id + 1);
+        return id;
+    }
+
+    bool findEdge(int u, int v, uint32_t& edge) const {
+        auto entry = edgeIds.find(edgeKey(u, v));
+        if (entry == edgeIds.end()) {
+            return false;
+        }
+        edge = entry->second;
+        return true;
+    }
+
+    void appendRoute(VersionBuilder& builder, int u, int v, int w) {
+        uint32_t edge = overlay->append(priced(Route(v, w)));
+        builder.links(u).push_back(Link(v, edge));
+        builder.inLinks(v).push_back(Link(u, edge));
+        edgeIds[edgeKey(u, v)] = edge;
+        components->unite(u, v);
+        openings++;
+        requestRebuild();
+    }
+
+    // Writer only: the one way an existing edge's word is changed.
+    void writeRoute(uint32_t edge, const Route& route) {
+        bool wasBlocked = Route::fromWord(0, overlay->load(edge)).isBlocked();
+        if (route.isBlocked() != wasBlocked) {
+            if (route.isBlocked()) {
+                components->stale = true;
+            } else {
+                openings++;
+            }
+            requestRebuild();
+        }
+        overlay->store(edge, priced(route));
+        if (journal.size() == 2 * JOURNAL_KEEP) {
+            journal.erase(journal.begin(), journal.begin() + JOURNAL_KEEP);
+            journalStart += JOURNAL_KEEP;
+        }
+        journal.push_back(edge);
+    }
+
+    void setDistance(int v, uint32_t edge, int w) {
+        Route route = Route::fromWord(v, overlay->load(edge));
+        route.setDistance(w);
+        writeRoute(edge, route);
+    }
+
+    // Dijkstra on one pinned version, minimizing model's cost (see the cost
+    // models). Fills scratch's parents for the cities it reaches
+    // (parents[src] == src) and returns the cost to dest, or
+    // unreachableCost<Weight>() if dest is unreachable. The model is a copy
+    // so its fields stay in registers across the queue calls.
+    template <class Model>
+    static Weight search(const GraphVersion& graph, int src, int dest, WeightScratch& scratch, const Model model) {
+        static_assert(unreachableCost<uint32_t>() == Route::BLOCKED_COST, "models close routes with BLOCKED_COST");
+        const Weight infinity = unreachableCost<Weight>();
+        // City IDs are dense, so stamped arrays replace the per-query hash
+        // maps; a city not reached in this search is at infinity.
+        scratch.begin(graph.nextCityId);
+        const uint32_t stamp = scratch.stamp;
+        std::vector<uint32_t>& reached = scratch.reached;
+        std::vector<Weight>& distances = scratch.costs;
+        std::vector<int>& parents = scratch.parents;
+        Queue<Weight, int>& queue = scratch.minHeap;
+        const EdgeOverlay& costs = *graph.overlay;
+        const RouteTermsTable& terms = *graph.terms;
+        SearchProbe probe;
+
+        reached[src] = stamp;
+        distances[src] = 0;
+        parents[src] = src;
+        queue.push(0, src);
+        probe.pushed();
+
+        while (!queue.empty()) {
+            std::pair<Weight, int> current = queue.top();
+            Weight nodeDist = current.first;
+            int node = current.second;
+            queue.pop();
+            probe.popped();
+
+            if (nodeDist > distances[node]) {
+                probe.stale();
+                continue;
+            }
+            probe.settled();
+            if (node == dest) break;
+
+            // Blocked routes, and routes a model closes, cost BLOCKED_COST,
+            // which no 64-bit sum with a finite distance can bring under
+            // INT_MAX, so int labels need no branch for them here; labels
+            // that can hold BLOCKED_COST skip those routes. Models that don't
+            // read terms get the same loop as TravelModel.
+            for (const Link& link : graph.links(node)) {
+                int nbr = link.neighbor;
+                uint32_t cost;
+                if constexpr (Model::usesTerms) {
+                    uint64_t word = costs.load(link.edge);
+                    RouteTerms<uint32_t> routeTerms = terms.of(link.edge);
+                    routeTerms.distance = Route::fromWord(nbr, word).distance();
+                    cost = model.cost(uint32_t(word), routeTerms);
+                } else {
+                    cost = model.cost(costs.cost(link.edge), RouteTerms<uint32_t>());
+                }
+                if constexpr ((long double)std::numeric_limits<Weight>::max() >= Route::BLOCKED_COST) {
+                    if (cost == Route::BLOCKED_COST) continue;
+                }
+                PathCost candidate = (PathCost)nodeDist + cost;
+                probe.relaxed();
+
+                bool seen = reached[nbr] == stamp;
+                if (candidate < (seen ? distances[nbr] : infinity)) {
+                    // BasicMinHeap.push() lowers the key of a city already
+                    // queued; LazyMinHeap queues it again.
+                    if (!seen) {
+                        probe.pushed();
+                    } else {
+                        probe.decreased();
+                    }
+                    reached[nbr] = stamp;
+                    distances[nbr] = (Weight)candidate;
+                    parents[nbr] = node;
+                    queue.push(distances[nbr], nbr);
+                }
+            }
+        }
+        return reached[dest] == stamp ? distances[dest] : infinity;
+    }
+
+    // Time-dependent Dijkstra: labels are minutes since departure, and a
+    // route with a profile costs its travel time at the minute of day the
+    // search reaches it. Profiles are FIFO, so the first label settled is the
+    // earliest arrival. Fills scratch's parents like search() and returns
+    // the travel time to dest, or INT_MAX.
+    static int searchAt(const GraphVersion& graph, int src, int dest, int departure, MinuteScratch& scratch) {
+        scratch.begin(graph.nextCityId);
+        const uint32_t stamp = scratch.stamp;
+        std::vector<uint32_t>& reached = scratch.reached;
+        std::vector<int>& distances = scratch.costs;
+        std::vector<int>& parents = scratch.parents;
+        Queue<int, int>& queue = scratch.minHeap;
+        const EdgeOverlay& costs = *graph.overlay;
+        const TravelProfiles& profiles = *graph.profiles;
+
+        reached[src] = stamp;
+        distances[src] = 0;
+        parents[src] = src;
+        queue.push(0, src);
+
+        while (!queue.empty()) {
+            std::pair<int, int> current = queue.top();
+            int nodeTime = current.first;
+            int node = current.second;
+            queue.pop();
+
+            if (nodeTime > distances[node]) continue;
+            if (node == dest) break;
+
+            int minute = (int)(((long long)departure + nodeTime) % TravelProfiles::DAY_MINUTES);
+            for (const Link& link : graph.links(node)) {
+                uint32_t cost = costs.cost(link.edge);
+                int profile = profiles.profileOf(link.edge);
+                if (profile >= 0 && cost != Route::BLOCKED_COST) {
+                    cost = profiles.travelTime(profile, minute);
+                }
+                int nbr = link.neighbor;
+                long long candidate = (long long)nodeTime + cost;
+
+                if (candidate < (reached[nbr] == stamp ? distances[nbr] : INT_MAX)) {
+                    reached[nbr] = stamp;
+                    distances[nbr] = (int)candidate;
+                    parents[nbr] = node;
+                    queue.push(distances[nbr], nbr);
+                }
+            }
+        }
+        return reached[dest] == stamp ? distances[dest] : INT_MAX;
+    }
+
+    // Writer only. Points route u -> v at the (interned) profile in table,
+    // or back at its static cost if points is empty.
+    GraphStatus profileRoute(TravelProfiles& table, int u, int v, const std::vector<ProfilePoint>& points) {
+        const GraphVersion& current = versions.latest();
+        if (!current.hasCity(u) || !current.hasCity(v)) return GraphStatus::NO_SUCH_CITY;
+        uint32_t edge;
+        if (!findEdge(u, v, edge)) return GraphStatus::NO_SUCH_ROUTE;
+        if (points.empty()) {
+            table.assign(edge, -1);
+            return GraphStatus::OK;
+        }
+        GraphStatus status = TravelProfiles::check(points);
+        if (status != GraphStatus::OK) return status;
+
+        std::vector<int> key;
+        key.reserve(2 * points.size());
+        for (const ProfilePoint& point : points) {
+            key.push_back(point.minute);
+            key.push_back(point.travelTime);
+        }
+        auto interned = profileIds.find(key);
+        int profile = interned != profileIds.end() ? interned->second : table.add(points);
+        profileIds.emplace(std::move(key), profile);
+        table.assign(edge, profile);
+        return GraphStatus::OK;
+    }
+
+    // Writer only. Sets route u -> v's toll in table.
+    GraphStatus tollRoute(RouteTermsTable& table, int u, int v, int toll) {
+        const GraphVersion& current = versions.latest();
+        if (!current.hasCity(u) || !current.hasCity(v)) return GraphStatus::NO_SUCH_CITY;
+        if (toll < 0 || toll > (int)Route::MAX_DISTANCE) return GraphStatus::INVALID_TOLL;
+        uint32_t edge;
+        if (!findEdge(u, v, edge)) return GraphStatus::NO_SUCH_ROUTE;
+        table.at(edge).toll = toll;
+        return GraphStatus::OK;
+    }
+
+    // Writer only. Sets route u -> v's vehicle limits in table.
+    GraphStatus limitRoute(RouteTermsTable& table, int u, int v, int maxHeight, int maxWeight) {
+        const GraphVersion& current = versions.latest();
+        if (!current.hasCity(u) || !current.hasCity(v)) return GraphStatus::NO_SUCH_CITY;
+        if (maxHeight <= 0 || maxWeight <= 0) return GraphStatus::INVALID_LIMIT;
+        uint32_t edge;
+        if (!findEdge(u, v, edge)) return GraphStatus::NO_SUCH_ROUTE;
+        table.at(edge).maxHeight = maxHeight;
+        table.at(edge).maxWeight = maxWeight;
+        return GraphStatus::OK;
+    }
+
+    // Writer only.
+    void publishTerms(const std::shared_ptr<RouteTermsTable>& table) {
+        VersionBuilder builder(versions.latest());
+        builder.version().terms = table;
+        publish(builder);
+    }
+
+    // Fills in a found result from a search's parents (parents[src] == src).
+    static void trace(Path& result, const std::vector<int>& parents, PathCost cost) {
+        int src = int(result.src);
+        for (int node = int(result.dest); node != src; node = parents[node]) {
+            result.nodes.push_back(node);
+        }
+        result.nodes.push_back(src);
+        std::reverse(result.nodes.begin(), result.nodes.end());
+        result.cost = cost;
+        result.hops = result.nodes.size() - 1;
+    }
+
+    // Validates a src -> dest query. Any status but FOUND is the final answer
+    // (SAME_CITY already carries its one-city path), and FOUND means both
+    // IDs are stored IDs. Pairs in different components get NO_PATH without
+    // a search.
+    Path checkQuery(const GraphVersion& graph, Id srcId, Id destId) const {
+        Path result(PathStatus::FOUND, srcId, destId);
+        int src = cityIndex(srcId), dest = cityIndex(destId);
+        if (graph.cityCount == 0) {
+            result.status = PathStatus::EMPTY_GRAPH;
+        } else if (!graph.hasCity(src)) {
+            result.status = PathStatus::INVALID_SOURCE;
+        } else if (!graph.hasCity(dest)) {
+            result.status = PathStatus::INVALID_DESTINATION;
+        } else if (src == dest) {
+            result.status = PathStatus::SAME_CITY;
+            result.cost = 0;
+            result.nodes.push_back(srcId);
+        } else {
+            std::shared_ptr<ComponentIndex> index = std::atomic_load(&components);
+            if (index->generation == graph.generation && index->find(src) != index->find(dest)) {
+                result.status = PathStatus::NO_PATH;
+            } else {
+                std::shared_ptr<const ReachabilityIndex> directed = reachabilityIndex();
+                if (directed && directed->generation == graph.generation && src < (int)directed->component.size() &&
+                    dest < (int)directed->component.size() && !directed->mayReach(src, dest)) {
+                    result.status = PathStatus::NO_PATH;
+                }
+            }
+        }
+        return result;
+    }
+
+    // Writer only.
+    void requestRebuild() {
+        std::lock_guard<std::mutex> lock(rebuildLock);
+        if (rebuildPending) return;
+        rebuildPending = true;
+        if (!rebuilder.joinable()) {
+            rebuilder = std::thread([this] { rebuildReachability(); });
+        }
+        rebuildWanted.notify_one();
+    }
+
+    // Background thread body: rebuilds the reachability index after
+    // requests, until the graph is destroyed.
+    void rebuildReachability() {
+        std::unique_lock<std::mutex> lock(rebuildLock);
+        while (true) {
+            rebuildWanted.wait(lock, [this] { return stopping || rebuildPending; });
+            auto deadline = std::chrono::steady_clock::now() + REBUILD_MAX_WAIT;
+            do {
+                rebuildPending = false;
+            } while (!stopping && std::chrono::steady_clock::now() < deadline &&
+                     rebuildWanted.wait_for(lock, REBUILD_QUIET, [this] { return stopping || rebuildPending; }));
+            if (stopping) return;
+            lock.unlock();
+
+            // Writers count an opening before publishing the route, so the
+            // count and the version are read together.
+            std::unique_lock<std::mutex> write(writeLock);
+            unsigned long long opened = openings.load();
+            ReadGuard graph = snapshot();
+            write.unlock();
+            int workers = std::max(1u, std::thread::hardware_concurrency());
+            std::shared_ptr<const ReachabilityIndex> index = ReachabilityIndex::build(*graph, opened, workers);
+            std::atomic_store(&reachability, index);
+            lock.lock();
+        }
+    }
+
+    // Called when a search found no path that checkQuery() did not rule
+    // out. If blocking may have split components since the index was built,
+    // rebuilds it from the open routes so the next such query is answered
+    // without a search. Queries never wait for writers: if one holds the
+    // lock, a later query does the rebuild.
+    void refreshComponents() const {
+        std::unique_lock<std::mutex> lock(writeLock, std::try_to_lock);
+        if (!lock.owns_lock() || !components->stale) return;
+        const GraphVersion& current = versions.latest();
+        std::shared_ptr<ComponentIndex> fresh = std::make_shared<ComponentIndex>(generation);
+        fresh->grow(current.nextCityId);
+        for (int city = 1; city < current.nextCityId; city++) {
+            if (!current.hasCity(city)) continue;
+            for (const Link& link : current.links(city)) {
+                if (overlay->cost(link.edge) != Route::BLOCKED_COST) fresh->unite(city, link.neighbor);
+            }
+        }
+        std::atomic_store(&components, fresh);
+    }
+
+    // Shortest-path tree grown by Dijkstra from root, over links, or over
+    // inLinks for a backward tree (whose costs are then towards root). Once
+    // target is settled the search goes on only up to stretch times its
+    // cost. Settled cities know their exact cost and their parent (in a
+    // backward tree, the next hop towards root); every other city is at least
+    // radius away, so a backward tree's estimate() is a consistent A* bound
+    // for searches towards root on the same version.
+    class PathTree {
+    public:
+        std::vector<int> settled;  // exact cost, or INT_MAX if not settled
+        std::vector<int> parents;
+        std::vector<int> order;    // settled cities, cheapest first
+        int radius;
+        bool exhausted;       // every city connected to root is settled
+
+        void build(const GraphVersion& graph, int root, bool backward, int target, double stretch) {
+            settled.assign(graph.nextCityId, INT_MAX);
+            parents.assign(graph.nextCityId, -1);
+            order.clear();
+            std::vector<int> distances(graph.nextCityId, INT_MAX);
+            const EdgeOverlay& costs = *graph.overlay;
+            MinHeap minHeap;
+            long long stop = LLONG_MAX;
+
+            distances[root] = 0;
+            minHeap.push(0, root);
+            radius = 0;
+            exhausted = false;
+            while (true) {
+                if (minHeap.empty()) {
+                    exhausted = true;
+                    return;
+                }
+                std::pair<int, int> current = minHeap.top();
+                if (current.first > stop) return;
+                minHeap.pop();
+                int node = current.second;
+                radius = current.first;
+                settled[node] = current.first;
+                order.push_back(node);
+                if (node == target) {
+                    stop = (long long)(current.first * stretch);
+                }
+
+                for (const Link& link : backward ? graph.inLinks(node) : graph.links(node)) {
+                    int nbr = link.neighbor;
+                    long long candidate = (long long)current.first + costs.cost(link.edge);
+                    if (candidate < distances[nbr]) {
+                        distances[nbr] = (int)candidate;
+                        parents[nbr] = node;
+                        minHeap.push(distances[nbr], nbr);
+                    }
+                }
+            }
+        }
+
+        // Lower bound on node's cost to or from root; INT_MAX if there is no
+        // route at all.
+        int estimate(int node) const {
+            if (settled[node] != INT_MAX) return settled[node];
+            return exhausted ? INT_MAX : radius;
+        }
+    };
+
+    // A loopless path with the cost of each of its prefixes; deviation is
+    // the index it branched off its parent at (Lawler's refinement of Yen:
+    // spurs before it were already tried for the parent).
+    class RankedPath {
+    public:
+        std::vector<int> nodes;
+        std::vector<int> prefix;
+        int deviation;
+
+        RankedPath() : deviation(0) {}
+    };
+
+    // Per-thread scratch for kShortestPaths' spur searches.
+    class SpurSearch : public SearchScratch {
+    public:
+
+        // Cheapest path from base.nodes[spur] to dest that avoids the cities
+        // before the spur and the first hops in removed, as long as it costs
+        // at most limit. Appends it (spur city first) and its costs to
+        // path.nodes and path.prefix.
+        bool run(const GraphVersion& graph, const PathTree& tree, const RankedPath& base, int spur,
+                 const std::vector<int>& removed, long long limit, RankedPath& path) {
+            int start = base.nodes[spur];
+            int dest = base.nodes.back();
+            int rootCost = base.prefix[spur];
+            limit = std::min(limit - rootCost, (long long)INT_MAX - 1);
+            if (tree.estimate(start) > limit) return false;
+            begin(graph.nextCityId);
+            for (int i = 0; i < spur; i++) {
+                banned[base.nodes[i]] = stamp;
+            }
+
+            // The unconstrained shortest path from the spur is the answer
+            // when it avoids the banned cities and removed hops.
+            if (tree.settled[start] != INT_MAX &&
+                std::find(removed.begin(), removed.end(), tree.parents[start]) == removed.end()) {
+                bool clear = true;
+                for (int node = tree.parents[start]; node != -1 && clear; node = tree.parents[node]) {
+                    clear = banned[node] != stamp;
+                }
+                if (clear) {
+                    for (int node = start; node != -1; node = tree.parents[node]) {
+                        path.nodes.push_back(node);
+                        path.prefix.push_back(rootCost + tree.settled[start] - tree.settled[node]);
+                    }
+                    return true;
+                }
+            }
+
+            const EdgeOverlay& edgeCosts = *graph.overlay;
+            reached[start] = stamp;
+            costs[start] = 0;
+            parents[start] = -1;
+            minHeap.push(tree.estimate(start), start);
+            while (!minHeap.empty()) {
+                int node = minHeap.top().second;
+                minHeap.pop();
+                if (node == dest) {
+                    size_t first = path.nodes.size();
+                    for (int at = dest; at != -1; at = parents[at]) {
+                        path.nodes.push_back(at);
+                        path.prefix.push_back(rootCost + costs[at]);
+                    }
+                    std::reverse(path.nodes.begin() + first, path.nodes.end());
+                    std::reverse(path.prefix.begin() + first, path.prefix.end());
+                    return true;
+                }
+
+                for (const Link& link : graph.links(node)) {
+                    int nbr = link.neighbor;
+                    if (banned[nbr] == stamp) continue;
+                    if (node == start && std::find(removed.begin(), removed.end(), nbr) != removed.end()) continue;
+                    long long candidate = (long long)costs[node] + edgeCosts.cost(link.edge);
+                    if (reached[nbr] == stamp && candidate >= costs[nbr]) continue;
+                    int estimate = tree.estimate(nbr);
+                    if (estimate == INT_MAX || candidate + estimate > limit) continue;
+                    reached[nbr] = stamp;
+                    costs[nbr] = (int)candidate;
+                    parents[nbr] = node;
+                    minHeap.push((int)candidate + estimate, nbr);
+                }
+            }
+            return false;
+        }
+    };
+
+    // A run of forward tree edges that are also backward tree edges: every
+    // city on it is on the cheapest route through any other, so a route via
+    // a plateau is a shortest path along all of it.
+    class Plateau {
+    public:
+        int start;
+        int end;
+        int length;
+        long long cost;   // of the route src -> start -> end -> dest
+
+        Plateau(int start, int end, int length, long long cost)
+            : start(start), end(end), length(length), cost(cost) {}
+    };
+
+    // Spur searches only go parallel on graphs where one costs more than
+    // starting a thread.
+    static const int PARALLEL_SPUR_CITIES = 1 << 14;
+
+    // Writer only. Adds route u -> v, and v -> u unless direction (one-way)
+    // is set, to builder, or updates the distance of routes that already
+    // exist. Returns true if u -> v already existed.
+    bool connectCities(VersionBuilder& builder, int u, int v, int w, bool direction) {
+        uint32_t edge = 0, reverseEdge = 0;
+        bool hasReverse = findEdge(v, u, reverseEdge);
+
+        if (findEdge(u, v, edge)) {
+            setDistance(u, edge, w);
+            if (!direction && hasReverse) {
+                setDistance(v, reverseEdge, w);
+            }
+            changes++;
+            return true;
+        }
+
+        appendRoute(builder, u, v, w);
+        if (!direction) {
+            if (hasReverse) {
+                setDistance(v, reverseEdge, w);
+            } else {
+                appendRoute(builder, v, u, w);
+            }
+        }
+        return false;
+    }
+
+    static GraphStatus checkRoute(const GraphVersion& current, int u, int v, int w) {
+        if (!current.hasCity(u)) return GraphStatus::NO_SOURCE;
+        if (!current.hasCity(v)) return GraphStatus::NO_DESTINATION;
+        if (u == v) return GraphStatus::SAME_CITY;
+        if (w <= 0) return GraphStatus::INVALID_DISTANCE;
+        if (w > (int)Route::MAX_DISTANCE) return GraphStatus::DISTANCE_TOO_LARGE;
+        return GraphStatus::OK;
+    }
+
+    GraphStatus setBlocked(int u, int v, bool blocked) {
+        static_assert(Block::enabled, "this graph's routes cannot be blocked");
+        std::lock_guard<std::mutex> lock(writeLock);
+        const GraphVersion& current = versions.latest();
+        if (!current.hasCity(u) || !current.hasCity(v)) return GraphStatus::NO_SUCH_CITY;
+
+        uint32_t edge;
+        if (!findEdge(u, v, edge)) return GraphStatus::NO_SUCH_ROUTE;
+
+        Route route = Route::fromWord(v, overlay->load(edge));
+        if (route.isBlocked() == blocked) {
+            return blocked ? GraphStatus::ALREADY_BLOCKED : GraphStatus::ALREADY_OPEN;
+        }
+        route.setBlocked(blocked);
+        if (!blocked) components->unite(u, v);
+        writeRoute(edge, route);
+        changes++;
+        return GraphStatus::OK;
+    }
+
+    // kShortestPaths() on one version.
+    std::vector<Path> rankPaths(const GraphVersion& graph, Id srcId, Id destId, int k) const {
+        std::vector<Path> results;
+        if (k <= 0) {
+            return results;
+        }
+        Path first = checkQuery(graph, srcId, destId);
+        if (first.status != PathStatus::FOUND) {
+            results.push_back(first);
+            return results;
+        }
+        int src = int(srcId), dest = int(destId);
+
+        // One backward search gives the first path and the A* bound that
+        // keeps every spur search near the corridor between src and dest.
+        // (Growing the tree past src would tighten the bounds, but costs more
+        // than it saves.)
+        PathTree tree;
+        tree.build(graph, dest, true, src, 1.0);
+        if (tree.settled[src] == INT_MAX) {
+            first.status = PathStatus::NO_PATH;
+            results.push_back(first);
+            refreshComponents();
+            return results;
+        }
+
+        std::vector<RankedPath> accepted(1);
+        for (int node = src; node != -1; node = tree.parents[node]) {
+            accepted[0].nodes.push_back(node);
+            accepted[0].prefix.push_back(tree.settled[src] - tree.settled[node]);
+        }
+        // Only the cheapest k - accepted candidates can still be accepted,
+        // so the list is trimmed to that and its last cost bounds new spurs.
+        std::multimap<int, RankedPath> candidates;
+        std::set<std::vector<int>> seen;
+        seen.insert(accepted[0].nodes);
+
+        int workers = graph.nextCityId >= PARALLEL_SPUR_CITIES ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+        std::vector<SpurSearch> searches(workers);
+        while ((int)accepted.size() < k) {
+            const RankedPath& base = accepted.back();
+            size_t wanted = k - accepted.size();
+            long long limit = candidates.size() >= wanted ? std::prev(candidates.end())->first : LLONG_MAX;
+
+            int spurs = base.nodes.size() - 1 - base.deviation;
+            std::vector<RankedPath> found(spurs);
+            std::vector<char> ok(spurs, 0);
+            parallelFor(spurs, workers, [&](int worker, int index) {
+                int spur = base.deviation + index;
+                // Hops already taken from this root by accepted paths.
+                std::vector<int> removed;
+                for (const RankedPath& path : accepted) {
+                    if ((int)path.nodes.size() > spur + 1 &&
+                        std::equal(base.nodes.begin(), base.nodes.begin() + spur + 1, path.nodes.begin())) {
+                        removed.push_back(path.nodes[spur + 1]);
+                    }
+                }
+                RankedPath& path = found[index];
+                path.nodes.assign(base.nodes.begin(), base.nodes.begin() + spur);
+                path.prefix.assign(base.prefix.begin(), base.prefix.begin() + spur);
+                path.deviation = spur;
+                ok[index] = searches[worker].run(graph, tree, base, spur, removed, limit, path);
+            });
+
+            // Merged in spur order, so the ranking does not depend on threads.
+            for (int index = 0; index < spurs; index++) {
+                if (!ok[index] || !seen.insert(found[index].nodes).second) continue;
+                int cost = found[index].prefix.back();
+                candidates.emplace(cost, std::move(found[index]));
+                if (candidates.size() > wanted) {
+                    candidates.erase(std::prev(candidates.end()));
+                }
+            }
+            if (candidates.empty()) break;
+            accepted.push_back(std::move(candidates.begin()->second));
+            candidates.erase(candidates.begin());
+        }
+
+        for (RankedPath& path : accepted) {
+            Path result(PathStatus::FOUND, srcId, destId);
+            result.cost = path.prefix.back();
+            result.hops = path.nodes.size() - 1;
+            result.nodes.assign(path.nodes.begin(), path.nodes.end());
+            results.push_back(std::move(result));
+        }
+        return results;
+    }
+
+    // alternativeRoutes() on one version.
+    std::vector<Path> plateauRoutes(const GraphVersion& graph, Id srcId, Id destId, int count) const {
+        std::vector<Path> results;
+        if (count <= 0) {
+            return results;
+        }
+        Path first = checkQuery(graph, srcId, destId);
+        if (first.status != PathStatus::FOUND) {
+            results.push_back(first);
+            return results;
+        }
+        int src = int(srcId), dest = int(destId);
+
+        // Both trees stop at the stretch bound; no city beyond it can be on
+        // an acceptable route.
+        PathTree forward, backward;
+        forward.build(graph, src, false, dest, ALT_MAX_STRETCH);
+        if (forward.settled[dest] == INT_MAX) {
+            first.status = PathStatus::NO_PATH;
+            results.push_back(first);
+            refreshComponents();
+            return results;
+        }
+        backward.build(graph, dest, true, src, ALT_MAX_STRETCH);
+        long long shortest = forward.settled[dest];
+        long long maxCost = (long long)(shortest * ALT_MAX_STRETCH);
+        long long minLength = (long long)(shortest * ALT_MIN_PLATEAU);
+        long long maxShared = (long long)(shortest * ALT_MAX_SHARING);
+
+        // Cities come in forward order, so a plateau's start is known by the
+        // time each of its cities is seen; a plateau is recorded at its end.
+        std::vector<int> plateauStart(graph.nextCityId, -1);
+        std::vector<Plateau> plateaus;
+        for (int node : forward.order) {
+            if (backward.settled[node] == INT_MAX) continue;
+            long long cost = (long long)forward.settled[node] + backward.settled[node];
+            if (cost > maxCost) continue;
+            int before = forward.parents[node];
+            bool continues = before != -1 && plateauStart[before] != -1 && backward.parents[before] == node;
+            plateauStart[node] = continues ? plateauStart[before] : node;
+
+            int after = backward.parents[node];
+            if (after != -1 && forward.settled[after] != INT_MAX && forward.parents[after] == node) continue;
+            int length = forward.settled[node] - forward.settled[plateauStart[node]];
+            if (length >= minLength) {
+                plateaus.push_back(Plateau(plateauStart[node], node, length, cost));
+            }
+        }
+        // Least detour off the plateau first.
+        std::sort(plateaus.begin(), plateaus.end(), [](const Plateau& a, const Plateau& b) {
+            long long detourA = a.cost - a.length, detourB = b.cost - b.length;
+            return detourA != detourB ? detourA < detourB : a.cost < b.cost;
+        });
+
+        // Each route runs src -> end down the forward tree, then on to dest
+        // up the backward one; the shortest route ends at dest itself.
+        std::unordered_set<uint64_t> used;
+        std::vector<char> onRoute(graph.nextCityId, 0);
+        std::vector<int> nodes, prefix;
+        auto trace = [&](int end, long long cost) {
+            nodes.clear();
+            prefix.clear();
+            for (int node = end; node != -1; node = forward.parents[node]) {
+                nodes.push_back(node);
+                prefix.push_back(forward.settled[node]);
+            }
+            std::reverse(nodes.begin(), nodes.end());
+            std::reverse(prefix.begin(), prefix.end());
+            for (int node = backward.parents[end]; node != -1; node = backward.parents[node]) {
+                nodes.push_back(node);
+                prefix.push_back(cost - backward.settled[node]);
+            }
+        };
+        auto accept = [&](long long cost) {
+            for (size_t i = 1; i < nodes.size(); i++) {
+                used.insert(edgeKey(nodes[i - 1], nodes[i]));
+            }
+            Path result(PathStatus::FOUND, srcId, destId);
+            result.cost = cost;
+            result.hops = nodes.size() - 1;
+            result.nodes.assign(nodes.begin(), nodes.end());
+            results.push_back(std::move(result));
+        };
+
+        trace(dest, shortest);
+        accept(shortest);
+        for (const Plateau& plateau : plateaus) {
+            if ((int)results.size() == count) break;
+            trace(plateau.end, plateau.cost);
+
+            bool loopless = true;
+            long long shared = 0;
+            for (size_t i = 0; i < nodes.size(); i++) {
+                loopless = loopless && !onRoute[nodes[i]];
+                onRoute[nodes[i]] = 1;
+                if (i > 0 && used.count(edgeKey(nodes[i - 1], nodes[i]))) {
+                    shared += prefix[i] - prefix[i - 1];
+                }
+            }
+            for (int node : nodes) onRoute[node] = 0;
+            if (loopless && shared <= maxShared) {
+                accept(plateau.cost);
+            }
+        }
+        return results;
+    }
+
+    // Runs query so that it reads the overlay between traffic batches: if a
+    // batch was stored while it ran it is run again, and after BATCH_RETRIES
+    // collisions it runs holding off batches instead.
+    template <class Query>
+    auto wholeBatches(const Query& query) const -> decltype(query()) {
+        for (int attempt = 0; attempt < BATCH_RETRIES; attempt++) {
+            unsigned long long before = batchSequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            auto result = query();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (batchSequence.load(std::memory_order_relaxed) == before) {
+                return result;
+            }
+        }
+        std::shared_lock<std::shared_mutex> hold(batchLock);
+        return query();
+    }
+
+    void publish(VersionBuilder& builder) {
+        versions.publish(builder.release());
+        changes++;
+    }
+
+public:
+    BasicGraph() : names(std::make_shared<NameArena>()), overlay(std::make_shared<EdgeOverlay>()), generation(0),
+              versions(emptyVersion(names, overlay, 0, generation)), changes(0), batchSequence(0),
+              components(std::make_shared<ComponentIndex>(generation)), openings(0), rebuildPending(false),
+              stopping(false), journalStart(0) {}
+
+    ~BasicGraph() {
+        {
+            std::lock_guard<std::mutex> lock(rebuildLock);
+            stopping = true;
+        }
+        rebuildWanted.notify_one();
+        if (rebuilder.joinable()) {
+            rebuilder.join();
+        }
+    }
+
+    // The reachability index queries use right now, or null while a rebuild
+    // is due after routes were added or opened.
+    std::shared_ptr<const ReachabilityIndex> reachabilityIndex() const {
+        std::shared_ptr<const ReachabilityIndex> index = std::atomic_load(&reachability);
+        if (!index || index->openings != openings.load()) return nullptr;
+        return index;
+    }
+
+    // Pins the current version for a read-only query.
+    ReadGuard snapshot() const {
+        return versions.pin();
+    }
+
+    // Moves forward once per successful mutation, and once per traffic batch.
+    unsigned long long getVersion() const {
+        return changes.load();
+    }
+
+    int cityCount() const {
+        return snapshot()->cityCount;
+    }
+
+    // Journal position after the latest edge change.
+    unsigned long long changeCursor() const {
+        std::lock_guard<std::mutex> lock(writeLock);
+        return journalStart + journal.size();
+    }
+
+    // Appends the edges changed since cursor (duplicates included) and moves
+    // cursor past them. Returns false, with cursor moved to the end, if the
+    // changes since cursor are no longer all in the journal. edgeCount is set
+    // to the number of edges in the overlay at the same moment, so every
+    // appended edge is below it.
+    bool changedEdges(unsigned long long& cursor, std::vector<uint32_t>& edges, uint32_t& edgeCount) const {
+        std::lock_guard<std::mutex> lock(writeLock);
+        edgeCount = overlay->size();
+        unsigned long long end = journalStart + journal.size();
+        bool complete = cursor >= journalStart;
+        if (complete) {
+            edges.insert(edges.end(), journal.begin() + (cursor - journalStart), journal.end());
+        }
+        cursor = end;
+        return complete;
+    }
+
+    // ID of the city with this exact name, or Id(-1). This reads the
+    // writer-side index, so unlike the queries it takes the write lock.
+    Id findCityId(std::string_view name) const {
+        std::lock_guard<std::mutex> lock(writeLock);
+        return Id(lookupCityId(name));
+    }
+
+    // Bulk import without per-city output, published as one version.
+    // Returns one ID per input name; empty and duplicate names (within the
+    // batch too) get -1.
+    std::vector<int> addCities(const std::vector<std::string>& cityNames) {
+        std::lock_guard<std::mutex> lock(writeLock);
+        VersionBuilder builder(versions.latest());
+        std::vector<int> ids;
+        ids.reserve(cityNames.size());
+        cityIds.reserve(cityIds.size() + cityNames.size());
+        for (const std::string& name : cityNames) {
+            if (name.empty() || lookupCityId(name) != -1) {
+                ids.push_back(-1);
+            } else {
+                ids.push_back(registerCity(builder, name));
+            }
+        }
+        publish(builder);
+        return ids;
+    }
+
+    // On DUPLICATE_NAME, id is set to the existing city's ID.
+    GraphStatus addCity(const std::string& name, Id* id = nullptr) {
+        if (name.empty()) {
+            return GraphStatus::EMPTY_NAME;
+        }
+
+        std::lock_guard<std::mutex> lock(writeLock);
+        int existing = lookupCityId(name);
+        if (existing != -1) {
+            if (id != nullptr) *id = existing;
+            return GraphStatus::DUPLICATE_NAME;
+        }
+
+        VersionBuilder builder(versions.latest());
+        int added = registerCity(builder, name);
+        publish(builder);
+        if (id != nullptr) *id = added;
+        return GraphStatus::OK;
+    }
+
+    // ROUTE_UPDATED means u -> v already existed and its distance (and that
+    // of v -> u for a two-way route) was changed instead.
+    GraphStatus addEdge(Id u, Id v, int w, bool direction) {
+        std::lock_guard<std::mutex> lock(writeLock);
+        const GraphVersion& current = versions.latest();
+        int from = cityIndex(u), to = cityIndex(v);
+        GraphStatus status = checkRoute(current, from, to, w);
+        if (status != GraphStatus::OK) return status;
+
+        VersionBuilder builder(current);
+        if (connectCities(builder, from, to, w, direction)) return GraphStatus::ROUTE_UPDATED;
+        publish(builder);
+        return GraphStatus::OK;
+    }
+
+    // Bulk import without per-route output, published as one version. Each
+    // route is added or updated as addEdge would; invalid ones are skipped.
+    // Returns how many were applied.
+    int addRoutes(const std::vector<NewRoute>& routes) {
+        std::lock_guard<std::mutex> lock(writeLock);
+        const GraphVersion& current = versions.latest();
+        VersionBuilder builder(current);
+        int applied = 0;
+        for (const NewRoute& route : routes) {
+            if (checkRoute(current, route.from, route.to, route.distance) != GraphStatus::OK) continue;
+            connectCities(builder, route.from, route.to, route.distance, route.oneWay);
+            applied++;
+        }
+        publish(builder);
+        return applied;
+    }
+
+    GraphStatus blockRoute(Id u, Id v) {
+        return setBlocked(cityIndex(u), cityIndex(v), true);
+    }
+
+    GraphStatus unblockRoute(Id u, Id v) {
+        return setBlocked(cityIndex(u), cityIndex(v), false);
+    }
+
+    // With Blocking, levels 8-10 also block the route (AUTO_BLOCKED if it was
+    // open); a lower level leaves a blocked route blocked (STILL_BLOCKED).
+    GraphStatus setTraffic(Id from, Id to, int trafficLevel) {
+        static_assert(Cost::usesTraffic, "this graph's cost policy has no traffic");
+        int u = cityIndex(from), v = cityIndex(to);
+        std::lock_guard<std::mutex> lock(writeLock);
+        const GraphVersion& current = versions.latest();
+        if (!current.hasCity(u) || !current.hasCity(v)) return GraphStatus::NO_SUCH_CITY;
+        if (trafficLevel < 0 || trafficLevel > 10) return GraphStatus::INVALID_TRAFFIC;
+
+        uint32_t edge;
+        if (!findEdge(u, v, edge)) return GraphStatus::NO_SUCH_ROUTE;
+
+        Route route = Route::fromWord(v, overlay->load(edge));
+        bool wasBlocked = route.isBlocked();
+        route.setTraffic(trafficLevel);
+        if (Block::enabled && trafficLevel >= 8) {
+            route.setBlocked(true);
+        }
+        writeRoute(edge, route);
+        changes++;
+
+        if (Block::enabled && trafficLevel >= 8 && !wasBlocked) return GraphStatus::AUTO_BLOCKED;
+        if (trafficLevel < 8 && wasBlocked) return GraphStatus::STILL_BLOCKED;
+        return GraphStatus::OK;
+    }
+
+    // Name of the city with this ID, or "" if there is none.
+    std::string cityName(Id id) const {
+        ReadGuard graph = snapshot();
+        int city = cityIndex(id);
+        return graph->hasCity(city) ? std::string(graph->city(city).name) : std::string();
+    }
+
+    // Cheapest route by model's cost: the effective cost with traffic by
+    // default, or DistanceModel, TollModel<uint32_t> or TruckModel (tolls and
+    // limits are set with setToll and setLimits). result.cost is in the
+    // model's units.
+    template <class Model = TravelModel>
+    Path dijkstra(Id src, Id dest, const Model& model = Model()) const {
+        ReadGuard graph = snapshot();
+        Path result = checkQuery(*graph, src, dest);
+        if (result.status != PathStatus::FOUND) {
+            return result;
+        }
+
+        BasicScratchLease<WeightScratch> lease;
+        WeightScratch& scratch = *lease;
+        Weight cost = wholeBatches([&] { return search(*graph, int(src), int(dest), scratch, model); });
+        if (!(cost < unreachableCost<Weight>())) {
+            result.status = PathStatus::NO_PATH;
+            refreshComponents();
+            return result;
+        }
+
+        trace(result, scratch.parents, cost);
+        return result;
+    }
+
+    // Every city reachable from src within budget (effective cost, as
+    // dijkstra() counts it), passed to onCity as it is settled, cheapest
+    // first; onCity returns false to stop there. After the last city, the
+    // routes leaving the reached area go to onFrontier. Returns FOUND, or the
+    // error before anything was passed on. What has been passed on can't be
+    // taken back, so unlike the Isochrone form this one can see a traffic
+    // batch that lands mid-stream edge by edge.
+    PathStatus reachableWithin(int src, int budget, const std::function<bool(const ReachedCity&)>& onCity,
+                               const std::function<void(const FrontierRoute&)>& onFrontier) const {
+        ReadGuard graph = snapshot();
+        if (graph->cityCount == 0) return PathStatus::EMPTY_GRAPH;
+        if (!graph->hasCity(src)) return PathStatus::INVALID_SOURCE;
+        if (budget < 0) return PathStatus::INVALID_BUDGET;
+
+        // Same relaxation as search(), pruned at the budget instead of at a
+        // destination, on scratch arrays so a small area on a large graph
+        // costs only what it reaches. Routes that overshoot the budget are
+        // kept as frontier candidates until it is known whether their far
+        // end was reached.
+        //
+        // A PHAST-style sweep (the upward search, then one pass down the CH
+        // order) would beat this on budgets that reach most of the graph, and
+        // is still deferred: the only CH order here is HubLabels', which is
+        // frozen at the snapshot it was built from and keeps no downward
+        // arcs, while this answers the live overlay costs. Large budgets run
+        // this plain search, single-threaded.
+        ScratchLease lease;
+        SearchScratch& scratch = *lease;
+        scratch.begin(graph->nextCityId);
+        const EdgeOverlay& costs = *graph->overlay;
+        std::vector<FrontierRoute> overshoots;
+
+        scratch.reached[src] = scratch.stamp;
+        scratch.costs[src] = 0;
+        scratch.parents[src] = src;
+        scratch.minHeap.push(0, src);
+        while (!scratch.minHeap.empty()) {
+            std::pair<int, int> current = scratch.minHeap.top();
+            int nodeDist = current.first;
+            int node = current.second;
+            scratch.minHeap.pop();
+
+            if (!onCity(ReachedCity(node, nodeDist, scratch.parents[node]))) return PathStatus::FOUND;
+
+            for (const Link& link : graph->links(node)) {
+                uint32_t cost = costs.cost(link.edge);
+                if (cost == Route::BLOCKED_COST) continue;
+                int nbr = link.neighbor;
+                long long candidate = (long long)nodeDist + cost;
+                if (candidate > budget) {
+                    overshoots.push_back(FrontierRoute(node, nbr, budget - nodeDist, cost));
+                } else if (scratch.reached[nbr] != scratch.stamp || candidate < scratch.costs[nbr]) {
+                    scratch.reached[nbr] = scratch.stamp;
+                    scratch.costs[nbr] = (int)candidate;
+                    scratch.parents[nbr] = node;
+                    scratch.minHeap.push(scratch.costs[nbr], nbr);
+                }
+            }
+        }
+
+        for (const FrontierRoute& route : overshoots) {
+            if (scratch.reached[route.to] != scratch.stamp) onFrontier(route);
+        }
+        return PathStatus::FOUND;
+    }
+
+    Isochrone reachableWithin(int src, int budget) const {
+        return wholeBatches([&] {
+            Isochrone result(PathStatus::FOUND, src, budget);
+            result.status = reachableWithin(
+                src, budget,
+                [&](const ReachedCity& city) {
+                    result.cities.push_back(city);
+                    return true;
+                },
+                [&](const FrontierRoute& route) { result.frontier.push_back(route); });
+            return result;
+        });
+    }
+
+    // Gives route u -> v a travel-time profile by time of day, used by
+    // dijkstraAt() in place of its distance and traffic (blocking still
+    // applies); an empty profile removes it. Profiles are published as a new
+    // version.
+    GraphStatus setProfile(Id u, Id v, const std::vector<ProfilePoint>& points) {
+        std::lock_guard<std::mutex> lock(writeLock);
+        const GraphVersion& current = versions.latest();
+        std::shared_ptr<TravelProfiles> table = std::make_shared<TravelProfiles>(*current.profiles);
+        GraphStatus status = profileRoute(*table, cityIndex(u), cityIndex(v), points);
+        if (status == GraphStatus::OK) {
+            VersionBuilder builder(current);
+            builder.version().profiles = table;
+            publish(builder);
+        }
+        return status;
+    }
+
+    // Bulk setProfile, published as one version. Invalid entries are
+    // skipped; returns how many were applied.
+    int setProfiles(const std::vector<RouteProfile>& routes) {
+        std::lock_guard<std::mutex> lock(writeLock);
+        const GraphVersion& current = versions.latest();
+        std::shared_ptr<TravelProfiles> table = std::make_shared<TravelProfiles>(*current.profiles);
+        int applied = 0;
+        for (const RouteProfile& route : routes) {
+            if (profileRoute(*table, route.from, route.to, route.points) == GraphStatus::OK) applied++;
+        }
+        VersionBuilder builder(current);
+        builder.version().profiles = table;
+        publish(builder);
+        return applied;
+    }
+
+    // The toll on route u -> v (0 to Route::MAX_DISTANCE), for TollModel
+    // queries. Tolls and limits are published as a new version.
+    GraphStatus setToll(Id u, Id v, int toll) {
+        std::lock_guard<std::mutex> lock(writeLock);
+        std::shared_ptr<RouteTermsTable> table = std::make_shared<RouteTermsTable>(*versions.latest().terms);
+        GraphStatus status = tollRoute(*table, cityIndex(u), cityIndex(v), toll);
+        if (status == GraphStatus::OK) publishTerms(table);
+        return status;
+    }
+
+    // Bulk setToll, published as one version. Invalid entries are skipped;
+    // returns how many were applied.
+    int setTolls(const std::vector<RouteToll>& routes) {
+        std::lock_guard<std::mutex> lock(writeLock);
+        std::shared_ptr<RouteTermsTable> table = std::make_shared<RouteTermsTable>(*versions.latest().terms);
+        int applied = 0;
+        for (const RouteToll& route : routes) {
+            if (tollRoute(*table, route.from, route.to, route.toll) == GraphStatus::OK) applied++;
+        }
+        publishTerms(table);
+        return applied;
+    }
+
+    // The tallest (centimetres) and heaviest (kilograms) vehicle route u -> v
+    // takes, for TruckModel queries.
+    GraphStatus setLimits(Id u, Id v, int maxHeight, int maxWeight) {
+        std::lock_guard<std::mutex> lock(writeLock);
+        std::shared_ptr<RouteTermsTable> table = std::make_shared<RouteTermsTable>(*versions.latest().terms);
+        GraphStatus status = limitRoute(*table, cityIndex(u), cityIndex(v), maxHeight, maxWeight);
+        if (status == GraphStatus::OK) publishTerms(table);
+        return status;
+    }
+
+    // Bulk setLimits, as setTolls.
+    int setLimits(const std::vector<RouteLimits>& routes) {
+        std::lock_guard<std::mutex> lock(writeLock);
+        std::shared_ptr<RouteTermsTable> table = std::make_shared<RouteTermsTable>(*versions.latest().terms);
+        int applied = 0;
+        for (const RouteLimits& route : routes) {
+            if (limitRoute(*table, route.from, route.to, route.maxHeight, route.maxWeight) == GraphStatus::OK) {
+                applied++;
+            }
+        }
+        publishTerms(table);
+        return applied;
+    }
+
+    // Earliest arrival leaving src at departure (minute of the day, 0-1439):
+    // result.cost is the travel time in minutes.
+    Path dijkstraAt(Id src, Id dest, int departure) const {
+        ReadGuard graph = snapshot();
+        Path result = checkQuery(*graph, src, dest);
+        if (result.status == PathStatus::FOUND || result.status == PathStatus::SAME_CITY ||
+            result.status == PathStatus::NO_PATH) {
+            if (departure < 0 || departure >= TravelProfiles::DAY_MINUTES) {
+                result = Path(PathStatus::INVALID_DEPARTURE, src, dest);
+            }
+        }
+        if (result.status != PathStatus::FOUND) {
+            return result;
+        }
+
+        BasicScratchLease<MinuteScratch> lease;
+        MinuteScratch& scratch = *lease;
+        int cost = wholeBatches([&] { return searchAt(*graph, int(src), int(dest), departure, scratch); });
+        if (cost == INT_MAX) {
+            result.status = PathStatus::NO_PATH;
+            refreshComponents();
+            return result;
+        }
+
+        trace(result, scratch.parents, cost);
+        return result;
+    }
+
+    // The k cheapest loopless paths from src to dest, cheapest first, all
+    // taken from one version (Yen's algorithm). Fewer come back if fewer
+    // exist; on an error or when there is no path at all, the single result
+    // carries the status, as dijkstra() would return it. The backward tree
+    // is one full search, and the spurs it bounds add little to it, so k
+    // paths cost about what one dijkstra() does (1.0-1.3x on ksp_bench's
+    // grids), not less: on 1M cities that is hundreds of milliseconds.
+    std::vector<Path> kShortestPaths(Id src, Id dest, int k) const {
+        ReadGuard graph = snapshot();
+        return wholeBatches([&] { return rankPaths(*graph, src, dest, k); });
+    }
+
+    // What alternativeRoutes() accepts, relative to the shortest route's
+    // cost: an alternative costs at most ALT_MAX_STRETCH times as much,
+    // shares at most ALT_MAX_SHARING of it with the routes already chosen,
+    // and runs along a plateau at least ALT_MIN_PLATEAU of it long, which
+    // keeps it locally optimal (no shortcut over that stretch).
+    static constexpr double ALT_MAX_STRETCH = 1.25;
+    static constexpr double ALT_MAX_SHARING = 0.8;
+    static constexpr double ALT_MIN_PLATEAU = 0.25;
+
+    // Up to count meaningfully different routes from src to dest, the
+    // shortest first, all from one version (plateau method). Unlike
+    // kShortestPaths, small detours around a route don't count as new
+    // routes. Errors and "no path" are returned as by kShortestPaths.
+    std::vector<Path> alternativeRoutes(Id src, Id dest, int count) const {
+        ReadGuard graph = snapshot();
+        return wholeBatches([&] { return plateauRoutes(*graph, src, dest, count); });
+    }
+
+    static constexpr const char* SAMPLE_CITIES[] = {
+        "karachi", "hyderabad", "sukkur", "islamabad", "lahore", "wazirabad",
+    };
+    // {source, destination, distance}, two-way, between the sample city IDs
+    // (1-6 when loaded into an empty graph).
+    static constexpr int SAMPLE_ROUTES[][3] = {
+        {1, 2, 150}, {1, 5, 220}, {2, 3, 120}, {3, 4, 200}, {4, 6, 210}, {4, 5, 80}, {6, 5, 180},
+    };
+
+    void loadSampleData() {
+        addCities(std::vector<std::string>(std::begin(SAMPLE_CITIES), std::end(SAMPLE_CITIES)));
+        for (const int* route : SAMPLE_ROUTES) {
+            addEdge(route[0], route[1], route[2], false);
+        }
+    }
+
+    // Applies a whole traffic feed batch without per-update console output.
+    // Updates are resolved to edge IDs and grouped by edge, so repeats apply
+    // in feed order to one scratch copy (the last update to an edge wins),
+    // the scratch costs are recomputed in one recomputeCosts() pass, and each
+    // touched overlay word is stored once, inside one batchSequence bracket so
+    // the path queries see the batch whole.
+    TrafficBatchReport applyTrafficBatch(const std::vector<TrafficUpdate>& updates) {
+        static_assert(Cost::usesTraffic, "this graph's cost policy has no traffic");
+        auto start = std::chrono::steady_clock::now();
+        TrafficBatchReport report;
+
+        std::lock_guard<std::mutex> lock(writeLock);
+
+        std::vector<std::pair<uint32_t, int>> resolved;
+        resolved.reserve(updates.size());
+        for (const TrafficUpdate& update : updates) {
+            uint32_t edge;
+            if (update.level < 0 || update.level > 10 || !findEdge(update.from, update.to, edge)) {
+                report.rejected++;
+            } else {
+                resolved.push_back(std::make_pair(edge, update.level));
+            }
+        }
+        std::stable_sort(resolved.begin(), resolved.end(),
+                         [](const std::pair<uint32_t, int>& a, const std::pair<uint32_t, int>& b) {
+                             return a.first < b.first;
+                         });
+
+        std::vector<uint32_t> edges;
+        std::vector<Route> scratch;
+        for (size_t i = 0; i < resolved.size(); i++) {
+            uint32_t edge = resolved[i].first;
+            int level = resolved[i].second;
+            if (edges.empty() || edges.back() != edge) {
+                edges.push_back(edge);
+                scratch.push_back(Route::fromWord(0, overlay->load(edge)));
+            }
+
+            Route& route = scratch.back();
+            route.setTraffic(level, false);
+            if (Block::enabled && level >= 8 && !route.isBlocked()) {
+                route.setBlocked(true, false);
+                report.autoBlocked++;
+            }
+            report.applied++;
+        }
+
+        recomputeCosts(scratch.data(), scratch.size());
+        if (!edges.empty()) {
+            std::unique_lock<std::shared_mutex> hold(batchLock);
+            unsigned long long sequence = batchSequence.load(std::memory_order_relaxed);
+            batchSequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < edges.size(); i++) {
+                writeRoute(edges[i], scratch[i]);
+            }
+            batchSequence.store(sequence + 2, std::memory_order_release);
+        }
+
+        if (report.applied > 0) {
+            changes++;
+        }
+        report.version = changes.load();
+        report.microseconds =
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        return report;
+    }
+
+    void clearGraph() {
+        std::lock_guard<std::mutex> lock(writeLock);
+        unsigned long long number = versions.latest().number + 1;
+        cityIds.clear();
+        edgeIds.clear();
+        profileIds.clear();
+        journalStart += journal.size();
+        journal.clear();
+        names = std::make_shared<NameArena>();
+        overlay = std::make_shared<EdgeOverlay>();
+        generation++;
+        std::atomic_store(&components, std::make_shared<ComponentIndex>(generation));
+        versions.publish(emptyVersion(names, overlay, number, generation));
+        requestRebuild();
+        changes++;
+    }
+};
+
+// The engine the menu, batch mode, the daemon and the accelerators run on.
+typedef BasicGraph<> Graph;
+
+class OverlayLevelInfo {
+public:
+    int maxCellSize;
+    int cells;
+    int cutEdges;
+    int boundaryCities;
+    int largestBoundary;
+
+    OverlayLevelInfo() : maxCellSize(0), cells(0), cutEdges(0), boundaryCities(0), largestBoundary(0) {}
+};
+
+// Multi-level cell overlay for large graphs, in the style of customizable
+// route planning (CRP). build() splits a snapshot's cities into nested cells
+// by recursive BFS bisection, one level per cell size (level 0 has the
+// smallest cells), and customizes every cell: a clique between its boundary
+// cities holding the cheapest cost between each pair through the cell. A
+// query searches the road graph only near its source and destination and
+// crosses every other cell on its clique, at the highest level that keeps it
+// clear of both ends.
+//
+// Route costs are read live from the graph's overlay; only cliques go stale.
+// refresh() recomputes the cells containing routes changed since the last
+// build or refresh, and rebuilds everything if cities or routes were added.
+// Queries may run during a refresh: cliques are swapped per cell, and a
+// rebuild swaps the whole layout.
+class OverlayRouter {
+public:
+    explicit OverlayRouter(const Graph& graph,
+                           const std::vector<int>& cellSizes = std::vector<int>{256, 2048, 16384, 131072})
+        : graph(graph), cellSizes(cellSizes), cursor(0) {}
+
+    // Partitions the latest version and customizes every cell.
+    void build() {
+        std::lock_guard<std::mutex> lock(refreshLock);
+        rebuild();
+    }
+
+    // Brings the cliques up to date with the graph. Returns the number of
+    // cells recomputed. Added cities or routes, or a cleared graph, mean a
+    // new layout.
+    int refresh() {
+        std::lock_guard<std::mutex> lock(refreshLock);
+        std::shared_ptr<const Layout> current = std::atomic_load(&layout);
+        if (!current) return rebuild();
+
+        // The snapshot is pinned after the journal is read, so a route added
+        // since shows up in one or the other.
+        std::vector<uint32_t> edges;
+        uint32_t edgeCount;
+        bool complete = graph.changedEdges(cursor, edges, edgeCount);
+        ReadGuard snapshot = graph.snapshot();
+        if (snapshot->generation != current->generation || snapshot->nextCityId != current->cityCount ||
+            edgeCount != current->edgeCount) {
+            return rebuild();
+        }
+        if (!complete) {
+            return customize(*current, nullptr);
+        }
+        // A route counts towards the clique of every cell holding both its
+        // ends; between cells of a level it is read live.
+        std::vector<std::vector<char>> dirty(cellSizes.size());
+        for (size_t level = 0; level < cellSizes.size(); level++) {
+            dirty[level].assign(current->boundary[level].size(), 0);
+        }
+        for (uint32_t edge : edges) {
+            if (edge >= current->edgeCount) return rebuild();
+            int u = current->edgeTails[edge], v = current->edgeHeads[edge];
+            for (size_t level = 0; level < cellSizes.size(); level++) {
+                int cell = current->cellOf[level][u];
+                if (cell == current->cellOf[level][v]) dirty[level][cell] = 1;
+            }
+        }
+        return customize(*current, &dirty);
+    }
+
+    // Same result as Graph::dijkstra, with the cliques as of the last build
+    // or refresh. EMPTY_GRAPH until the first build.
+    PathResult route(int src, int dest) const {
+        std::shared_ptr<const Layout> current = std::atomic_load(&layout);
+        PathResult result(PathStatus::FOUND, src, dest);
+        if (!current || current->cityCount <= 1) {
+            result.status = PathStatus::EMPTY_GRAPH;
+            return result;
+        }
+        const Layout& at = *current;
+        if (!at.hasCity(src)) {
+            result.status = PathStatus::INVALID_SOURCE;
+            return result;
+        }
+        if (!at.hasCity(dest)) {
+            result.status = PathStatus::INVALID_DESTINATION;
+            return result;
+        }
+        if (src == dest) {
+            result.status = PathStatus::SAME_CITY;
+            result.cost = 0;
+            result.nodes.push_back(src);
+            return result;
+        }
+
+        // parents[] holds ~from for a city reached over a clique.
+        ScratchLease lease;
+        SearchScratch& scratch = *lease;
+        scratch.begin(at.cityCount);
+        scratch.reached[src] = scratch.stamp;
+        scratch.costs[src] = 0;
+        scratch.parents[src] = src;
+        scratch.minHeap.push(0, src);
+        bool found = false;
+        while (!scratch.minHeap.empty()) {
+            std::pair<int, int> current = scratch.minHeap.top();
+            int node = current.second;
+            scratch.minHeap.pop();
+            if (node == dest) {
+                found = true;
+                break;
+            }
+            at.forEachArc(at.queryLevel(node, src, dest), node, [&](int next, long long cost, bool clique) {
+                long long candidate = current.first + cost;
+                if (candidate >= INT_MAX) return;
+                if (scratch.reached[next] == scratch.stamp && candidate >= scratch.costs[next]) return;
+                scratch.reached[next] = scratch.stamp;
+                scratch.costs[next] = (int)candidate;
+                scratch.parents[next] = clique ? ~node : node;
+                scratch.minHeap.push((int)candidate, next);
+            });
+        }
+        if (!found) {
+            result.status = PathStatus::NO_PATH;
+            return result;
+        }
+
+        for (int node = dest; node != src;) {
+            int parent = scratch.parents[node];
+            if (parent >= 0) {
+                result.nodes.push_back(node);
+                node = parent;
+            } else {
+                int from = ~parent;
+                at.unpack(from, node, at.queryLevel(from, src, dest), result.nodes);
+                node = from;
+            }
+        }
+        result.nodes.push_back(src);
+        std::reverse(result.nodes.begin(), result.nodes.end());
+        result.cost = scratch.costs[dest];
+        result.hops = result.nodes.size() - 1;
+        return result;
+    }
+
+    std::vector<OverlayLevelInfo> levels() const {
+        std::shared_ptr<const Layout> current = std::atomic_load(&layout);
+        std::vector<OverlayLevelInfo> infos;
+        if (!current) return infos;
+        for (size_t level = 0; level < cellSizes.size(); level++) {
+            OverlayLevelInfo info;
+            info.maxCellSize = cellSizes[level];
+            info.cells = current->boundary[level].size();
+            info.cutEdges = current->cutEdges[level];
+            for (const std::vector<int>& border : current->boundary[level]) {
+                info.boundaryCities += border.size();
+                info.largestBoundary = std::max(info.largestBoundary, (int)border.size());
+            }
+            infos.push_back(info);
+        }
+        return infos;
+    }
+
+private:
+    // One build's topology and partition. Everything but the cliques is
+    // fixed once published.
+    class Layout {
+    public:
+        std::shared_ptr<EdgeOverlay> overlay;
+        unsigned long long generation;  // of the version it was built from
+        int cityCount;                  // nextCityId of that version
+        uint32_t edgeCount;             // routes it links: edge IDs run below this
+        std::vector<int> firstOut;  // out-routes of city c: [firstOut[c], firstOut[c + 1])
+        std::vector<int> heads;
+        std::vector<uint32_t> edges;
+        std::vector<int> edgeTails;
+        std::vector<int> edgeHeads;
+        // Per level: the cell of each city (-1: no city), each cell's
+        // boundary cities, each city's index in its cell's boundary (-1:
+        // not on it), each cell's boundary x boundary clique (row-major,
+        // INT_MAX: no path) and the number of routes between cells.
+        std::vector<std::vector<int>> cellOf;
+        std::vector<std::vector<std::vector<int>>> boundary;
+        std::vector<std::vector<int>> boundaryIndex;
+        // Per level and cell, the cities its customization searches: all of
+        // them at level 0, the boundary cities of its cells one level down
+        // above that.
+        std::vector<std::vector<std::vector<int>>> members;
+        mutable std::vector<std::vector<std::shared_ptr<const std::vector<int>>>> cliques;
+        std::vector<int> cutEdges;
+
+        bool hasCity(int id) const {
+            return id >= 1 && id < cityCount && cellOf[0][id] != -1;
+        }
+
+        // Highest level at which node's cell holds neither end, or -1 if
+        // its smallest cell holds one.
+        int queryLevel(int node, int src, int dest) const {
+            for (int level = (int)cellOf.size() - 1; level >= 0; level--) {
+                int cell = cellOf[level][node];
+                if (cell != cellOf[level][src] && cell != cellOf[level][dest]) return level;
+            }
+            return -1;
+        }
+
+        // Calls visit(next, cost, overClique) for every arc out of node: at
+        // level -1 its routes, otherwise its cell's clique and its routes out
+        // of the cell. Blocked routes and missing clique entries are left
+        // out.
+        template <typename Visit>
+        void forEachArc(int level, int node, Visit&& visit) const {
+            const EdgeOverlay& costs = *overlay;
+            int cell = -1;
+            if (level >= 0 && boundaryIndex[level][node] >= 0) {
+                cell = cellOf[level][node];
+                const std::vector<int>& border = boundary[level][cell];
+                std::shared_ptr<const std::vector<int>> clique = std::atomic_load(&cliques[level][cell]);
+                const int* row = clique->data() + (size_t)boundaryIndex[level][node] * border.size();
+                for (size_t j = 0; j < border.size(); j++) {
+                    if (row[j] != INT_MAX && border[j] != node) visit(border[j], row[j], true);
+                }
+            }
+            for (int i = firstOut[node]; i < firstOut[node + 1]; i++) {
+                if (cell != -1 && cellOf[level][heads[i]] == cell) continue;
+                uint32_t cost = costs.cost(edges[i]);
+                if (cost != Route::BLOCKED_COST) visit(heads[i], cost, false);
+            }
+        }
+
+        // Appends the cities after from on the cheapest road path from ->
+        // to inside from's cell at level, last first.
+        void unpack(int from, int to, int level, std::vector<int>& nodes) const {
+            ScratchLease lease;
+            SearchScratch& scratch = *lease;
+            int cell = cellOf[level][from];
+            scratch.begin(cityCount);
+            scratch.reached[from] = scratch.stamp;
+            scratch.costs[from] = 0;
+            scratch.parents[from] = from;
+            scratch.minHeap.push(0, from);
+            while (!scratch.minHeap.empty()) {
+                std::pair<int, int> current = scratch.minHeap.top();
+                scratch.minHeap.pop();
+                if (current.second == to) break;
+                forEachArc(-1, current.second, [&](int next, long long cost, bool) {
+                    long long candidate = current.first + cost;
+                    if (cellOf[level][next] != cell || candidate >= INT_MAX) return;
+                    if (scratch.reached[next] == scratch.stamp && candidate >= scratch.costs[next]) return;
+                    scratch.reached[next] = scratch.stamp;
+                    scratch.costs[next] = (int)candidate;
+                    scratch.parents[next] = current.second;
+                    scratch.minHeap.push((int)candidate, next);
+                });
+            }
+            for (int node = to; node != from; node = scratch.parents[node]) {
+                nodes.push_back(node);
+            }
+        }
+    };
+
+    const Graph& graph;
+    std::vector<int> cellSizes;
+    std::mutex refreshLock;
+    std::shared_ptr<const Layout> layout;
+    unsigned long long cursor;  // graph journal position the cliques reflect
+
+    int rebuild() {
+        // Changes from here on are picked up by the next refresh.
+        cursor = graph.changeCursor();
+        ReadGuard snapshot = graph.snapshot();
+        std::shared_ptr<Layout> next = std::make_shared<Layout>();
+        next->overlay = snapshot->overlay;
+        next->generation = snapshot->generation;
+        next->cityCount = snapshot->nextCityId;
+        // Counted from the snapshot: the overlay's own size is the writer's,
+        // and may already include routes the snapshot lacks.
+        next->edgeCount = 0;
+        next->firstOut.assign(next->cityCount + 1, 0);
+        for (int city = 1; city < next->cityCount; city++) {
+            next->firstOut[city] = next->heads.size();
+            if (!snapshot->hasCity(city)) continue;
+            for (const Link& link : snapshot->links(city)) {
+                next->heads.push_back(link.neighbor);
+                next->edges.push_back(link.edge);
+                next->edgeCount = std::max(next->edgeCount, link.edge + 1);
+            }
+        }
+        next->firstOut[next->cityCount] = next->heads.size();
+        next->firstOut[0] = 0;
+        next->edgeTails.assign(next->edgeCount, -1);
+        next->edgeHeads.assign(next->edgeCount, -1);
+        for (int city = 1; city < next->cityCount; city++) {
+            for (int i = next->firstOut[city]; i < next->firstOut[city + 1]; i++) {
+                next->edgeTails[next->edges[i]] = city;
+                next->edgeHeads[next->edges[i]] = next->heads[i];
+            }
+        }
+
+        partition(*snapshot, *next);
+        int cells = customize(*next, nullptr);
+        std::atomic_store(&layout, std::shared_ptr<const Layout>(next));
+        return cells;
+    }
+
+    // Recursive bisection: each part grows by BFS from a far-out city until
+    // it holds half the cities, which on road networks gives compact parts
+    // with short borders. A part becomes a cell at every level whose size it
+    // fits and that none of its ancestors became.
+    void partition(const GraphVersion& snapshot, Layout& at) {
+        int levels = cellSizes.size();
+        at.cellOf.assign(levels, std::vector<int>(at.cityCount, -1));
+
+        // Bisection ignores direction.
+        std::vector<std::vector<int>> neighbors(at.cityCount);
+        std::vector<int> all;
+        for (int city = 1; city < at.cityCount; city++) {
+            if (!snapshot.hasCity(city)) continue;
+            all.push_back(city);
+            for (int i = at.firstOut[city]; i < at.firstOut[city + 1]; i++) {
+                neighbors[city].push_back(at.heads[i]);
+                neighbors[at.heads[i]].push_back(city);
+            }
+        }
+
+        std::vector<int> cellCounts(levels, 0);
+        std::vector<uint32_t> member(at.cityCount, 0), seen(at.cityCount, 0);
+        uint32_t memberStamp = 0, seenStamp = 0;
+        std::vector<int> queue;
+        // Breadth-first order from start through members not yet seen;
+        // stops once limit cities are collected.
+        auto breadthFirst = [&](int start, size_t limit, std::vector<int>& order) {
+            size_t head = order.size();
+            seen[start] = seenStamp;
+            order.push_back(start);
+            while (head < order.size() && order.size() < limit) {
+                int city = order[head++];
+                for (int next : neighbors[city]) {
+                    if (member[next] != memberStamp || seen[next] == seenStamp) continue;
+                    seen[next] = seenStamp;
+                    order.push_back(next);
+                    if (order.size() == limit) break;
+                }
+            }
+        };
+
+        std::vector<std::vector<int>> parts;
+        if (!all.empty()) parts.push_back(std::move(all));
+        while (!parts.empty()) {
+            std::vector<int> part = std::move(parts.back());
+            parts.pop_back();
+            for (int level = levels - 1; level >= 0; level--) {
+                if ((int)part.size() > cellSizes[level] || at.cellOf[level][part[0]] != -1) continue;
+                int cell = cellCounts[level]++;
+                for (int city : part) at.cellOf[level][city] = cell;
+            }
+            if ((int)part.size() <= cellSizes[0]) continue;
+
+            memberStamp++;
+            for (int city : part) member[city] = memberStamp;
+            // The last city a BFS reaches is far out: start the half there.
+            seenStamp++;
+            queue.clear();
+            breadthFirst(part[0], part.size(), queue);
+            int start = queue.back();
+
+            seenStamp++;
+            std::vector<int> half;
+            size_t target = part.size() / 2;
+            breadthFirst(start, target, half);
+            for (size_t i = 0; half.size() < target; i++) {
+                if (seen[part[i]] != seenStamp) breadthFirst(part[i], target, half);
+            }
+            std::vector<int> rest;
+            for (int city : part) {
+                if (seen[city] != seenStamp) rest.push_back(city);
+            }
+            parts.push_back(std::move(half));
+            parts.push_back(std::move(rest));
+        }
+
+        at.boundary.assign(levels, std::vector<std::vector<int>>());
+        at.boundaryIndex.assign(levels, std::vector<int>(at.cityCount, -1));
+        at.cliques.assign(levels, std::vector<std::shared_ptr<const std::vector<int>>>());
+        at.cutEdges.assign(levels, 0);
+        for (int level = 0; level < levels; level++) {
+            at.boundary[level].resize(cellCounts[level]);
+            at.cliques[level].resize(cellCounts[level]);
+            const std::vector<int>& cellOf = at.cellOf[level];
+            for (int city = 1; city < at.cityCount; city++) {
+                for (int i = at.firstOut[city]; i < at.firstOut[city + 1]; i++) {
+                    int head = at.heads[i];
+                    if (cellOf[city] == cellOf[head]) continue;
+                    at.cutEdges[level]++;
+                    for (int end : {city, head}) {
+                        if (at.boundaryIndex[level][end] != -1) continue;
+                        std::vector<int>& border = at.boundary[level][cellOf[end]];
+                        at.boundaryIndex[level][end] = border.size();
+                        border.push_back(end);
+                    }
+                }
+            }
+        }
+
+        at.members.assign(levels, std::vector<std::vector<int>>());
+        for (int level = 0; level < levels; level++) {
+            at.members[level].resize(cellCounts[level]);
+            for (int city = 1; city < at.cityCount; city++) {
+                if (at.cellOf[level][city] == -1) continue;
+                if (level == 0 || at.boundaryIndex[level - 1][city] != -1) {
+                    at.members[level][at.cellOf[level][city]].push_back(city);
+                }
+            }
+        }
+    }
+
+    // Recomputes the cliques of the cells flagged in dirty (all of them if
+    // it is null), level by level from the smallest cells up, since a clique
+    // is built on the cliques one level down. Cells of a level run in
+    // parallel. Returns the number of cells recomputed.
+    int customize(const Layout& at, const std::vector<std::vector<char>>* dirty) {
+        int workers = std::max(1u, std::thread::hardware_concurrency());
+        int recomputed = 0;
+        for (size_t level = 0; level < cellSizes.size(); level++) {
+            std::vector<int> cells;
+            for (int cell = 0; cell < (int)at.boundary[level].size(); cell++) {
+                if (dirty == nullptr || (*dirty)[level][cell]) cells.push_back(cell);
+            }
+            parallelFor(cells.size(), workers, [&](int, int index) {
+                customizeCell(at, level, cells[index]);
+            });
+            recomputed += cells.size();
+        }
+        return recomputed;
+    }
+
+    // One search per boundary city, over the cell's roads (level 0) or over
+    // the cliques and connecting routes of its cells one level down. The
+    // cell's arcs are first copied into a small graph of its own, so the
+    // searches run on arrays that stay in cache.
+    static void customizeCell(const Layout& at, int level, int cell) {
+        const std::vector<int>& border = at.boundary[level][cell];
+        const std::vector<int>& members = at.members[level][cell];
+        const std::vector<int>& cellOf = at.cellOf[level];
+        size_t size = border.size();
+        std::shared_ptr<std::vector<int>> clique = std::make_shared<std::vector<int>>(size * size, INT_MAX);
+
+        // Local IDs follow members; local[] maps back from city IDs.
+        ScratchLease mapLease, searchLease;
+        SearchScratch& map = *mapLease;
+        map.begin(at.cityCount);
+        for (size_t i = 0; i < members.size(); i++) {
+            map.reached[members[i]] = map.stamp;
+            map.parents[members[i]] = i;
+        }
+        std::vector<int> firstArc(members.size() + 1, 0), arcHeads, arcCosts, target(members.size(), -1);
+        for (size_t i = 0; i < members.size(); i++) {
+            int city = members[i];
+            firstArc[i] = arcHeads.size();
+            target[i] = at.boundaryIndex[level][city];
+            at.forEachArc(level - 1, city, [&](int next, long long cost, bool) {
+                if (cellOf[next] != cell || map.reached[next] != map.stamp) return;
+                arcHeads.push_back(map.parents[next]);
+                arcCosts.push_back(cost);
+            });
+        }
+        firstArc[members.size()] = arcHeads.size();
+
+        // A pair whose cheapest path passes another boundary city is left
+        // out: the clique entries to and from that city already cover it,
+        // and the searches above and the queries have fewer arcs to scan.
+        // banned[] marks cities with such a cheapest path.
+        SearchScratch& scratch = *searchLease;
+        for (size_t i = 0; i < size; i++) {
+            scratch.begin(members.size());
+            int root = map.parents[border[i]];
+            scratch.reached[root] = scratch.stamp;
+            scratch.costs[root] = 0;
+            scratch.minHeap.push(0, root);
+            size_t settled = 0;
+            while (!scratch.minHeap.empty() && settled < size) {
+                std::pair<int, int> current = scratch.minHeap.top();
+                scratch.minHeap.pop();
+                bool through = scratch.banned[current.second] == scratch.stamp;
+                int j = target[current.second];
+                if (j != -1) {
+                    if (!through) (*clique)[i * size + j] = current.first;
+                    through = current.second != root;
+                    settled++;
+                }
+                for (int arc = firstArc[current.second]; arc < firstArc[current.second + 1]; arc++) {
+                    int next = arcHeads[arc];
+                    long long candidate = (long long)current.first + arcCosts[arc];
+                    if (candidate >= INT_MAX) continue;
+                    if (scratch.reached[next] == scratch.stamp) {
+                        if (candidate > scratch.costs[next]) continue;
+                        if (candidate == scratch.costs[next]) {
+                            if (through) scratch.banned[next] = scratch.stamp;
+                            continue;
+                        }
+                    }
+                    scratch.reached[next] = scratch.stamp;
+                    scratch.costs[next] = (int)candidate;
+                    scratch.banned[next] = through ? scratch.stamp : 0;
+                    scratch.minHeap.push((int)candidate, next);
+                }
+            }
+        }
+        std::atomic_store(&at.cliques[level][cell], std::shared_ptr<const std::vector<int>>(clique));
+    }
+};
+
+// Hub labels over the route costs of one snapshot. Every city has a forward
+// label, the hubs it reaches with the cheapest cost to each, and a backward
+// label, the hubs that reach it; the cheapest src -> dest cost is the least
+// forward(src)[h] + backward(dest)[h] over the hubs h the two share.
+//
+// Hubs are cities ranked by a contraction hierarchy (CH) order: cities are
+// contracted least important first, by edge difference, with shortcuts
+// added between neighbors where no witness path avoids the city. A city's
+// label is built from the labels of its more important neighbors, and
+// entries some other hub already beats are pruned. Labels are flat arrays
+// sorted by hub rank, so a query is one merge of two arrays, eight hubs at a
+// time with AVX2.
+//
+// The labels live in one buffer laid out exactly as save() writes it, and
+// open() maps a saved file read-only instead of reading it. They are static:
+// traffic or blocking changed after build() is not seen until the next one.
+class HubLabels {
+public:
+    HubLabels() : base(nullptr), size(0), head(nullptr), mapped(nullptr), mappedSize(0) {}
+
+    HubLabels(const HubLabels&) = delete;
+    HubLabels& operator=(const HubLabels&) = delete;
+
+    ~HubLabels() {
+#ifdef __linux__
+        if (mapped) munmap(mapped, mappedSize);
+#endif
+    }
+
+    // Orders the latest version's cities and labels them, on up to workers
+    // threads.
+    static std::shared_ptr<HubLabels> build(const Graph& graph,
+                                            int workers = std::max(1u, std::thread::hardware_concurrency())) {
+        ReadGuard snapshot = graph.snapshot();
+        Hierarchy hierarchy(*snapshot);
+        hierarchy.contractAll();
+
+        int cityCount = hierarchy.cityCount;
+        std::vector<std::vector<Entry>> forward(cityCount), backward(cityCount);
+        std::vector<std::vector<int>> levels = hierarchy.levels();
+        std::vector<LabelScratch> scratch(workers);
+        for (const std::vector<int>& level : levels) {
+            parallelFor(level.size(), workers, [&](int worker, int i) {
+                int city = level[i];
+                scratch[worker].label(hierarchy, city, hierarchy.upOut[city], forward, backward, forward[city]);
+                scratch[worker].label(hierarchy, city, hierarchy.upIn[city], backward, forward, backward[city]);
+            });
+        }
+
+        std::shared_ptr<HubLabels> labels = std::make_shared<HubLabels>();
+        labels->store(hierarchy, forward, backward);
+        return labels;
+    }
+
+    // Maps a file written by save(). Null if it can't be read or isn't one.
+    static std::shared_ptr<HubLabels> open(const std::string& path) {
+        std::shared_ptr<HubLabels> labels = std::make_shared<HubLabels>();
+#ifdef __linux__
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return nullptr;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            close(fd);
+            return nullptr;
+        }
+        void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) return nullptr;
+        labels->mapped = data;
+        labels->mappedSize = info.st_size;
+        if (!labels->attach(static_cast<const char*>(data), info.st_size)) return nullptr;
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) return nullptr;
+        size_t size = file.tellg();
+        labels->owned.resize((size + 7) / 8);
+        file.seekg(0);
+        if (!file.read(reinterpret_cast<char*>(labels->owned.data()), size)) return nullptr;
+        if (!labels->attach(reinterpret_cast<const char*>(labels->owned.data()), size)) return nullptr;
+#endif
+        return labels;
+    }
+
+    bool save(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(base, size);
+        return (bool)file;
+    }
+
+    int cityCount() const { return head->cityCount; }
+    long long entries() const { return head->forwardEntries + head->backwardEntries; }
+    long long shortcuts() const { return head->shortcuts; }
+    size_t bytes() const { return size; }
+
+    // Cheapest cost from src to dest, or -1 if there is no path or either
+    // city is unknown.
+    long long distance(int src, int dest) const {
+        if (!labeled(src) || !labeled(dest)) return -1;
+        uint32_t best = meet(forward, src, backward, dest);
+        return best < INT_MAX ? best : -1;
+    }
+
+    // Same result as Graph::dijkstra on the snapshot the labels were built
+    // from.
+    PathResult route(int src, int dest) const {
+        PathResult result(PathStatus::FOUND, src, dest);
+        if (cityCount() <= 1) {
+            result.status = PathStatus::EMPTY_GRAPH;
+            return result;
+        }
+        if (!labeled(src)) {
+            result.status = PathStatus::INVALID_SOURCE;
+            return result;
+        }
+        if (!labeled(dest)) {
+            result.status = PathStatus::INVALID_DESTINATION;
+            return result;
+        }
+        if (src == dest) {
+            result.status = PathStatus::SAME_CITY;
+            result.cost = 0;
+            result.nodes.push_back(src);
+            return result;
+        }
+
+        // The hub has to be known here, so this merge is the scalar one.
+        uint64_t a = forward.first[src], aEnd = forward.first[src + 1];
+        uint64_t b = backward.first[dest], bEnd = backward.first[dest + 1];
+        uint32_t best = UINT32_MAX;
+        int hub = -1;
+        while (a < aEnd && b < bEnd) {
+            if (forward.hubs[a] < backward.hubs[b]) {
+                a++;
+            } else if (forward.hubs[a] > backward.hubs[b]) {
+                b++;
+            } else {
+                uint32_t cost = forward.costs[a] + backward.costs[b];
+                if (cost < best) {
+                    best = cost;
+                    hub = forward.hubs[a];
+                }
+                a++;
+                b++;
+            }
+        }
+        if (best >= INT_MAX) {
+            result.status = PathStatus::NO_PATH;
+            return result;
+        }
+
+        int hubCity = rankCity[hub];
+        result.nodes.push_back(src);
+        for (int city = src; city != hubCity;) {
+            int next = forward.via[find(forward, city, hub)];
+            unpack(city, next, result.nodes);
+            city = next;
+        }
+        std::vector<int> tail;
+        for (int city = dest; city != hubCity;) {
+            tail.push_back(city);
+            city = backward.via[find(backward, city, hub)];
+        }
+        tail.push_back(hubCity);
+        for (size_t i = tail.size() - 1; i > 0; i--) unpack(tail[i], tail[i - 1], result.nodes);
+        result.cost = best;
+        result.hops = result.nodes.size() - 1;
+        return result;
+    }
+
+private:
+    static constexpr char MAGIC[8] = {'S', 'P', 'F', 'H', 'U', 'B', '0', '1'};
+    static const int SECTIONS = 11;
+
+    class Header {
+    public:
+        char magic[8];
+        int32_t cityCount;
+        int32_t ranked;
+        uint64_t forwardEntries;
+        uint64_t backwardEntries;
+        uint64_t shortcuts;
+    };
+
+    // One direction's labels: city c's entries are [first[c], first[c + 1]),
+    // sorted by hub rank. via is the next city on the way to the hub (the
+    // previous one, backward), over a route or a shortcut.
+    class Side {
+    public:
+        const uint64_t* first;
+        const int32_t* hubs;
+        const uint32_t* costs;
+        const int32_t* via;
+
+        Side() : first(nullptr), hubs(nullptr), costs(nullptr), via(nullptr) {}
+    };
+
+    class Entry {
+    public:
+        int hub;
+        uint32_t cost;
+        int via;
+
+        Entry(int hub, uint32_t cost, int via) : hub(hub), cost(cost), via(via) {}
+    };
+
+    class Arc {
+    public:
+        int to;
+        int cost;
+
+        Arc(int to, int cost) : to(to), cost(cost) {}
+    };
+
+    // The contraction: a mutable copy of the open routes from which cities
+    // are removed one at a time. Arcs from a city to those still left when
+    // it goes are kept as its upward arcs, which is all labeling needs.
+    class Hierarchy {
+    public:
+        // Witness searches settle at most this many cities; a search cut
+        // short only costs a shortcut that wasn't needed.
+        static const int SIMULATE_SETTLED = 50;
+        static const int CONTRACT_SETTLED = 500;
+
+        int cityCount;
+        int ranked;
+        std::vector<int> rank;      // city -> rank, -1 if it doesn't exist
+        std::vector<int> rankCity;  // rank -> city
+        std::vector<std::vector<Arc>> upOut, upIn;
+        std::unordered_map<uint64_t, int> middles;  // shortcut (from << 32 | to) -> city it skips
+
+        explicit Hierarchy(const GraphVersion& graph)
+            : cityCount(graph.nextCityId), ranked(0), rank(cityCount, -1), upOut(cityCount), upIn(cityCount),
+              out(cityCount), in(cityCount), present(cityCount, 0), removedNeighbors(cityCount, 0) {
+            for (int city = 1; city < cityCount; city++) {
+                if (!graph.hasCity(city)) continue;
+                present[city] = 1;
+                ranked++;
+                for (const Link& link : graph.links(city)) {
+                    uint32_t cost = graph.overlay->cost(link.edge);
+                    if (cost == Route::BLOCKED_COST || cost >= INT_MAX || link.neighbor == city) continue;
+                    addArc(city, link.neighbor, cost, -1);
+                }
+            }
+        }
+
+        void contractAll() {
+            MinHeap queue;
+            for (int city = 1; city < cityCount; city++) {
+                if (present[city]) queue.push(priority(city), city);
+            }
+            rankCity.reserve(ranked);
+            // Priorities go stale as neighbors are contracted; a city is only
+            // contracted once its fresh priority still beats the next one.
+            while (!queue.empty()) {
+                int city = queue.top().second;
+                queue.pop();
+                int current = priority(city);
+                if (!queue.empty() && current > queue.top().first) {
+                    queue.push(current, city);
+                    continue;
+                }
+                contract(city);
+            }
+        }
+
+        // Cities grouped so that every upward arc leads to an earlier group,
+        // most important first. Cities of one group label independently.
+        std::vector<std::vector<int>> levels() const {
+            std::vector<int> level(cityCount, 0);
+            std::vector<std::vector<int>> groups;
+            for (int r = ranked - 1; r >= 0; r--) {
+                int city = rankCity[r];
+                for (const Arc& arc : upOut[city]) level[city] = std::max(level[city], level[arc.to] + 1);
+                for (const Arc& arc : upIn[city]) level[city] = std::max(level[city], level[arc.to] + 1);
+                if (level[city] >= (int)groups.size()) groups.resize(level[city] + 1);
+                groups[level[city]].push_back(city);
+            }
+            return groups;
+        }
+
+    private:
+        std::vector<std::vector<Arc>> out, in;
+        std::vector<char> present;
+        std::vector<int> removedNeighbors;
+        SearchScratch scratch;
+
+        // Adds or cheapens from -> to; middle is the city a shortcut skips.
+        void addArc(int from, int to, int cost, int middle) {
+            for (Arc& arc : out[from]) {
+                if (arc.to != to) continue;
+                if (arc.cost <= cost) return;
+                arc.cost = cost;
+                for (Arc& back : in[to]) {
+                    if (back.to == from) back.cost = cost;
+                }
+                if (middle >= 0) middles[key(from, to)] = middle;
+                return;
+            }
+            out[from].push_back(Arc(to, cost));
+            in[to].push_back(Arc(from, cost));
+            if (middle >= 0) middles[key(from, to)] = middle;
+        }
+
+        // Cheapest costs from `from` without passing `avoid`, up to limit.
+        void witness(int from, int avoid, long long limit, int maxSettled) {
+            scratch.begin(cityCount);
+            scratch.banned[avoid] = scratch.stamp;
+            scratch.reached[from] = scratch.stamp;
+            scratch.costs[from] = 0;
+            scratch.minHeap.push(0, from);
+            int settled = 0;
+            while (!scratch.minHeap.empty()) {
+                std::pair<int, int> current = scratch.minHeap.top();
+                scratch.minHeap.pop();
+                if (current.first > limit || ++settled > maxSettled) break;
+                for (const Arc& arc : out[current.second]) {
+                    if (scratch.banned[arc.to] == scratch.stamp) continue;
+                    long long candidate = (long long)current.first + arc.cost;
+                    if (candidate > limit) continue;
+                    if (scratch.reached[arc.to] == scratch.stamp && candidate >= scratch.costs[arc.to]) continue;
+                    scratch.reached[arc.to] = scratch.stamp;
+                    scratch.costs[arc.to] = (int)candidate;
+                    scratch.minHeap.push((int)candidate, arc.to);
+                }
+            }
+        }
+
+        // Shortcuts contracting city needs; added too when apply is set.
+        int shortcutsFor(int city, int maxSettled, bool apply) {
+            int needed = 0;
+            for (size_t i = 0; i < in[city].size(); i++) {
+                Arc incoming = in[city][i];
+                long long limit = 0;
+                for (const Arc& outgoing : out[city]) {
+                    if (outgoing.to != incoming.to) limit = std::max(limit, (long long)incoming.cost + outgoing.cost);
+                }
+                if (limit == 0) continue;
+                witness(incoming.to, city, limit, maxSettled);
+                for (const Arc& outgoing : out[city]) {
+                    if (outgoing.to == incoming.to) continue;
+                    long long through = (long long)incoming.cost + outgoing.cost;
+                    if (through >= INT_MAX) continue;
+                    if (scratch.reached[outgoing.to] == scratch.stamp && scratch.costs[outgoing.to] <= through) {
+                        continue;
+                    }
+                    needed++;
+                    if (apply) addArc(incoming.to, outgoing.to, (int)through, city);
+                }
+            }
+            return needed;
+        }
+
+        int priority(int city) {
+            return shortcutsFor(city, SIMULATE_SETTLED, false) - (int)(in[city].size() + out[city].size()) +
+                   removedNeighbors[city];
+        }
+
+        void contract(int city) {
+            shortcutsFor(city, CONTRACT_SETTLED, true);
+            rank[city] = rankCity.size();
+            rankCity.push_back(city);
+            upOut[city] = std::move(out[city]);
+            upIn[city] = std::move(in[city]);
+            for (const Arc& arc : upOut[city]) {
+                std::vector<Arc>& back = in[arc.to];
+                back.erase(std::remove_if(back.begin(), back.end(), [&](const Arc& a) { return a.to == city; }),
+                           back.end());
+                removedNeighbors[arc.to]++;
+            }
+            for (const Arc& arc : upIn[city]) {
+                std::vector<Arc>& back = out[arc.to];
+                back.erase(std::remove_if(back.begin(), back.end(), [&](const Arc& a) { return a.to == city; }),
+                           back.end());
+                removedNeighbors[arc.to]++;
+            }
+            out[city] = std::vector<Arc>();
+            in[city] = std::vector<Arc>();
+        }
+    };
+
+    // Per-worker arrays for building one label, indexed by hub rank.
+    class LabelScratch {
+    public:
+        std::vector<uint32_t> seen;
+        std::vector<uint32_t> best;
+        std::vector<int> via;
+        std::vector<int> hubs;
+        uint32_t stamp;
+
+        LabelScratch() : stamp(0) {}
+
+        // city's label from its upward arcs and the labels (in `labels`) of
+        // the cities they lead to. An entry is dropped when some other hub
+        // of the label plus that hub's label from the other side (`opposite`)
+        // is cheaper: the cost isn't the cheapest, and the other hub covers
+        // every path through it.
+        void label(const Hierarchy& hierarchy, int city, const std::vector<Arc>& arcs,
+                   const std::vector<std::vector<Entry>>& labels, const std::vector<std::vector<Entry>>& opposite,
+                   std::vector<Entry>& result) {
+            if ((int)seen.size() < hierarchy.ranked) {
+                seen.assign(hierarchy.ranked, 0);
+                best.resize(hierarchy.ranked);
+                via.resize(hierarchy.ranked);
+                stamp = 0;
+            }
+            if (++stamp == 0) {
+                std::fill(seen.begin(), seen.end(), 0);
+                stamp = 1;
+            }
+            hubs.clear();
+            int own = hierarchy.rank[city];
+            offer(own, 0, city);
+            for (const Arc& arc : arcs) {
+                for (const Entry& entry : labels[arc.to]) {
+                    long long cost = (long long)arc.cost + entry.cost;
+                    if (cost < INT_MAX) offer(entry.hub, (uint32_t)cost, arc.to);
+                }
+            }
+            std::sort(hubs.begin(), hubs.end());
+
+            result.clear();
+            for (int hub : hubs) {
+                bool beaten = false;
+                if (hub != own) {
+                    for (const Entry& entry : opposite[hierarchy.rankCity[hub]]) {
+                        if (seen[entry.hub] == stamp && entry.hub != hub &&
+                            (uint64_t)best[entry.hub] + entry.cost < best[hub]) {
+                            beaten = true;
+                            break;
+                        }
+                    }
+                }
+                if (!beaten) result.push_back(Entry(hub, best[hub], via[hub]));
+            }
+            result.shrink_to_fit();
+        }
+
+    private:
+        void offer(int hub, uint32_t cost, int next) {
+            if (seen[hub] != stamp) {
+                seen[hub] = stamp;
+                hubs.push_back(hub);
+            } else if (best[hub] <= cost) {
+                return;
+            }
+            best[hub] = cost;
+            via[hub] = next;
+        }
+    };
+
+    // Either owned (built here or read without mmap) or mapped from a file.
+    std::vector<uint64_t> owned;
+    const char* base;
+    size_t size;
+    const Header* head;
+    void* mapped;
+    size_t mappedSize;
+
+    const int32_t* rankCity;
+    Side forward;
+    Side backward;
+    const uint64_t* shortcutKeys;  // sorted
+    const int32_t* shortcutMiddles;
+
+    static uint64_t key(int from, int to) { return (uint64_t)(uint32_t)from << 32 | (uint32_t)to; }
+
+    bool labeled(int city) const {
+        return city >= 1 && city < head->cityCount && forward.first[city] != forward.first[city + 1];
+    }
+
+    // Byte offsets of each array after the header, 64-byte aligned, in the
+    // order attach() reads them. Returns the total size.
+    static size_t place(const Header& header, size_t offsets[SECTIONS]) {
+        uint64_t cities = header.cityCount;
+        size_t lengths[SECTIONS] = {
+            cities * 4,
+            (cities + 1) * 8, header.forwardEntries * 4, header.forwardEntries * 4, header.forwardEntries * 4,
+            (cities + 1) * 8, header.backwardEntries * 4, header.backwardEntries * 4, header.backwardEntries * 4,
+            header.shortcuts * 8, header.shortcuts * 4,
+        };
+        size_t at = sizeof(Header);
+        for (int i = 0; i < SECTIONS; i++) {
+            at = (at + 63) & ~(size_t)63;
+            offsets[i] = at;
+            at += lengths[i];
+        }
+        return at;
+    }
+
+    bool attach(const char* data, size_t length) {
+        if (length < sizeof(Header)) return false;
+        const Header* header = reinterpret_cast<const Header*>(data);
+        if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->cityCount < 0) return false;
+        size_t offsets[SECTIONS];
+        if (place(*header, offsets) > length) return false;
+        base = data;
+        size = length;
+        head = header;
+        rankCity = reinterpret_cast<const int32_t*>(data + offsets[0]);
+        Side* sides[2] = {&forward, &backward};
+        for (int s = 0; s < 2; s++) {
+            sides[s]->first = reinterpret_cast<const uint64_t*>(data + offsets[1 + 4 * s]);
+            sides[s]->hubs = reinterpret_cast<const int32_t*>(data + offsets[2 + 4 * s]);
+            sides[s]->costs = reinterpret_cast<const uint32_t*>(data + offsets[3 + 4 * s]);
+            sides[s]->via = reinterpret_cast<const int32_t*>(data + offsets[4 + 4 * s]);
+        }
+        shortcutKeys = reinterpret_cast<const uint64_t*>(data + offsets[9]);
+        shortcutMiddles = reinterpret_cast<const int32_t*>(data + offsets[10]);
+
+        // Indexes are checked to be in range and shortcuts to unpack to an
+        // end. Costs, and whether each via leads to its hub, are trusted to
+        // be what build() wrote.
+        uint64_t totals[2] = {header->forwardEntries, header->backwardEntries};
+        for (int s = 0; s < 2; s++) {
+            const uint64_t* first = sides[s]->first;
+            if (first[0] != 0 || first[header->cityCount] != totals[s]) return false;
+            for (int city = 0; city < header->cityCount; city++) {
+                if (first[city] > first[city + 1]) return false;
+            }
+            for (uint64_t i = 0; i < totals[s]; i++) {
+                if (sides[s]->hubs[i] < 0 || sides[s]->hubs[i] >= header->ranked ||
+                    sides[s]->via[i] < 0 || sides[s]->via[i] >= header->cityCount) {
+                    return false;
+                }
+            }
+        }
+        std::vector<int> rank(header->cityCount, -1);
+        for (int r = 0; r < header->ranked; r++) {
+            if (rankCity[r] < 0 || rankCity[r] >= header->cityCount || rank[rankCity[r]] != -1) return false;
+            rank[rankCity[r]] = r;
+        }
+        // A shortcut's middle city was contracted before both its ends, so
+        // each unpack() step lowers the lesser end rank and recursion stops.
+        for (uint64_t i = 0; i < header->shortcuts; i++) {
+            if (i > 0 && shortcutKeys[i] <= shortcutKeys[i - 1]) return false;
+            uint64_t from = shortcutKeys[i] >> 32, to = shortcutKeys[i] & UINT32_MAX;
+            int middle = shortcutMiddles[i];
+            if (from >= (uint64_t)header->cityCount || to >= (uint64_t)header->cityCount || middle < 0 ||
+                middle >= header->cityCount || (uint64_t)middle == from || (uint64_t)middle == to) {
+                return false;
+            }
+            if (rank[middle] < 0 || rank[middle] >= rank[from] || rank[middle] >= rank[to]) return false;
+        }
+        return true;
+    }
+
+    void store(const Hierarchy& hierarchy, const std::vector<std::vector<Entry>>& forwardLabels,
+               const std::vector<std::vector<Entry>>& backwardLabels) {
+        Header header;
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.cityCount = hierarchy.cityCount;
+        header.ranked = hierarchy.ranked;
+        header.forwardEntries = header.backwardEntries = 0;
+        for (const std::vector<Entry>& label : forwardLabels) header.forwardEntries += label.size();
+        for (const std::vector<Entry>& label : backwardLabels) header.backwardEntries += label.size();
+        header.shortcuts = hierarchy.middles.size();
+
+        size_t offsets[SECTIONS];
+        size_t total = place(header, offsets);
+        owned.assign((total + 7) / 8, 0);
+        char* data = reinterpret_cast<char*>(owned.data());
+        std::memcpy(data, &header, sizeof(Header));
+        std::memcpy(data + offsets[0], hierarchy.rankCity.data(), hierarchy.rankCity.size() * 4);
+
+        const std::vector<std::vector<Entry>>* labels[2] = {&forwardLabels, &backwardLabels};
+        for (int s = 0; s < 2; s++) {
+            uint64_t* first = reinterpret_cast<uint64_t*>(data + offsets[1 + 4 * s]);
+            int32_t* hubs = reinterpret_cast<int32_t*>(data + offsets[2 + 4 * s]);
+            uint32_t* costs = reinterpret_cast<uint32_t*>(data + offsets[3 + 4 * s]);
+            int32_t* via = reinterpret_cast<int32_t*>(data + offsets[4 + 4 * s]);
+            uint64_t at = 0;
+            for (int city = 0; city < hierarchy.cityCount; city++) {
+                first[city] = at;
+                for (const Entry& entry : (*labels[s])[city]) {
+                    hubs[at] = entry.hub;
+                    costs[at] = entry.cost;
+                    via[at] = entry.via;
+                    at++;
+                }
+            }
+            first[hierarchy.cityCount] = at;
+        }
+
+        std::vector<std::pair<uint64_t, int>> skips(hierarchy.middles.begin(), hierarchy.middles.end());
+        std::sort(skips.begin(), skips.end());
+        uint64_t* keys = reinterpret_cast<uint64_t*>(data + offsets[9]);
+        int32_t* middles = reinterpret_cast<int32_t*>(data + offsets[10]);
+        for (size_t i = 0; i < skips.size(); i++) {
+            keys[i] = skips[i].first;
+            middles[i] = skips[i].second;
+        }
+        attach(data, total);
+    }
+
+    // Least a.costs + b.costs over the hubs the two labels share, or
+    // UINT32_MAX. Costs are below INT_MAX, so sums fit.
+    static uint32_t meet(const Side& a, int aCity, const Side& b, int bCity) {
+        const int32_t* aHubs = a.hubs + a.first[aCity];
+        const uint32_t* aCosts = a.costs + a.first[aCity];
+        size_t aSize = a.first[aCity + 1] - a.first[aCity];
+        const int32_t* bHubs = b.hubs + b.first[bCity];
+        const uint32_t* bCosts = b.costs + b.first[bCity];
+        size_t bSize = b.first[bCity + 1] - b.first[bCity];
+        uint32_t best = UINT32_MAX;
+        size_t i = 0, j = 0;
+#ifdef __AVX2__
+        // Compares a block of eight hubs from each side all against all by
+        // rotating one block through the other, then moves past whichever
+        // block ends lower (both, on a tie).
+        const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+        __m256i bestLanes = _mm256_set1_epi32(-1);
+        while (i + 8 <= aSize && j + 8 <= bSize) {
+            __m256i hubsA = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aHubs + i));
+            __m256i costsA = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aCosts + i));
+            __m256i hubsB = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bHubs + j));
+            __m256i costsB = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bCosts + j));
+            for (int turn = 0; turn < 8; turn++) {
+                __m256i match = _mm256_cmpeq_epi32(hubsA, hubsB);
+                __m256i sum = _mm256_add_epi32(costsA, costsB);
+                __m256i candidate = _mm256_or_si256(sum, _mm256_xor_si256(match, _mm256_set1_epi32(-1)));
+                bestLanes = _mm256_min_epu32(bestLanes, candidate);
+                hubsB = _mm256_permutevar8x32_epi32(hubsB, rotate);
+                costsB = _mm256_permutevar8x32_epi32(costsB, rotate);
+            }
+            int32_t aLast = aHubs[i + 7], bLast = bHubs[j + 7];
+            if (aLast <= bLast) i += 8;
+            if (bLast <= aLast) j += 8;
+        }
+        alignas(32) uint32_t lanes[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), bestLanes);
+        for (uint32_t lane : lanes) best = std::min(best, lane);
+#endif
+        while (i < aSize && j < bSize) {
+            if (aHubs[i] < bHubs[j]) {
+                i++;
+            } else if (aHubs[i] > bHubs[j]) {
+                j++;
+            } else {
+                best = std::min(best, aCosts[i] + bCosts[j]);
+                i++;
+                j++;
+            }
+        }
+        return best;
+    }
+
+    // Index of hub in city's label on one side; the hub must be there.
+    static uint64_t find(const Side& side, int city, int hub) {
+        return std::lower_bound(side.hubs + side.first[city], side.hubs + side.first[city + 1], hub) - side.hubs;
+    }
+
+    // Appends the cities after from up to and including to, expanding
+    // shortcuts.
+    void unpack(int from, int to, std::vector<int>& nodes) const {
+        const uint64_t* end = shortcutKeys + head->shortcuts;
+        const uint64_t* at = std::lower_bound(shortcutKeys, end, key(from, to));
+        if (at == end || *at != key(from, to)) {
+            nodes.push_back(to);
+            return;
+        }
+        int middle = shortcutMiddles[at - shortcutKeys];
+        unpack(from, middle, nodes);
+        unpack(middle, to, nodes);
+    }
+};
+
+#endif